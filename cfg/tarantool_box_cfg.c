@@ -33,21 +33,33 @@ init_tarantool_cfg(tarantool_cfg *c) {
 	c->coredump = false;
 	c->admin_port = 0;
 	c->replication_port = 0;
+	c->replication_ring_size = 0;
 	c->log_level = 0;
 	c->slab_alloc_arena = 0;
 	c->slab_alloc_minimal = 0;
 	c->slab_alloc_factor = 0;
+	c->slab_alloc_huge_pages = 0;
+	c->slab_alloc_prefault = false;
+	c->slab_reclaim_delay = 0;
 	c->work_dir = NULL;
+	c->shards = 0;
 	c->pid_file = NULL;
 	c->logger = NULL;
 	c->logger_nonblock = false;
 	c->io_collect_interval = 0;
 	c->backlog = 0;
 	c->readahead = 0;
+	c->io_uring = false;
+	c->fiber_stack_size = 0;
+	c->fiber_stat = false;
+	c->stall_threshold = 0;
 	c->snap_dir = NULL;
 	c->wal_dir = NULL;
 	c->primary_port = 0;
 	c->secondary_port = 0;
+	c->iproto_threads = 0;
+	c->iproto_inflight_limit = 0;
+	c->iproto_lazy_fibers = false;
 	c->too_long_threshold = 0;
 	c->custom_proc_title = NULL;
 	c->memcached_port = 0;
@@ -55,6 +67,13 @@ init_tarantool_cfg(tarantool_cfg *c) {
 	c->memcached_expire = false;
 	c->memcached_expire_per_loop = 0;
 	c->memcached_expire_full_sweep = 0;
+	c->memcached_eviction = false;
+	c->memcached_memory_limit = 0;
+	c->compact_threshold = 0;
+	c->compact_interval = 0;
+	c->compact_per_loop = 0;
+	c->expire_per_loop = 0;
+	c->expire_rate_limit = 0;
 	c->snap_io_rate_limit = 0;
 	c->rows_per_wal = 0;
 	c->wal_fsync_delay = 0;
@@ -63,6 +82,11 @@ init_tarantool_cfg(tarantool_cfg *c) {
 	c->wal_dir_rescan_delay = 0;
 	c->panic_on_snap_error = false;
 	c->panic_on_wal_error = false;
+	c->replication_batching = false;
+	c->replication_compression = false;
+	c->replication_ack = false;
+	c->replication_sync_quorum = 0;
+	c->replication_sync_timeout = 0;
 	c->replication_source = NULL;
 	c->space = NULL;
 }
@@ -77,11 +101,16 @@ fill_default_tarantool_cfg(tarantool_cfg *c) {
 	c->coredump = false;
 	c->admin_port = 0;
 	c->replication_port = 0;
+	c->replication_ring_size = 65536;
 	c->log_level = 4;
 	c->slab_alloc_arena = 1;
 	c->slab_alloc_minimal = 64;
 	c->slab_alloc_factor = 2;
+	c->slab_alloc_huge_pages = 0;
+	c->slab_alloc_prefault = false;
+	c->slab_reclaim_delay = 0.0;
 	c->work_dir = NULL;
+	c->shards = 0;
 	c->pid_file = strdup("tarantool.pid");
 	if (c->pid_file == NULL) return CNF_NOMEMORY;
 	c->logger = NULL;
@@ -89,12 +118,19 @@ fill_default_tarantool_cfg(tarantool_cfg *c) {
 	c->io_collect_interval = 0;
 	c->backlog = 1024;
 	c->readahead = 16320;
+	c->io_uring = false;
+	c->fiber_stack_size = 65536;
+	c->fiber_stat = false;
+	c->stall_threshold = 0.0;
 	c->snap_dir = strdup(".");
 	if (c->snap_dir == NULL) return CNF_NOMEMORY;
 	c->wal_dir = strdup(".");
 	if (c->wal_dir == NULL) return CNF_NOMEMORY;
 	c->primary_port = 0;
 	c->secondary_port = 0;
+	c->iproto_threads = 0;
+	c->iproto_inflight_limit = 1;
+	c->iproto_lazy_fibers = false;
 	c->too_long_threshold = 0.5;
 	c->custom_proc_title = NULL;
 	c->memcached_port = 0;
@@ -102,6 +138,13 @@ fill_default_tarantool_cfg(tarantool_cfg *c) {
 	c->memcached_expire = false;
 	c->memcached_expire_per_loop = 1024;
 	c->memcached_expire_full_sweep = 3600;
+	c->memcached_eviction = false;
+	c->memcached_memory_limit = 0;
+	c->compact_threshold = 0.0;
+	c->compact_interval = 60.0;
+	c->compact_per_loop = 1024;
+	c->expire_per_loop = 1024;
+	c->expire_rate_limit = 0;
 	c->snap_io_rate_limit = 0;
 	c->rows_per_wal = 500000;
 	c->wal_fsync_delay = 0;
@@ -110,6 +153,11 @@ fill_default_tarantool_cfg(tarantool_cfg *c) {
 	c->wal_dir_rescan_delay = 0.1;
 	c->panic_on_snap_error = true;
 	c->panic_on_wal_error = false;
+	c->replication_batching = false;
+	c->replication_compression = false;
+	c->replication_ack = false;
+	c->replication_sync_quorum = 0;
+	c->replication_sync_timeout = 1.0;
 	c->replication_source = NULL;
 	c->space = NULL;
 	return 0;
@@ -127,6 +175,11 @@ acceptDefault_name__space(tarantool_cfg_space *c) {
 	c->enabled = -1;
 	c->cardinality = -1;
 	c->estimated_rows = 0;
+	c->sync = false;
+	c->memory_limit = 0;
+	c->expire_field = -1;
+	c->field_types = strdup("");
+	if (c->field_types == NULL) return CNF_NOMEMORY;
 	c->index = NULL;
 	return 0;
 }
@@ -163,6 +216,9 @@ static NameAtom _name__admin_port[] = {
 static NameAtom _name__replication_port[] = {
 	{ "replication_port", -1, NULL }
 };
+static NameAtom _name__replication_ring_size[] = {
+	{ "replication_ring_size", -1, NULL }
+};
 static NameAtom _name__log_level[] = {
 	{ "log_level", -1, NULL }
 };
@@ -175,9 +231,21 @@ static NameAtom _name__slab_alloc_minimal[] = {
 static NameAtom _name__slab_alloc_factor[] = {
 	{ "slab_alloc_factor", -1, NULL }
 };
+static NameAtom _name__slab_alloc_huge_pages[] = {
+	{ "slab_alloc_huge_pages", -1, NULL }
+};
+static NameAtom _name__slab_alloc_prefault[] = {
+	{ "slab_alloc_prefault", -1, NULL }
+};
+static NameAtom _name__slab_reclaim_delay[] = {
+	{ "slab_reclaim_delay", -1, NULL }
+};
 static NameAtom _name__work_dir[] = {
 	{ "work_dir", -1, NULL }
 };
+static NameAtom _name__shards[] = {
+	{ "shards", -1, NULL }
+};
 static NameAtom _name__pid_file[] = {
 	{ "pid_file", -1, NULL }
 };
@@ -196,6 +264,18 @@ static NameAtom _name__backlog[] = {
 static NameAtom _name__readahead[] = {
 	{ "readahead", -1, NULL }
 };
+static NameAtom _name__io_uring[] = {
+	{ "io_uring", -1, NULL }
+};
+static NameAtom _name__fiber_stack_size[] = {
+	{ "fiber_stack_size", -1, NULL }
+};
+static NameAtom _name__fiber_stat[] = {
+	{ "fiber_stat", -1, NULL }
+};
+static NameAtom _name__stall_threshold[] = {
+	{ "stall_threshold", -1, NULL }
+};
 static NameAtom _name__snap_dir[] = {
 	{ "snap_dir", -1, NULL }
 };
@@ -208,6 +288,15 @@ static NameAtom _name__primary_port[] = {
 static NameAtom _name__secondary_port[] = {
 	{ "secondary_port", -1, NULL }
 };
+static NameAtom _name__iproto_threads[] = {
+	{ "iproto_threads", -1, NULL }
+};
+static NameAtom _name__iproto_inflight_limit[] = {
+	{ "iproto_inflight_limit", -1, NULL }
+};
+static NameAtom _name__iproto_lazy_fibers[] = {
+	{ "iproto_lazy_fibers", -1, NULL }
+};
 static NameAtom _name__too_long_threshold[] = {
 	{ "too_long_threshold", -1, NULL }
 };
@@ -229,6 +318,27 @@ static NameAtom _name__memcached_expire_per_loop[] = {
 static NameAtom _name__memcached_expire_full_sweep[] = {
 	{ "memcached_expire_full_sweep", -1, NULL }
 };
+static NameAtom _name__memcached_eviction[] = {
+	{ "memcached_eviction", -1, NULL }
+};
+static NameAtom _name__memcached_memory_limit[] = {
+	{ "memcached_memory_limit", -1, NULL }
+};
+static NameAtom _name__compact_threshold[] = {
+	{ "compact_threshold", -1, NULL }
+};
+static NameAtom _name__compact_interval[] = {
+	{ "compact_interval", -1, NULL }
+};
+static NameAtom _name__compact_per_loop[] = {
+	{ "compact_per_loop", -1, NULL }
+};
+static NameAtom _name__expire_per_loop[] = {
+	{ "expire_per_loop", -1, NULL }
+};
+static NameAtom _name__expire_rate_limit[] = {
+	{ "expire_rate_limit", -1, NULL }
+};
 static NameAtom _name__snap_io_rate_limit[] = {
 	{ "snap_io_rate_limit", -1, NULL }
 };
@@ -253,6 +363,21 @@ static NameAtom _name__panic_on_snap_error[] = {
 static NameAtom _name__panic_on_wal_error[] = {
 	{ "panic_on_wal_error", -1, NULL }
 };
+static NameAtom _name__replication_batching[] = {
+	{ "replication_batching", -1, NULL }
+};
+static NameAtom _name__replication_compression[] = {
+	{ "replication_compression", -1, NULL }
+};
+static NameAtom _name__replication_ack[] = {
+	{ "replication_ack", -1, NULL }
+};
+static NameAtom _name__replication_sync_quorum[] = {
+	{ "replication_sync_quorum", -1, NULL }
+};
+static NameAtom _name__replication_sync_timeout[] = {
+	{ "replication_sync_timeout", -1, NULL }
+};
 static NameAtom _name__replication_source[] = {
 	{ "replication_source", -1, NULL }
 };
@@ -271,6 +396,22 @@ static NameAtom _name__space__estimated_rows[] = {
 	{ "space", -1, _name__space__estimated_rows + 1 },
 	{ "estimated_rows", -1, NULL }
 };
+static NameAtom _name__space__sync[] = {
+	{ "space", -1, _name__space__sync + 1 },
+	{ "sync", -1, NULL }
+};
+static NameAtom _name__space__memory_limit[] = {
+	{ "space", -1, _name__space__memory_limit + 1 },
+	{ "memory_limit", -1, NULL }
+};
+static NameAtom _name__space__expire_field[] = {
+	{ "space", -1, _name__space__expire_field + 1 },
+	{ "expire_field", -1, NULL }
+};
+static NameAtom _name__space__field_types[] = {
+	{ "space", -1, _name__space__field_types + 1 },
+	{ "field_types", -1, NULL }
+};
 static NameAtom _name__space__index[] = {
 	{ "space", -1, _name__space__index + 1 },
 	{ "index", -1, NULL }
@@ -417,6 +558,20 @@ acceptValue(tarantool_cfg* c, OptDef* opt, int check_rdonly) {
 			return CNF_RDONLY;
 		c->replication_port = i32;
 	}
+	else if ( cmpNameAtoms( opt->name, _name__replication_ring_size) ) {
+		if (opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		long int i32 = strtol(opt->paramValue.numberval, NULL, 10);
+		if (i32 == 0 && errno == EINVAL)
+			return CNF_WRONGINT;
+		if ( (i32 == LONG_MIN || i32 == LONG_MAX) && errno == ERANGE)
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->replication_ring_size != i32)
+			return CNF_RDONLY;
+		c->replication_ring_size = i32;
+	}
 	else if ( cmpNameAtoms( opt->name, _name__log_level) ) {
 		if (opt->paramType != numberType )
 			return CNF_WRONGTYPE;
@@ -467,6 +622,63 @@ acceptValue(tarantool_cfg* c, OptDef* opt, int check_rdonly) {
 			return CNF_RDONLY;
 		c->slab_alloc_factor = dbl;
 	}
+	else if ( cmpNameAtoms( opt->name, _name__slab_alloc_huge_pages) ) {
+		if (opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		long int i32 = strtol(opt->paramValue.numberval, NULL, 10);
+		if (i32 == 0 && errno == EINVAL)
+			return CNF_WRONGINT;
+		if ( (i32 == LONG_MIN || i32 == LONG_MAX) && errno == ERANGE)
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->slab_alloc_huge_pages != i32)
+			return CNF_RDONLY;
+		c->slab_alloc_huge_pages = i32;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__slab_alloc_prefault) ) {
+		if (opt->paramType != stringType && opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		bool bln;
+
+		if (opt->paramType == numberType) {
+			if (strcmp(opt->paramValue.numberval, "0") == 0 || strcmp(opt->paramValue.numberval, "1") == 0)
+				bln = opt->paramValue.numberval[0] - '0';
+			else
+				return CNF_WRONGRANGE;
+		}
+		else if (strcasecmp(opt->paramValue.stringval, "true") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "yes") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "enable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "on") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "1") == 0 )
+			bln = true;
+		else if (strcasecmp(opt->paramValue.stringval, "false") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "no") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "disable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "off") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "0") == 0 )
+			bln = false;
+		else
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->slab_alloc_prefault != bln)
+			return CNF_RDONLY;
+		c->slab_alloc_prefault = bln;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__slab_reclaim_delay) ) {
+		if (opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		double dbl = strtod(opt->paramValue.numberval, NULL);
+		if ( (dbl == 0 || dbl == -HUGE_VAL || dbl == HUGE_VAL) && errno == ERANGE)
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->slab_reclaim_delay != dbl)
+			return CNF_RDONLY;
+		c->slab_reclaim_delay = dbl;
+	}
 	else if ( cmpNameAtoms( opt->name, _name__work_dir) ) {
 		if (opt->paramType != stringType )
 			return CNF_WRONGTYPE;
@@ -479,6 +691,20 @@ acceptValue(tarantool_cfg* c, OptDef* opt, int check_rdonly) {
 		if (opt->paramValue.stringval && c->work_dir == NULL)
 			return CNF_NOMEMORY;
 	}
+	else if ( cmpNameAtoms( opt->name, _name__shards) ) {
+		if (opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		long int i32 = strtol(opt->paramValue.numberval, NULL, 10);
+		if (i32 == 0 && errno == EINVAL)
+			return CNF_WRONGINT;
+		if ( (i32 == LONG_MIN || i32 == LONG_MAX) && errno == ERANGE)
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->shards != i32)
+			return CNF_RDONLY;
+		c->shards = i32;
+	}
 	else if ( cmpNameAtoms( opt->name, _name__pid_file) ) {
 		if (opt->paramType != stringType )
 			return CNF_WRONGTYPE;
@@ -572,6 +798,94 @@ acceptValue(tarantool_cfg* c, OptDef* opt, int check_rdonly) {
 			return CNF_WRONGRANGE;
 		c->readahead = i32;
 	}
+	else if ( cmpNameAtoms( opt->name, _name__io_uring) ) {
+		if (opt->paramType != stringType && opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		bool bln;
+
+		if (opt->paramType == numberType) {
+			if (strcmp(opt->paramValue.numberval, "0") == 0 || strcmp(opt->paramValue.numberval, "1") == 0)
+				bln = opt->paramValue.numberval[0] - '0';
+			else
+				return CNF_WRONGRANGE;
+		}
+		else if (strcasecmp(opt->paramValue.stringval, "true") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "yes") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "enable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "on") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "1") == 0 )
+			bln = true;
+		else if (strcasecmp(opt->paramValue.stringval, "false") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "no") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "disable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "off") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "0") == 0 )
+			bln = false;
+		else
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->io_uring != bln)
+			return CNF_RDONLY;
+		c->io_uring = bln;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__fiber_stack_size) ) {
+		if (opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		long int i32 = strtol(opt->paramValue.numberval, NULL, 10);
+		if (i32 == 0 && errno == EINVAL)
+			return CNF_WRONGINT;
+		if ( (i32 == LONG_MIN || i32 == LONG_MAX) && errno == ERANGE)
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->fiber_stack_size != i32)
+			return CNF_RDONLY;
+		c->fiber_stack_size = i32;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__fiber_stat) ) {
+		if (opt->paramType != stringType && opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		bool bln;
+
+		if (opt->paramType == numberType) {
+			if (strcmp(opt->paramValue.numberval, "0") == 0 || strcmp(opt->paramValue.numberval, "1") == 0)
+				bln = opt->paramValue.numberval[0] - '0';
+			else
+				return CNF_WRONGRANGE;
+		}
+		else if (strcasecmp(opt->paramValue.stringval, "true") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "yes") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "enable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "on") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "1") == 0 )
+			bln = true;
+		else if (strcasecmp(opt->paramValue.stringval, "false") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "no") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "disable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "off") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "0") == 0 )
+			bln = false;
+		else
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->fiber_stat != bln)
+			return CNF_RDONLY;
+		c->fiber_stat = bln;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__stall_threshold) ) {
+		if (opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		double dbl = strtod(opt->paramValue.numberval, NULL);
+		if ( (dbl == 0 || dbl == -HUGE_VAL || dbl == HUGE_VAL) && errno == ERANGE)
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->stall_threshold != dbl)
+			return CNF_RDONLY;
+		c->stall_threshold = dbl;
+	}
 	else if ( cmpNameAtoms( opt->name, _name__snap_dir) ) {
 		if (opt->paramType != stringType )
 			return CNF_WRONGTYPE;
@@ -624,6 +938,65 @@ acceptValue(tarantool_cfg* c, OptDef* opt, int check_rdonly) {
 			return CNF_RDONLY;
 		c->secondary_port = i32;
 	}
+	else if ( cmpNameAtoms( opt->name, _name__iproto_threads) ) {
+		if (opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		long int i32 = strtol(opt->paramValue.numberval, NULL, 10);
+		if (i32 == 0 && errno == EINVAL)
+			return CNF_WRONGINT;
+		if ( (i32 == LONG_MIN || i32 == LONG_MAX) && errno == ERANGE)
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->iproto_threads != i32)
+			return CNF_RDONLY;
+		c->iproto_threads = i32;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__iproto_inflight_limit) ) {
+		if (opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		long int i32 = strtol(opt->paramValue.numberval, NULL, 10);
+		if (i32 == 0 && errno == EINVAL)
+			return CNF_WRONGINT;
+		if ( (i32 == LONG_MIN || i32 == LONG_MAX) && errno == ERANGE)
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->iproto_inflight_limit != i32)
+			return CNF_RDONLY;
+		c->iproto_inflight_limit = i32;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__iproto_lazy_fibers) ) {
+		if (opt->paramType != stringType && opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		bool bln;
+
+		if (opt->paramType == numberType) {
+			if (strcmp(opt->paramValue.numberval, "0") == 0 || strcmp(opt->paramValue.numberval, "1") == 0)
+				bln = opt->paramValue.numberval[0] - '0';
+			else
+				return CNF_WRONGRANGE;
+		}
+		else if (strcasecmp(opt->paramValue.stringval, "true") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "yes") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "enable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "on") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "1") == 0 )
+			bln = true;
+		else if (strcasecmp(opt->paramValue.stringval, "false") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "no") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "disable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "off") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "0") == 0 )
+			bln = false;
+		else
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->iproto_lazy_fibers != bln)
+			return CNF_RDONLY;
+		c->iproto_lazy_fibers = bln;
+	}
 	else if ( cmpNameAtoms( opt->name, _name__too_long_threshold) ) {
 		if (opt->paramType != numberType )
 			return CNF_WRONGTYPE;
@@ -660,7 +1033,141 @@ acceptValue(tarantool_cfg* c, OptDef* opt, int check_rdonly) {
 			return CNF_RDONLY;
 		c->memcached_port = i32;
 	}
-	else if ( cmpNameAtoms( opt->name, _name__memcached_space) ) {
+	else if ( cmpNameAtoms( opt->name, _name__memcached_space) ) {
+		if (opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		long int i32 = strtol(opt->paramValue.numberval, NULL, 10);
+		if (i32 == 0 && errno == EINVAL)
+			return CNF_WRONGINT;
+		if ( (i32 == LONG_MIN || i32 == LONG_MAX) && errno == ERANGE)
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->memcached_space != i32)
+			return CNF_RDONLY;
+		c->memcached_space = i32;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__memcached_expire) ) {
+		if (opt->paramType != stringType && opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		bool bln;
+
+		if (opt->paramType == numberType) {
+			if (strcmp(opt->paramValue.numberval, "0") == 0 || strcmp(opt->paramValue.numberval, "1") == 0)
+				bln = opt->paramValue.numberval[0] - '0';
+			else
+				return CNF_WRONGRANGE;
+		}
+		else if (strcasecmp(opt->paramValue.stringval, "true") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "yes") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "enable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "on") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "1") == 0 )
+			bln = true;
+		else if (strcasecmp(opt->paramValue.stringval, "false") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "no") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "disable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "off") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "0") == 0 )
+			bln = false;
+		else
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->memcached_expire != bln)
+			return CNF_RDONLY;
+		c->memcached_expire = bln;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__memcached_expire_per_loop) ) {
+		if (opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		long int i32 = strtol(opt->paramValue.numberval, NULL, 10);
+		if (i32 == 0 && errno == EINVAL)
+			return CNF_WRONGINT;
+		if ( (i32 == LONG_MIN || i32 == LONG_MAX) && errno == ERANGE)
+			return CNF_WRONGRANGE;
+		c->memcached_expire_per_loop = i32;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__memcached_expire_full_sweep) ) {
+		if (opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		double dbl = strtod(opt->paramValue.numberval, NULL);
+		if ( (dbl == 0 || dbl == -HUGE_VAL || dbl == HUGE_VAL) && errno == ERANGE)
+			return CNF_WRONGRANGE;
+		c->memcached_expire_full_sweep = dbl;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__memcached_eviction) ) {
+		if (opt->paramType != stringType && opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		bool bln;
+
+		if (opt->paramType == numberType) {
+			if (strcmp(opt->paramValue.numberval, "0") == 0 || strcmp(opt->paramValue.numberval, "1") == 0)
+				bln = opt->paramValue.numberval[0] - '0';
+			else
+				return CNF_WRONGRANGE;
+		}
+		else if (strcasecmp(opt->paramValue.stringval, "true") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "yes") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "enable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "on") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "1") == 0 )
+			bln = true;
+		else if (strcasecmp(opt->paramValue.stringval, "false") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "no") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "disable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "off") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "0") == 0 )
+			bln = false;
+		else
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->memcached_eviction != bln)
+			return CNF_RDONLY;
+		c->memcached_eviction = bln;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__memcached_memory_limit) ) {
+		if (opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		long int i32 = strtol(opt->paramValue.numberval, NULL, 10);
+		if (i32 == 0 && errno == EINVAL)
+			return CNF_WRONGINT;
+		if ( (i32 == LONG_MIN || i32 == LONG_MAX) && errno == ERANGE)
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->memcached_memory_limit != i32)
+			return CNF_RDONLY;
+		c->memcached_memory_limit = i32;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__compact_threshold) ) {
+		if (opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		double dbl = strtod(opt->paramValue.numberval, NULL);
+		if ( (dbl == 0 || dbl == -HUGE_VAL || dbl == HUGE_VAL) && errno == ERANGE)
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->compact_threshold != dbl)
+			return CNF_RDONLY;
+		c->compact_threshold = dbl;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__compact_interval) ) {
+		if (opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		double dbl = strtod(opt->paramValue.numberval, NULL);
+		if ( (dbl == 0 || dbl == -HUGE_VAL || dbl == HUGE_VAL) && errno == ERANGE)
+			return CNF_WRONGRANGE;
+		c->compact_interval = dbl;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__compact_per_loop) ) {
 		if (opt->paramType != numberType )
 			return CNF_WRONGTYPE;
 		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
@@ -670,42 +1177,9 @@ acceptValue(tarantool_cfg* c, OptDef* opt, int check_rdonly) {
 			return CNF_WRONGINT;
 		if ( (i32 == LONG_MIN || i32 == LONG_MAX) && errno == ERANGE)
 			return CNF_WRONGRANGE;
-		if (check_rdonly && c->memcached_space != i32)
-			return CNF_RDONLY;
-		c->memcached_space = i32;
-	}
-	else if ( cmpNameAtoms( opt->name, _name__memcached_expire) ) {
-		if (opt->paramType != stringType && opt->paramType != numberType )
-			return CNF_WRONGTYPE;
-		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
-		errno = 0;
-		bool bln;
-
-		if (opt->paramType == numberType) {
-			if (strcmp(opt->paramValue.numberval, "0") == 0 || strcmp(opt->paramValue.numberval, "1") == 0)
-				bln = opt->paramValue.numberval[0] - '0';
-			else
-				return CNF_WRONGRANGE;
-		}
-		else if (strcasecmp(opt->paramValue.stringval, "true") == 0 ||
-				strcasecmp(opt->paramValue.stringval, "yes") == 0 ||
-				strcasecmp(opt->paramValue.stringval, "enable") == 0 ||
-				strcasecmp(opt->paramValue.stringval, "on") == 0 ||
-				strcasecmp(opt->paramValue.stringval, "1") == 0 )
-			bln = true;
-		else if (strcasecmp(opt->paramValue.stringval, "false") == 0 ||
-				strcasecmp(opt->paramValue.stringval, "no") == 0 ||
-				strcasecmp(opt->paramValue.stringval, "disable") == 0 ||
-				strcasecmp(opt->paramValue.stringval, "off") == 0 ||
-				strcasecmp(opt->paramValue.stringval, "0") == 0 )
-			bln = false;
-		else
-			return CNF_WRONGRANGE;
-		if (check_rdonly && c->memcached_expire != bln)
-			return CNF_RDONLY;
-		c->memcached_expire = bln;
+		c->compact_per_loop = i32;
 	}
-	else if ( cmpNameAtoms( opt->name, _name__memcached_expire_per_loop) ) {
+	else if ( cmpNameAtoms( opt->name, _name__expire_per_loop) ) {
 		if (opt->paramType != numberType )
 			return CNF_WRONGTYPE;
 		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
@@ -715,17 +1189,19 @@ acceptValue(tarantool_cfg* c, OptDef* opt, int check_rdonly) {
 			return CNF_WRONGINT;
 		if ( (i32 == LONG_MIN || i32 == LONG_MAX) && errno == ERANGE)
 			return CNF_WRONGRANGE;
-		c->memcached_expire_per_loop = i32;
+		c->expire_per_loop = i32;
 	}
-	else if ( cmpNameAtoms( opt->name, _name__memcached_expire_full_sweep) ) {
+	else if ( cmpNameAtoms( opt->name, _name__expire_rate_limit) ) {
 		if (opt->paramType != numberType )
 			return CNF_WRONGTYPE;
 		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
 		errno = 0;
-		double dbl = strtod(opt->paramValue.numberval, NULL);
-		if ( (dbl == 0 || dbl == -HUGE_VAL || dbl == HUGE_VAL) && errno == ERANGE)
+		long int i32 = strtol(opt->paramValue.numberval, NULL, 10);
+		if (i32 == 0 && errno == EINVAL)
+			return CNF_WRONGINT;
+		if ( (i32 == LONG_MIN || i32 == LONG_MAX) && errno == ERANGE)
 			return CNF_WRONGRANGE;
-		c->memcached_expire_full_sweep = dbl;
+		c->expire_rate_limit = i32;
 	}
 	else if ( cmpNameAtoms( opt->name, _name__snap_io_rate_limit) ) {
 		if (opt->paramType != numberType )
@@ -884,6 +1360,121 @@ acceptValue(tarantool_cfg* c, OptDef* opt, int check_rdonly) {
 			return CNF_RDONLY;
 		c->panic_on_wal_error = bln;
 	}
+	else if ( cmpNameAtoms( opt->name, _name__replication_batching) ) {
+		if (opt->paramType != stringType && opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		bool bln;
+
+		if (opt->paramType == numberType) {
+			if (strcmp(opt->paramValue.numberval, "0") == 0 || strcmp(opt->paramValue.numberval, "1") == 0)
+				bln = opt->paramValue.numberval[0] - '0';
+			else
+				return CNF_WRONGRANGE;
+		}
+		else if (strcasecmp(opt->paramValue.stringval, "true") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "yes") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "enable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "on") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "1") == 0 )
+			bln = true;
+		else if (strcasecmp(opt->paramValue.stringval, "false") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "no") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "disable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "off") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "0") == 0 )
+			bln = false;
+		else
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->replication_batching != bln)
+			return CNF_RDONLY;
+		c->replication_batching = bln;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__replication_compression) ) {
+		if (opt->paramType != stringType && opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		bool bln;
+
+		if (opt->paramType == numberType) {
+			if (strcmp(opt->paramValue.numberval, "0") == 0 || strcmp(opt->paramValue.numberval, "1") == 0)
+				bln = opt->paramValue.numberval[0] - '0';
+			else
+				return CNF_WRONGRANGE;
+		}
+		else if (strcasecmp(opt->paramValue.stringval, "true") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "yes") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "enable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "on") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "1") == 0 )
+			bln = true;
+		else if (strcasecmp(opt->paramValue.stringval, "false") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "no") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "disable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "off") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "0") == 0 )
+			bln = false;
+		else
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->replication_compression != bln)
+			return CNF_RDONLY;
+		c->replication_compression = bln;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__replication_ack) ) {
+		if (opt->paramType != stringType && opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		bool bln;
+
+		if (opt->paramType == numberType) {
+			if (strcmp(opt->paramValue.numberval, "0") == 0 || strcmp(opt->paramValue.numberval, "1") == 0)
+				bln = opt->paramValue.numberval[0] - '0';
+			else
+				return CNF_WRONGRANGE;
+		}
+		else if (strcasecmp(opt->paramValue.stringval, "true") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "yes") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "enable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "on") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "1") == 0 )
+			bln = true;
+		else if (strcasecmp(opt->paramValue.stringval, "false") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "no") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "disable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "off") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "0") == 0 )
+			bln = false;
+		else
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->replication_ack != bln)
+			return CNF_RDONLY;
+		c->replication_ack = bln;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__replication_sync_quorum) ) {
+		if (opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		long int i32 = strtol(opt->paramValue.numberval, NULL, 10);
+		if (i32 == 0 && errno == EINVAL)
+			return CNF_WRONGINT;
+		if ( (i32 == LONG_MIN || i32 == LONG_MAX) && errno == ERANGE)
+			return CNF_WRONGRANGE;
+		c->replication_sync_quorum = i32;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__replication_sync_timeout) ) {
+		if (opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		c->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		double dbl = strtod(opt->paramValue.numberval, NULL);
+		if ( (dbl == 0 || dbl == -HUGE_VAL || dbl == HUGE_VAL) && errno == ERANGE)
+			return CNF_WRONGRANGE;
+		c->replication_sync_timeout = dbl;
+	}
 	else if ( cmpNameAtoms( opt->name, _name__replication_source) ) {
 		if (opt->paramType != stringType )
 			return CNF_WRONGTYPE;
@@ -970,6 +1561,93 @@ acceptValue(tarantool_cfg* c, OptDef* opt, int check_rdonly) {
 			return CNF_RDONLY;
 		c->space[opt->name->index]->estimated_rows = i32;
 	}
+	else if ( cmpNameAtoms( opt->name, _name__space__sync) ) {
+		if (opt->paramType != stringType && opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		ARRAYALLOC(c->space, opt->name->index + 1, _name__space, check_rdonly, CNF_FLAG_STRUCT_NEW | CNF_FLAG_STRUCT_NOTSET);
+		if (c->space[opt->name->index]->__confetti_flags & CNF_FLAG_STRUCT_NEW)
+			check_rdonly = 0;
+		c->space[opt->name->index]->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		c->space[opt->name->index]->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		bool bln;
+
+		if (opt->paramType == numberType) {
+			if (strcmp(opt->paramValue.numberval, "0") == 0 || strcmp(opt->paramValue.numberval, "1") == 0)
+				bln = opt->paramValue.numberval[0] - '0';
+			else
+				return CNF_WRONGRANGE;
+		}
+		else if (strcasecmp(opt->paramValue.stringval, "true") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "yes") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "enable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "on") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "1") == 0 )
+			bln = true;
+		else if (strcasecmp(opt->paramValue.stringval, "false") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "no") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "disable") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "off") == 0 ||
+				strcasecmp(opt->paramValue.stringval, "0") == 0 )
+			bln = false;
+		else
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->space[opt->name->index]->sync != bln)
+			return CNF_RDONLY;
+		c->space[opt->name->index]->sync = bln;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__space__memory_limit) ) {
+		if (opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		ARRAYALLOC(c->space, opt->name->index + 1, _name__space, check_rdonly, CNF_FLAG_STRUCT_NEW | CNF_FLAG_STRUCT_NOTSET);
+		if (c->space[opt->name->index]->__confetti_flags & CNF_FLAG_STRUCT_NEW)
+			check_rdonly = 0;
+		c->space[opt->name->index]->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		c->space[opt->name->index]->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		long int i32 = strtol(opt->paramValue.numberval, NULL, 10);
+		if (i32 == 0 && errno == EINVAL)
+			return CNF_WRONGINT;
+		if ( (i32 == LONG_MIN || i32 == LONG_MAX) && errno == ERANGE)
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->space[opt->name->index]->memory_limit != i32)
+			return CNF_RDONLY;
+		c->space[opt->name->index]->memory_limit = i32;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__space__expire_field) ) {
+		if (opt->paramType != numberType )
+			return CNF_WRONGTYPE;
+		ARRAYALLOC(c->space, opt->name->index + 1, _name__space, check_rdonly, CNF_FLAG_STRUCT_NEW | CNF_FLAG_STRUCT_NOTSET);
+		if (c->space[opt->name->index]->__confetti_flags & CNF_FLAG_STRUCT_NEW)
+			check_rdonly = 0;
+		c->space[opt->name->index]->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		c->space[opt->name->index]->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		long int i32 = strtol(opt->paramValue.numberval, NULL, 10);
+		if (i32 == 0 && errno == EINVAL)
+			return CNF_WRONGINT;
+		if ( (i32 == LONG_MIN || i32 == LONG_MAX) && errno == ERANGE)
+			return CNF_WRONGRANGE;
+		if (check_rdonly && c->space[opt->name->index]->expire_field != i32)
+			return CNF_RDONLY;
+		c->space[opt->name->index]->expire_field = i32;
+	}
+	else if ( cmpNameAtoms( opt->name, _name__space__field_types) ) {
+		if (opt->paramType != stringType )
+			return CNF_WRONGTYPE;
+		ARRAYALLOC(c->space, opt->name->index + 1, _name__space, check_rdonly, CNF_FLAG_STRUCT_NEW | CNF_FLAG_STRUCT_NOTSET);
+		if (c->space[opt->name->index]->__confetti_flags & CNF_FLAG_STRUCT_NEW)
+			check_rdonly = 0;
+		c->space[opt->name->index]->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		c->space[opt->name->index]->__confetti_flags &= ~CNF_FLAG_STRUCT_NOTSET;
+		errno = 0;
+		if (check_rdonly && ( (opt->paramValue.stringval == NULL && c->space[opt->name->index]->field_types == NULL) || strcmp(opt->paramValue.stringval, c->space[opt->name->index]->field_types) != 0))
+			return CNF_RDONLY;
+		 if (c->space[opt->name->index]->field_types) free(c->space[opt->name->index]->field_types);
+		c->space[opt->name->index]->field_types = (opt->paramValue.stringval) ? strdup(opt->paramValue.stringval) : NULL;
+		if (opt->paramValue.stringval && c->space[opt->name->index]->field_types == NULL)
+			return CNF_NOMEMORY;
+	}
 	else if ( cmpNameAtoms( opt->name, _name__space__index) ) {
 		if (opt->paramType != arrayType )
 			return CNF_WRONGTYPE;
@@ -1211,21 +1889,33 @@ typedef enum IteratorState {
 	S_name__coredump,
 	S_name__admin_port,
 	S_name__replication_port,
+	S_name__replication_ring_size,
 	S_name__log_level,
 	S_name__slab_alloc_arena,
 	S_name__slab_alloc_minimal,
 	S_name__slab_alloc_factor,
+	S_name__slab_alloc_huge_pages,
+	S_name__slab_alloc_prefault,
+	S_name__slab_reclaim_delay,
 	S_name__work_dir,
+	S_name__shards,
 	S_name__pid_file,
 	S_name__logger,
 	S_name__logger_nonblock,
 	S_name__io_collect_interval,
 	S_name__backlog,
 	S_name__readahead,
+	S_name__io_uring,
+	S_name__fiber_stack_size,
+	S_name__fiber_stat,
+	S_name__stall_threshold,
 	S_name__snap_dir,
 	S_name__wal_dir,
 	S_name__primary_port,
 	S_name__secondary_port,
+	S_name__iproto_threads,
+	S_name__iproto_inflight_limit,
+	S_name__iproto_lazy_fibers,
 	S_name__too_long_threshold,
 	S_name__custom_proc_title,
 	S_name__memcached_port,
@@ -1233,6 +1923,13 @@ typedef enum IteratorState {
 	S_name__memcached_expire,
 	S_name__memcached_expire_per_loop,
 	S_name__memcached_expire_full_sweep,
+	S_name__memcached_eviction,
+	S_name__memcached_memory_limit,
+	S_name__compact_threshold,
+	S_name__compact_interval,
+	S_name__compact_per_loop,
+	S_name__expire_per_loop,
+	S_name__expire_rate_limit,
 	S_name__snap_io_rate_limit,
 	S_name__rows_per_wal,
 	S_name__wal_fsync_delay,
@@ -1241,11 +1938,20 @@ typedef enum IteratorState {
 	S_name__wal_dir_rescan_delay,
 	S_name__panic_on_snap_error,
 	S_name__panic_on_wal_error,
+	S_name__replication_batching,
+	S_name__replication_compression,
+	S_name__replication_ack,
+	S_name__replication_sync_quorum,
+	S_name__replication_sync_timeout,
 	S_name__replication_source,
 	S_name__space,
 	S_name__space__enabled,
 	S_name__space__cardinality,
 	S_name__space__estimated_rows,
+	S_name__space__sync,
+	S_name__space__memory_limit,
+	S_name__space__expire_field,
+	S_name__space__field_types,
 	S_name__space__index,
 	S_name__space__index__type,
 	S_name__space__index__unique,
@@ -1330,6 +2036,17 @@ again:
 			}
 			sprintf(*v, "%"PRId32, c->replication_port);
 			snprintf(buf, PRINTBUFLEN-1, "replication_port");
+			i->state = S_name__replication_ring_size;
+			return buf;
+		case S_name__replication_ring_size:
+			*v = malloc(32);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%"PRId32, c->replication_ring_size);
+			snprintf(buf, PRINTBUFLEN-1, "replication_ring_size");
 			i->state = S_name__log_level;
 			return buf;
 		case S_name__log_level:
@@ -1374,6 +2091,39 @@ again:
 			}
 			sprintf(*v, "%g", c->slab_alloc_factor);
 			snprintf(buf, PRINTBUFLEN-1, "slab_alloc_factor");
+			i->state = S_name__slab_alloc_huge_pages;
+			return buf;
+		case S_name__slab_alloc_huge_pages:
+			*v = malloc(32);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%"PRId32, c->slab_alloc_huge_pages);
+			snprintf(buf, PRINTBUFLEN-1, "slab_alloc_huge_pages");
+			i->state = S_name__slab_alloc_prefault;
+			return buf;
+		case S_name__slab_alloc_prefault:
+			*v = malloc(8);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%s", c->slab_alloc_prefault ? "true" : "false");
+			snprintf(buf, PRINTBUFLEN-1, "slab_alloc_prefault");
+			i->state = S_name__slab_reclaim_delay;
+			return buf;
+		case S_name__slab_reclaim_delay:
+			*v = malloc(32);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%g", c->slab_reclaim_delay);
+			snprintf(buf, PRINTBUFLEN-1, "slab_reclaim_delay");
 			i->state = S_name__work_dir;
 			return buf;
 		case S_name__work_dir:
@@ -1383,7 +2133,18 @@ again:
 				out_warning(CNF_NOMEMORY, "No memory to output value");
 				return NULL;
 			}
-			snprintf(buf, PRINTBUFLEN-1, "work_dir");
+			snprintf(buf, PRINTBUFLEN-1, "work_dir");
+			i->state = S_name__shards;
+			return buf;
+		case S_name__shards:
+			*v = malloc(32);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%"PRId32, c->shards);
+			snprintf(buf, PRINTBUFLEN-1, "shards");
 			i->state = S_name__pid_file;
 			return buf;
 		case S_name__pid_file:
@@ -1448,6 +2209,50 @@ again:
 			}
 			sprintf(*v, "%"PRId32, c->readahead);
 			snprintf(buf, PRINTBUFLEN-1, "readahead");
+			i->state = S_name__io_uring;
+			return buf;
+		case S_name__io_uring:
+			*v = malloc(8);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%s", c->io_uring ? "true" : "false");
+			snprintf(buf, PRINTBUFLEN-1, "io_uring");
+			i->state = S_name__fiber_stack_size;
+			return buf;
+		case S_name__fiber_stack_size:
+			*v = malloc(32);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%"PRId32, c->fiber_stack_size);
+			snprintf(buf, PRINTBUFLEN-1, "fiber_stack_size");
+			i->state = S_name__fiber_stat;
+			return buf;
+		case S_name__fiber_stat:
+			*v = malloc(8);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%s", c->fiber_stat ? "true" : "false");
+			snprintf(buf, PRINTBUFLEN-1, "fiber_stat");
+			i->state = S_name__stall_threshold;
+			return buf;
+		case S_name__stall_threshold:
+			*v = malloc(32);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%g", c->stall_threshold);
+			snprintf(buf, PRINTBUFLEN-1, "stall_threshold");
 			i->state = S_name__snap_dir;
 			return buf;
 		case S_name__snap_dir:
@@ -1490,6 +2295,39 @@ again:
 			}
 			sprintf(*v, "%"PRId32, c->secondary_port);
 			snprintf(buf, PRINTBUFLEN-1, "secondary_port");
+			i->state = S_name__iproto_threads;
+			return buf;
+		case S_name__iproto_threads:
+			*v = malloc(32);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%"PRId32, c->iproto_threads);
+			snprintf(buf, PRINTBUFLEN-1, "iproto_threads");
+			i->state = S_name__iproto_inflight_limit;
+			return buf;
+		case S_name__iproto_inflight_limit:
+			*v = malloc(32);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%"PRId32, c->iproto_inflight_limit);
+			snprintf(buf, PRINTBUFLEN-1, "iproto_inflight_limit");
+			i->state = S_name__iproto_lazy_fibers;
+			return buf;
+		case S_name__iproto_lazy_fibers:
+			*v = malloc(8);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%s", c->iproto_lazy_fibers ? "true" : "false");
+			snprintf(buf, PRINTBUFLEN-1, "iproto_lazy_fibers");
 			i->state = S_name__too_long_threshold;
 			return buf;
 		case S_name__too_long_threshold:
@@ -1566,6 +2404,83 @@ again:
 			}
 			sprintf(*v, "%g", c->memcached_expire_full_sweep);
 			snprintf(buf, PRINTBUFLEN-1, "memcached_expire_full_sweep");
+			i->state = S_name__memcached_eviction;
+			return buf;
+		case S_name__memcached_eviction:
+			*v = malloc(8);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%s", c->memcached_eviction ? "true" : "false");
+			snprintf(buf, PRINTBUFLEN-1, "memcached_eviction");
+			i->state = S_name__memcached_memory_limit;
+			return buf;
+		case S_name__memcached_memory_limit:
+			*v = malloc(32);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%"PRId32, c->memcached_memory_limit);
+			snprintf(buf, PRINTBUFLEN-1, "memcached_memory_limit");
+			i->state = S_name__compact_threshold;
+			return buf;
+		case S_name__compact_threshold:
+			*v = malloc(32);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%g", c->compact_threshold);
+			snprintf(buf, PRINTBUFLEN-1, "compact_threshold");
+			i->state = S_name__compact_interval;
+			return buf;
+		case S_name__compact_interval:
+			*v = malloc(32);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%g", c->compact_interval);
+			snprintf(buf, PRINTBUFLEN-1, "compact_interval");
+			i->state = S_name__compact_per_loop;
+			return buf;
+		case S_name__compact_per_loop:
+			*v = malloc(32);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%"PRId32, c->compact_per_loop);
+			snprintf(buf, PRINTBUFLEN-1, "compact_per_loop");
+			i->state = S_name__expire_per_loop;
+			return buf;
+		case S_name__expire_per_loop:
+			*v = malloc(32);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%"PRId32, c->expire_per_loop);
+			snprintf(buf, PRINTBUFLEN-1, "expire_per_loop");
+			i->state = S_name__expire_rate_limit;
+			return buf;
+		case S_name__expire_rate_limit:
+			*v = malloc(32);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%"PRId32, c->expire_rate_limit);
+			snprintf(buf, PRINTBUFLEN-1, "expire_rate_limit");
 			i->state = S_name__snap_io_rate_limit;
 			return buf;
 		case S_name__snap_io_rate_limit:
@@ -1654,6 +2569,61 @@ again:
 			}
 			sprintf(*v, "%s", c->panic_on_wal_error ? "true" : "false");
 			snprintf(buf, PRINTBUFLEN-1, "panic_on_wal_error");
+			i->state = S_name__replication_batching;
+			return buf;
+		case S_name__replication_batching:
+			*v = malloc(8);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%s", c->replication_batching ? "true" : "false");
+			snprintf(buf, PRINTBUFLEN-1, "replication_batching");
+			i->state = S_name__replication_compression;
+			return buf;
+		case S_name__replication_compression:
+			*v = malloc(8);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%s", c->replication_compression ? "true" : "false");
+			snprintf(buf, PRINTBUFLEN-1, "replication_compression");
+			i->state = S_name__replication_ack;
+			return buf;
+		case S_name__replication_ack:
+			*v = malloc(8);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%s", c->replication_ack ? "true" : "false");
+			snprintf(buf, PRINTBUFLEN-1, "replication_ack");
+			i->state = S_name__replication_sync_quorum;
+			return buf;
+		case S_name__replication_sync_quorum:
+			*v = malloc(32);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%"PRId32, c->replication_sync_quorum);
+			snprintf(buf, PRINTBUFLEN-1, "replication_sync_quorum");
+			i->state = S_name__replication_sync_timeout;
+			return buf;
+		case S_name__replication_sync_timeout:
+			*v = malloc(32);
+			if (*v == NULL) {
+				free(i);
+				out_warning(CNF_NOMEMORY, "No memory to output value");
+				return NULL;
+			}
+			sprintf(*v, "%g", c->replication_sync_timeout);
+			snprintf(buf, PRINTBUFLEN-1, "replication_sync_timeout");
 			i->state = S_name__replication_source;
 			return buf;
 		case S_name__replication_source:
@@ -1671,6 +2641,10 @@ again:
 		case S_name__space__enabled:
 		case S_name__space__cardinality:
 		case S_name__space__estimated_rows:
+		case S_name__space__sync:
+		case S_name__space__memory_limit:
+		case S_name__space__expire_field:
+		case S_name__space__field_types:
 		case S_name__space__index:
 		case S_name__space__index__type:
 		case S_name__space__index__unique:
@@ -1711,6 +2685,49 @@ again:
 						}
 						sprintf(*v, "%"PRId32, c->space[i->idx_name__space]->estimated_rows);
 						snprintf(buf, PRINTBUFLEN-1, "space[%d].estimated_rows", i->idx_name__space);
+						i->state = S_name__space__sync;
+						return buf;
+					case S_name__space__sync:
+						*v = malloc(8);
+						if (*v == NULL) {
+							free(i);
+							out_warning(CNF_NOMEMORY, "No memory to output value");
+							return NULL;
+						}
+						sprintf(*v, "%s", c->space[i->idx_name__space]->sync == -1 ? "false" : c->space[i->idx_name__space]->sync ? "true" : "false");
+						snprintf(buf, PRINTBUFLEN-1, "space[%d].sync", i->idx_name__space);
+						i->state = S_name__space__memory_limit;
+						return buf;
+					case S_name__space__memory_limit:
+						*v = malloc(32);
+						if (*v == NULL) {
+							free(i);
+							out_warning(CNF_NOMEMORY, "No memory to output value");
+							return NULL;
+						}
+						sprintf(*v, "%"PRId32, c->space[i->idx_name__space]->memory_limit);
+						snprintf(buf, PRINTBUFLEN-1, "space[%d].memory_limit", i->idx_name__space);
+						i->state = S_name__space__expire_field;
+						return buf;
+					case S_name__space__expire_field:
+						*v = malloc(32);
+						if (*v == NULL) {
+							free(i);
+							out_warning(CNF_NOMEMORY, "No memory to output value");
+							return NULL;
+						}
+						sprintf(*v, "%"PRId32, c->space[i->idx_name__space]->expire_field);
+						snprintf(buf, PRINTBUFLEN-1, "space[%d].expire_field", i->idx_name__space);
+						i->state = S_name__space__field_types;
+						return buf;
+					case S_name__space__field_types:
+						*v = (c->space[i->idx_name__space]->field_types) ? strdup(c->space[i->idx_name__space]->field_types) : NULL;
+						if (*v == NULL && c->space[i->idx_name__space]->field_types) {
+							free(i);
+							out_warning(CNF_NOMEMORY, "No memory to output value");
+							return NULL;
+						}
+						snprintf(buf, PRINTBUFLEN-1, "space[%d].field_types", i->idx_name__space);
 						i->state = S_name__space__index;
 						return buf;
 					case S_name__space__index:
@@ -1951,13 +2968,18 @@ dup_tarantool_cfg(tarantool_cfg* dst, tarantool_cfg* src) {
 	dst->coredump = src->coredump;
 	dst->admin_port = src->admin_port;
 	dst->replication_port = src->replication_port;
+	dst->replication_ring_size = src->replication_ring_size;
 	dst->log_level = src->log_level;
 	dst->slab_alloc_arena = src->slab_alloc_arena;
 	dst->slab_alloc_minimal = src->slab_alloc_minimal;
 	dst->slab_alloc_factor = src->slab_alloc_factor;
+	dst->slab_alloc_huge_pages = src->slab_alloc_huge_pages;
+	dst->slab_alloc_prefault = src->slab_alloc_prefault;
+	dst->slab_reclaim_delay = src->slab_reclaim_delay;
 	if (dst->work_dir) free(dst->work_dir);dst->work_dir = src->work_dir == NULL ? NULL : strdup(src->work_dir);
 	if (src->work_dir != NULL && dst->work_dir == NULL)
 		return CNF_NOMEMORY;
+	dst->shards = src->shards;
 	if (dst->pid_file) free(dst->pid_file);dst->pid_file = src->pid_file == NULL ? NULL : strdup(src->pid_file);
 	if (src->pid_file != NULL && dst->pid_file == NULL)
 		return CNF_NOMEMORY;
@@ -1968,6 +2990,10 @@ dup_tarantool_cfg(tarantool_cfg* dst, tarantool_cfg* src) {
 	dst->io_collect_interval = src->io_collect_interval;
 	dst->backlog = src->backlog;
 	dst->readahead = src->readahead;
+	dst->io_uring = src->io_uring;
+	dst->fiber_stack_size = src->fiber_stack_size;
+	dst->fiber_stat = src->fiber_stat;
+	dst->stall_threshold = src->stall_threshold;
 	if (dst->snap_dir) free(dst->snap_dir);dst->snap_dir = src->snap_dir == NULL ? NULL : strdup(src->snap_dir);
 	if (src->snap_dir != NULL && dst->snap_dir == NULL)
 		return CNF_NOMEMORY;
@@ -1976,6 +3002,9 @@ dup_tarantool_cfg(tarantool_cfg* dst, tarantool_cfg* src) {
 		return CNF_NOMEMORY;
 	dst->primary_port = src->primary_port;
 	dst->secondary_port = src->secondary_port;
+	dst->iproto_threads = src->iproto_threads;
+	dst->iproto_inflight_limit = src->iproto_inflight_limit;
+	dst->iproto_lazy_fibers = src->iproto_lazy_fibers;
 	dst->too_long_threshold = src->too_long_threshold;
 	if (dst->custom_proc_title) free(dst->custom_proc_title);dst->custom_proc_title = src->custom_proc_title == NULL ? NULL : strdup(src->custom_proc_title);
 	if (src->custom_proc_title != NULL && dst->custom_proc_title == NULL)
@@ -1985,6 +3014,13 @@ dup_tarantool_cfg(tarantool_cfg* dst, tarantool_cfg* src) {
 	dst->memcached_expire = src->memcached_expire;
 	dst->memcached_expire_per_loop = src->memcached_expire_per_loop;
 	dst->memcached_expire_full_sweep = src->memcached_expire_full_sweep;
+	dst->memcached_eviction = src->memcached_eviction;
+	dst->memcached_memory_limit = src->memcached_memory_limit;
+	dst->compact_threshold = src->compact_threshold;
+	dst->compact_interval = src->compact_interval;
+	dst->compact_per_loop = src->compact_per_loop;
+	dst->expire_per_loop = src->expire_per_loop;
+	dst->expire_rate_limit = src->expire_rate_limit;
 	dst->snap_io_rate_limit = src->snap_io_rate_limit;
 	dst->rows_per_wal = src->rows_per_wal;
 	dst->wal_fsync_delay = src->wal_fsync_delay;
@@ -1993,6 +3029,11 @@ dup_tarantool_cfg(tarantool_cfg* dst, tarantool_cfg* src) {
 	dst->wal_dir_rescan_delay = src->wal_dir_rescan_delay;
 	dst->panic_on_snap_error = src->panic_on_snap_error;
 	dst->panic_on_wal_error = src->panic_on_wal_error;
+	dst->replication_batching = src->replication_batching;
+	dst->replication_compression = src->replication_compression;
+	dst->replication_ack = src->replication_ack;
+	dst->replication_sync_quorum = src->replication_sync_quorum;
+	dst->replication_sync_timeout = src->replication_sync_timeout;
 	if (dst->replication_source) free(dst->replication_source);dst->replication_source = src->replication_source == NULL ? NULL : strdup(src->replication_source);
 	if (src->replication_source != NULL && dst->replication_source == NULL)
 		return CNF_NOMEMORY;
@@ -2008,6 +3049,12 @@ dup_tarantool_cfg(tarantool_cfg* dst, tarantool_cfg* src) {
 			dst->space[i->idx_name__space]->enabled = src->space[i->idx_name__space]->enabled;
 			dst->space[i->idx_name__space]->cardinality = src->space[i->idx_name__space]->cardinality;
 			dst->space[i->idx_name__space]->estimated_rows = src->space[i->idx_name__space]->estimated_rows;
+			dst->space[i->idx_name__space]->sync = src->space[i->idx_name__space]->sync;
+			dst->space[i->idx_name__space]->memory_limit = src->space[i->idx_name__space]->memory_limit;
+			dst->space[i->idx_name__space]->expire_field = src->space[i->idx_name__space]->expire_field;
+			if (dst->space[i->idx_name__space]->field_types) free(dst->space[i->idx_name__space]->field_types);dst->space[i->idx_name__space]->field_types = src->space[i->idx_name__space]->field_types == NULL ? NULL : strdup(src->space[i->idx_name__space]->field_types);
+			if (src->space[i->idx_name__space]->field_types != NULL && dst->space[i->idx_name__space]->field_types == NULL)
+				return CNF_NOMEMORY;
 
 			dst->space[i->idx_name__space]->index = NULL;
 			if (src->space[i->idx_name__space]->index != NULL) {
@@ -2078,6 +3125,8 @@ destroy_tarantool_cfg(tarantool_cfg* c) {
 	if (c->space != NULL) {
 		i->idx_name__space = 0;
 		while (c->space[i->idx_name__space] != NULL) {
+			if (c->space[i->idx_name__space]->field_types != NULL)
+				free(c->space[i->idx_name__space]->field_types);
 
 			if (c->space[i->idx_name__space]->index != NULL) {
 				i->idx_name__space__index = 0;
@@ -2160,6 +3209,11 @@ cmp_tarantool_cfg(tarantool_cfg* c1, tarantool_cfg* c2, int only_check_rdonly) {
 
 		return diff;
 	}
+	if (c1->replication_ring_size != c2->replication_ring_size) {
+		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->replication_ring_size");
+
+		return diff;
+	}
 	if (!only_check_rdonly) {
 		if (c1->log_level != c2->log_level) {
 			snprintf(diff, PRINTBUFLEN - 1, "%s", "c->log_level");
@@ -2182,11 +3236,31 @@ cmp_tarantool_cfg(tarantool_cfg* c1, tarantool_cfg* c2, int only_check_rdonly) {
 
 		return diff;
 	}
+	if (c1->slab_alloc_huge_pages != c2->slab_alloc_huge_pages) {
+		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->slab_alloc_huge_pages");
+
+		return diff;
+	}
+	if (c1->slab_alloc_prefault != c2->slab_alloc_prefault) {
+		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->slab_alloc_prefault");
+
+		return diff;
+	}
+	if (c1->slab_reclaim_delay != c2->slab_reclaim_delay) {
+		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->slab_reclaim_delay");
+
+		return diff;
+	}
 	if (confetti_strcmp(c1->work_dir, c2->work_dir) != 0) {
 		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->work_dir");
 
 		return diff;
 }
+	if (c1->shards != c2->shards) {
+		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->shards");
+
+		return diff;
+	}
 	if (confetti_strcmp(c1->pid_file, c2->pid_file) != 0) {
 		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->pid_file");
 
@@ -2219,6 +3293,26 @@ cmp_tarantool_cfg(tarantool_cfg* c1, tarantool_cfg* c2, int only_check_rdonly) {
 			return diff;
 		}
 	}
+	if (c1->io_uring != c2->io_uring) {
+		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->io_uring");
+
+		return diff;
+	}
+	if (c1->fiber_stack_size != c2->fiber_stack_size) {
+		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->fiber_stack_size");
+
+		return diff;
+	}
+	if (c1->fiber_stat != c2->fiber_stat) {
+		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->fiber_stat");
+
+		return diff;
+	}
+	if (c1->stall_threshold != c2->stall_threshold) {
+		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->stall_threshold");
+
+		return diff;
+	}
 	if (confetti_strcmp(c1->snap_dir, c2->snap_dir) != 0) {
 		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->snap_dir");
 
@@ -2239,6 +3333,21 @@ cmp_tarantool_cfg(tarantool_cfg* c1, tarantool_cfg* c2, int only_check_rdonly) {
 
 		return diff;
 	}
+	if (c1->iproto_threads != c2->iproto_threads) {
+		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->iproto_threads");
+
+		return diff;
+	}
+	if (c1->iproto_inflight_limit != c2->iproto_inflight_limit) {
+		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->iproto_inflight_limit");
+
+		return diff;
+	}
+	if (c1->iproto_lazy_fibers != c2->iproto_lazy_fibers) {
+		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->iproto_lazy_fibers");
+
+		return diff;
+	}
 	if (!only_check_rdonly) {
 		if (c1->too_long_threshold != c2->too_long_threshold) {
 			snprintf(diff, PRINTBUFLEN - 1, "%s", "c->too_long_threshold");
@@ -2280,6 +3389,49 @@ cmp_tarantool_cfg(tarantool_cfg* c1, tarantool_cfg* c2, int only_check_rdonly) {
 			return diff;
 		}
 	}
+	if (c1->memcached_eviction != c2->memcached_eviction) {
+		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->memcached_eviction");
+
+		return diff;
+	}
+	if (c1->memcached_memory_limit != c2->memcached_memory_limit) {
+		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->memcached_memory_limit");
+
+		return diff;
+	}
+	if (c1->compact_threshold != c2->compact_threshold) {
+		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->compact_threshold");
+
+		return diff;
+	}
+	if (!only_check_rdonly) {
+		if (c1->compact_interval != c2->compact_interval) {
+			snprintf(diff, PRINTBUFLEN - 1, "%s", "c->compact_interval");
+
+			return diff;
+		}
+	}
+	if (!only_check_rdonly) {
+		if (c1->compact_per_loop != c2->compact_per_loop) {
+			snprintf(diff, PRINTBUFLEN - 1, "%s", "c->compact_per_loop");
+
+			return diff;
+		}
+	}
+	if (!only_check_rdonly) {
+		if (c1->expire_per_loop != c2->expire_per_loop) {
+			snprintf(diff, PRINTBUFLEN - 1, "%s", "c->expire_per_loop");
+
+			return diff;
+		}
+	}
+	if (!only_check_rdonly) {
+		if (c1->expire_rate_limit != c2->expire_rate_limit) {
+			snprintf(diff, PRINTBUFLEN - 1, "%s", "c->expire_rate_limit");
+
+			return diff;
+		}
+	}
 	if (c1->snap_io_rate_limit != c2->snap_io_rate_limit) {
 		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->snap_io_rate_limit");
 
@@ -2320,6 +3472,35 @@ cmp_tarantool_cfg(tarantool_cfg* c1, tarantool_cfg* c2, int only_check_rdonly) {
 
 		return diff;
 	}
+	if (c1->replication_batching != c2->replication_batching) {
+		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->replication_batching");
+
+		return diff;
+	}
+	if (c1->replication_compression != c2->replication_compression) {
+		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->replication_compression");
+
+		return diff;
+	}
+	if (c1->replication_ack != c2->replication_ack) {
+		snprintf(diff, PRINTBUFLEN - 1, "%s", "c->replication_ack");
+
+		return diff;
+	}
+	if (!only_check_rdonly) {
+		if (c1->replication_sync_quorum != c2->replication_sync_quorum) {
+			snprintf(diff, PRINTBUFLEN - 1, "%s", "c->replication_sync_quorum");
+
+			return diff;
+		}
+	}
+	if (!only_check_rdonly) {
+		if (c1->replication_sync_timeout != c2->replication_sync_timeout) {
+			snprintf(diff, PRINTBUFLEN - 1, "%s", "c->replication_sync_timeout");
+
+			return diff;
+		}
+	}
 	if (!only_check_rdonly) {
 		if (confetti_strcmp(c1->replication_source, c2->replication_source) != 0) {
 			snprintf(diff, PRINTBUFLEN - 1, "%s", "c->replication_source");
@@ -2346,6 +3527,26 @@ cmp_tarantool_cfg(tarantool_cfg* c1, tarantool_cfg* c2, int only_check_rdonly) {
 
 			return diff;
 		}
+		if (c1->space[i1->idx_name__space]->sync != c2->space[i2->idx_name__space]->sync) {
+			snprintf(diff, PRINTBUFLEN - 1, "%s", "c->space[]->sync");
+
+			return diff;
+		}
+		if (c1->space[i1->idx_name__space]->memory_limit != c2->space[i2->idx_name__space]->memory_limit) {
+			snprintf(diff, PRINTBUFLEN - 1, "%s", "c->space[]->memory_limit");
+
+			return diff;
+		}
+		if (c1->space[i1->idx_name__space]->expire_field != c2->space[i2->idx_name__space]->expire_field) {
+			snprintf(diff, PRINTBUFLEN - 1, "%s", "c->space[]->expire_field");
+
+			return diff;
+		}
+		if (confetti_strcmp(c1->space[i1->idx_name__space]->field_types, c2->space[i2->idx_name__space]->field_types) != 0) {
+			snprintf(diff, PRINTBUFLEN - 1, "%s", "c->space[]->field_types");
+
+			return diff;
+}
 
 		i1->idx_name__space__index = 0;
 		i2->idx_name__space__index = 0;
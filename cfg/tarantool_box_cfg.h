@@ -34,6 +34,10 @@ typedef struct tarantool_cfg_space {
 	confetti_bool_t	enabled;
 	int32_t	cardinality;
 	int32_t	estimated_rows;
+	confetti_bool_t	sync;
+	int32_t	memory_limit;
+	int32_t	expire_field;
+	char*	field_types;
 	tarantool_cfg_space_index**	index;
 } tarantool_cfg_space;
 
@@ -65,6 +69,12 @@ typedef struct tarantool_cfg {
 	/* Replication clients should use this port (bind_ipaddr:replication_port). */
 	int32_t	replication_port;
 
+	/*
+	 * Number of most recent WAL rows the master keeps in memory
+	 * to feed replicas without re-reading xlog files.
+	 */
+	int32_t	replication_ring_size;
+
 	/* Log verbosity, possible values: ERROR=1, CRIT=2, WARN=3, INFO=4(default), DEBUG=5 */
 	int32_t	log_level;
 
@@ -77,9 +87,39 @@ typedef struct tarantool_cfg {
 	/* Growth factor, each subsequent unit size is factor * prev unit size */
 	double	slab_alloc_factor;
 
+	/*
+	 * Back the slab arena with explicit huge pages of the given
+	 * size in megabytes (2 or 1024). If the huge page pool can't
+	 * satisfy the request, the arena falls back to transparent
+	 * huge pages. 0 uses regular pages.
+	 */
+	int32_t	slab_alloc_huge_pages;
+
+	/*
+	 * Touch every page of the slab arena at startup, so that
+	 * memory is committed up front rather than on first use
+	 */
+	confetti_bool_t	slab_alloc_prefault;
+
+	/*
+	 * Give the memory of slabs which stay empty for longer than this
+	 * many seconds back to the OS (madvise(MADV_DONTNEED)).
+	 * 0 disables.
+	 */
+	double	slab_reclaim_delay;
+
 	/* working directory (daemon will chdir(2) to it) */
 	char*	work_dir;
 
+	/*
+	 * Number of shards to partition the data across. Every shard is
+	 * a process with its own slab arena, WAL and snapshots, which are
+	 * kept in work_dir/shard_<no>. The main process routes requests
+	 * to shards by the first field of the primary key. 0 disables
+	 * sharding.
+	 */
+	int32_t	shards;
+
 	/* name of pid file */
 	char*	pid_file;
 
@@ -103,6 +143,34 @@ typedef struct tarantool_cfg {
 	/* network io readahead */
 	int32_t	readahead;
 
+	/*
+	 * Do client socket I/O through io_uring, batching the submissions
+	 * of all fibers once per event loop iteration. Falls back to libev
+	 * if the kernel doesn't support it. Linux only.
+	 */
+	confetti_bool_t	io_uring;
+
+	/*
+	 * The default size of a fiber stack, in bytes. Stacks are
+	 * protected with a guard page, so an overflow crashes the server
+	 * with a diagnostic rather than corrupting memory.
+	 */
+	int32_t	fiber_stack_size;
+
+	/*
+	 * Account the run time of every fiber, its longest run without
+	 * a yield and how long it waits to run once woken up, and show
+	 * them in "show fiber".
+	 */
+	confetti_bool_t	fiber_stat;
+
+	/*
+	 * Record the fiber and its backtrace when the event loop doesn't
+	 * get back to polling for longer than this, in seconds, see
+	 * "show stall". 0 disables the detector. Linux only.
+	 */
+	double	stall_threshold;
+
 	/*
 	 * # BOX
 	 * Snapshot directory (where snapshots get saved/read)
@@ -118,6 +186,30 @@ typedef struct tarantool_cfg {
 	/* Secondary port (where only selects are accepted) */
 	int32_t	secondary_port;
 
+	/*
+	 * The number of network threads, which read requests from and write
+	 * replies to primary and secondary port clients. Requests are still
+	 * executed by the main thread. 0 means the main thread does the
+	 * network I/O, too. Linux only.
+	 */
+	int32_t	iproto_threads;
+
+	/*
+	 * The number of requests of one connection which may execute at
+	 * once. Replies are sent as soon as they are ready, possibly out
+	 * of order, and are matched to requests by sync. 1 means requests
+	 * are executed and replied to one after another.
+	 */
+	int32_t	iproto_inflight_limit;
+
+	/*
+	 * Don't keep a fiber, and its stack, for an idle connection. The
+	 * socket is watched by the event loop, and a fiber is taken only
+	 * to execute requests which have arrived in full. Can't be used
+	 * with iproto_threads or iproto_inflight_limit.
+	 */
+	confetti_bool_t	iproto_lazy_fibers;
+
 	/* Warn about requests which take longer to process, in seconds. */
 	double	too_long_threshold;
 
@@ -139,9 +231,52 @@ typedef struct tarantool_cfg {
 	/* maximum rows to consider per expire loop iteration */
 	int32_t	memcached_expire_per_loop;
 
-	/* tarantool will try to iterate over all rows within this time */
+	/*
+	 * tarantool will try to iterate over all rows within this time
+	 * when it builds the expiration index at start
+	 */
 	double	memcached_expire_full_sweep;
 
+	/*
+	 * When memory runs out, make room for a new memcached entry by
+	 * evicting the least recently used ones of the same size class.
+	 */
+	confetti_bool_t	memcached_eviction;
+
+	/*
+	 * Memory limit of memcached_space, in megabytes, 0 for none.
+	 * With memcached_eviction, entries are evicted to stay within it.
+	 */
+	int32_t	memcached_memory_limit;
+
+	/*
+	 * Move tuples out of the slabs filled less than this fraction
+	 * (up to 0.9) into denser ones, so that the emptied slabs can be
+	 * reused by any size class. 0 disables compaction.
+	 */
+	double	compact_threshold;
+
+	/* Seconds between compaction passes */
+	double	compact_interval;
+
+	/*
+	 * Tuples to visit before yielding to other fibers during
+	 * a compaction pass
+	 */
+	int32_t	compact_per_loop;
+
+	/*
+	 * Expired tuples of spaces with expire_field to delete before
+	 * waiting for the deletes to be written to the WAL
+	 */
+	int32_t	expire_per_loop;
+
+	/*
+	 * Delete no more than this many expired tuples a second, 0 is
+	 * unlimited
+	 */
+	int32_t	expire_rate_limit;
+
 	/* Do not write into snapshot faster than snap_io_rate_limit MB/sec */
 	double	snap_io_rate_limit;
 
@@ -180,6 +315,39 @@ typedef struct tarantool_cfg {
 	confetti_bool_t	panic_on_snap_error;
 	confetti_bool_t	panic_on_wal_error;
 
+	/*
+	 * Ask the replication master to send rows in batches.
+	 * Requires a master which supports it.
+	 */
+	confetti_bool_t	replication_batching;
+
+	/*
+	 * Ask the replication master to compress batches of rows.
+	 * Implies replication_batching.
+	 */
+	confetti_bool_t	replication_compression;
+
+	/*
+	 * Acknowledge rows written to the local WAL to the replication
+	 * master, so that the master could count this replica in
+	 * replication_sync_quorum. Requires a master which supports it.
+	 */
+	confetti_bool_t	replication_ack;
+
+	/*
+	 * The number of replicas which must acknowledge a change in a
+	 * synchronous space or with a synchronous request before the
+	 * change is reported as committed. 0 disables the wait.
+	 */
+	int32_t	replication_sync_quorum;
+
+	/*
+	 * How long to wait for replication_sync_quorum replicas, in
+	 * seconds. On timeout, the change stays committed locally but
+	 * the client gets an error.
+	 */
+	double	replication_sync_timeout;
+
 	/*
 	 * Replication mode (if enabled, the server, once
 	 * bound to the primary port, will connect to
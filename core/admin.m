@@ -36,6 +36,7 @@
 #include <palloc.h>
 #include <salloc.h>
 #include <say.h>
+#include <stall.h>
 #include <stat.h>
 #include <tarantool.h>
 #include TARANTOOL_CONFIG
@@ -55,6 +56,7 @@ static const char *help =
 	" - show slab" CRLF
 	" - show palloc" CRLF
 	" - show stat" CRLF
+	" - show stall" CRLF
 	" - save coredump" CRLF
 	" - save snapshot" CRLF
 	" - lua command" CRLF
@@ -64,15 +66,15 @@ static const char *help =
 static const char *unknown_command = "unknown command. try typing help." CRLF;
 
 
-#line 68 "core/admin.m"
+#line 70 "core/admin.m"
 static const int admin_start = 1;
-static const int admin_first_final = 108;
+static const int admin_first_final = 110;
 static const int admin_error = 0;
 
 static const int admin_en_main = 1;
 
 
-#line 67 "core/admin.rl"
+#line 69 "core/admin.rl"
 
 
 
@@ -133,12 +135,12 @@ admin_dispatch(lua_State *L)
 	p = fiber->rbuf->data;
 
 	
-#line 137 "core/admin.m"
+#line 139 "core/admin.m"
 	{
 	cs = admin_start;
 	}
 
-#line 142 "core/admin.m"
+#line 144 "core/admin.m"
 	{
 	if ( p == pe )
 		goto _test_eof;
@@ -201,47 +203,47 @@ case 6:
 	}
 	goto st0;
 tr13:
-#line 208 "core/admin.rl"
+#line 212 "core/admin.rl"
 	{slab_validate(); ok(out);}
-	goto st108;
+	goto st110;
 tr20:
-#line 198 "core/admin.rl"
+#line 201 "core/admin.rl"
 	{return 0;}
-	goto st108;
+	goto st110;
 tr25:
-#line 145 "core/admin.rl"
+#line 147 "core/admin.rl"
 	{
 			start(out);
 			tbuf_append(out, help, strlen(help));
 			end(out);
 		}
-	goto st108;
+	goto st110;
 tr36:
-#line 193 "core/admin.rl"
+#line 196 "core/admin.rl"
 	{strend = p;}
-#line 151 "core/admin.rl"
+#line 153 "core/admin.rl"
 	{
 			strstart[strend-strstart]='\0';
 			start(out);
 			tarantool_lua(L, out, strstart);
 			end(out);
 		}
-	goto st108;
+	goto st110;
 tr43:
-#line 158 "core/admin.rl"
+#line 160 "core/admin.rl"
 	{
 			if (reload_cfg(err))
 				fail(out, err);
 			else
 				ok(out);
 		}
-	goto st108;
+	goto st110;
 tr66:
-#line 206 "core/admin.rl"
+#line 210 "core/admin.rl"
 	{coredump(60); ok(out);}
-	goto st108;
+	goto st110;
 tr75:
-#line 165 "core/admin.rl"
+#line 167 "core/admin.rl"
 	{
 			int ret = snapshot(NULL, 0);
 
@@ -254,9 +256,9 @@ tr75:
 				fail(out, err);
 			}
 		}
-	goto st108;
+	goto st110;
 tr92:
-#line 127 "core/admin.rl"
+#line 129 "core/admin.rl"
 	{
 			tarantool_cfg_iterator_t *i;
 			char *key, *value;
@@ -274,43 +276,47 @@ tr92:
 			}
 			end(out);
 		}
-	goto st108;
+	goto st110;
 tr106:
-#line 201 "core/admin.rl"
+#line 204 "core/admin.rl"
 	{start(out); fiber_info(out); end(out);}
-	goto st108;
+	goto st110;
 tr112:
-#line 200 "core/admin.rl"
+#line 203 "core/admin.rl"
 	{start(out); tarantool_info(out); end(out);}
-	goto st108;
+	goto st110;
 tr117:
-#line 204 "core/admin.rl"
+#line 207 "core/admin.rl"
 	{start(out); palloc_stat(out); end(out);}
-	goto st108;
+	goto st110;
 tr125:
-#line 203 "core/admin.rl"
-	{start(out); slab_stat(out); end(out);}
-	goto st108;
+#line 206 "core/admin.rl"
+	{start(out); slab_stat(out); mod_slab_stat(out); end(out);}
+	goto st110;
 tr129:
-#line 205 "core/admin.rl"
+#line 208 "core/admin.rl"
 	{start(out); stat_print(out);end(out);}
-	goto st108;
-st108:
+	goto st110;
+tr133:
+#line 209 "core/admin.rl"
+	{start(out); stall_info(out); end(out);}
+	goto st110;
+st110:
 	if ( ++p == pe )
-		goto _test_eof108;
-case 108:
-#line 303 "core/admin.m"
+		goto _test_eof110;
+case 110:
+#line 309 "core/admin.m"
 	goto st0;
 tr14:
-#line 208 "core/admin.rl"
+#line 212 "core/admin.rl"
 	{slab_validate(); ok(out);}
 	goto st7;
 tr21:
-#line 198 "core/admin.rl"
+#line 201 "core/admin.rl"
 	{return 0;}
 	goto st7;
 tr26:
-#line 145 "core/admin.rl"
+#line 147 "core/admin.rl"
 	{
 			start(out);
 			tbuf_append(out, help, strlen(help));
@@ -318,9 +324,9 @@ tr26:
 		}
 	goto st7;
 tr37:
-#line 193 "core/admin.rl"
+#line 196 "core/admin.rl"
 	{strend = p;}
-#line 151 "core/admin.rl"
+#line 153 "core/admin.rl"
 	{
 			strstart[strend-strstart]='\0';
 			start(out);
@@ -329,7 +335,7 @@ tr37:
 		}
 	goto st7;
 tr44:
-#line 158 "core/admin.rl"
+#line 160 "core/admin.rl"
 	{
 			if (reload_cfg(err))
 				fail(out, err);
@@ -338,11 +344,11 @@ tr44:
 		}
 	goto st7;
 tr67:
-#line 206 "core/admin.rl"
+#line 210 "core/admin.rl"
 	{coredump(60); ok(out);}
 	goto st7;
 tr76:
-#line 165 "core/admin.rl"
+#line 167 "core/admin.rl"
 	{
 			int ret = snapshot(NULL, 0);
 
@@ -357,7 +363,7 @@ tr76:
 		}
 	goto st7;
 tr93:
-#line 127 "core/admin.rl"
+#line 129 "core/admin.rl"
 	{
 			tarantool_cfg_iterator_t *i;
 			char *key, *value;
@@ -377,32 +383,36 @@ tr93:
 		}
 	goto st7;
 tr107:
-#line 201 "core/admin.rl"
+#line 204 "core/admin.rl"
 	{start(out); fiber_info(out); end(out);}
 	goto st7;
 tr113:
-#line 200 "core/admin.rl"
+#line 203 "core/admin.rl"
 	{start(out); tarantool_info(out); end(out);}
 	goto st7;
 tr118:
-#line 204 "core/admin.rl"
+#line 207 "core/admin.rl"
 	{start(out); palloc_stat(out); end(out);}
 	goto st7;
 tr126:
-#line 203 "core/admin.rl"
-	{start(out); slab_stat(out); end(out);}
+#line 206 "core/admin.rl"
+	{start(out); slab_stat(out); mod_slab_stat(out); end(out);}
 	goto st7;
 tr130:
-#line 205 "core/admin.rl"
+#line 208 "core/admin.rl"
 	{start(out); stat_print(out);end(out);}
 	goto st7;
+tr134:
+#line 209 "core/admin.rl"
+	{start(out); stall_info(out); end(out);}
+	goto st7;
 st7:
 	if ( ++p == pe )
 		goto _test_eof7;
 case 7:
-#line 404 "core/admin.m"
+#line 414 "core/admin.m"
 	if ( (*p) == 10 )
-		goto st108;
+		goto st110;
 	goto st0;
 st8:
 	if ( ++p == pe )
@@ -553,28 +563,28 @@ case 23:
 	}
 	goto tr33;
 tr33:
-#line 193 "core/admin.rl"
+#line 196 "core/admin.rl"
 	{strstart = p;}
 	goto st24;
 st24:
 	if ( ++p == pe )
 		goto _test_eof24;
 case 24:
-#line 564 "core/admin.m"
+#line 574 "core/admin.m"
 	switch( (*p) ) {
 		case 10: goto tr36;
 		case 13: goto tr37;
 	}
 	goto st24;
 tr34:
-#line 193 "core/admin.rl"
+#line 196 "core/admin.rl"
 	{strstart = p;}
 	goto st25;
 st25:
 	if ( ++p == pe )
 		goto _test_eof25;
 case 25:
-#line 578 "core/admin.m"
+#line 588 "core/admin.m"
 	switch( (*p) ) {
 		case 10: goto tr36;
 		case 13: goto tr37;
@@ -985,7 +995,7 @@ st69:
 case 69:
 	switch( (*p) ) {
 		case 32: goto st70;
-		case 111: goto st106;
+		case 111: goto st108;
 	}
 	goto st0;
 st70:
@@ -1320,7 +1330,8 @@ case 104:
 	switch( (*p) ) {
 		case 10: goto tr129;
 		case 13: goto tr130;
-		case 116: goto st105;
+		case 108: goto st105;
+		case 116: goto st107;
 	}
 	goto st0;
 st105:
@@ -1328,8 +1339,9 @@ st105:
 		goto _test_eof105;
 case 105:
 	switch( (*p) ) {
-		case 10: goto tr129;
-		case 13: goto tr130;
+		case 10: goto tr133;
+		case 13: goto tr134;
+		case 108: goto st106;
 	}
 	goto st0;
 st106:
@@ -1337,14 +1349,32 @@ st106:
 		goto _test_eof106;
 case 106:
 	switch( (*p) ) {
-		case 32: goto st70;
-		case 119: goto st107;
+		case 10: goto tr133;
+		case 13: goto tr134;
 	}
 	goto st0;
 st107:
 	if ( ++p == pe )
 		goto _test_eof107;
 case 107:
+	switch( (*p) ) {
+		case 10: goto tr129;
+		case 13: goto tr130;
+	}
+	goto st0;
+st108:
+	if ( ++p == pe )
+		goto _test_eof108;
+case 108:
+	switch( (*p) ) {
+		case 32: goto st70;
+		case 119: goto st109;
+	}
+	goto st0;
+st109:
+	if ( ++p == pe )
+		goto _test_eof109;
+case 109:
 	if ( (*p) == 32 )
 		goto st70;
 	goto st0;
@@ -1354,7 +1384,7 @@ case 107:
 	_test_eof4: cs = 4; goto _test_eof; 
 	_test_eof5: cs = 5; goto _test_eof; 
 	_test_eof6: cs = 6; goto _test_eof; 
-	_test_eof108: cs = 108; goto _test_eof; 
+	_test_eof110: cs = 110; goto _test_eof; 
 	_test_eof7: cs = 7; goto _test_eof; 
 	_test_eof8: cs = 8; goto _test_eof; 
 	_test_eof9: cs = 9; goto _test_eof; 
@@ -1456,12 +1486,14 @@ case 107:
 	_test_eof105: cs = 105; goto _test_eof; 
 	_test_eof106: cs = 106; goto _test_eof; 
 	_test_eof107: cs = 107; goto _test_eof; 
+	_test_eof108: cs = 108; goto _test_eof; 
+	_test_eof109: cs = 109; goto _test_eof; 
 
 	_test_eof: {}
 	_out: {}
 	}
 
-#line 214 "core/admin.rl"
+#line 218 "core/admin.rl"
 
 
 	tbuf_ltrim(fiber->rbuf, (void *)pe - (void *)fiber->rbuf->data);
@@ -1496,8 +1528,13 @@ admin_handler(void *data __attribute__((unused)))
 int
 admin_init(void)
 {
-	if (fiber_server("admin", cfg.admin_port, admin_handler, NULL, NULL) == NULL) {
-		say_syserror("can't bind to %d", cfg.admin_port);
+	int port = cfg.admin_port;
+	/* Shards listen next to the router, see cfg.shards. */
+	if (shard_no >= 0 && port != 0)
+		port += shard_no + 1;
+
+	if (fiber_server("admin", port, admin_handler, NULL, NULL) == NULL) {
+		say_syserror("can't bind to %d", port);
 		return -1;
 	}
 	return 0;
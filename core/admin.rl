@@ -34,6 +34,7 @@
 #include <palloc.h>
 #include <salloc.h>
 #include <say.h>
+#include <stall.h>
 #include <stat.h>
 #include <tarantool.h>
 #include TARANTOOL_CONFIG
@@ -53,6 +54,7 @@ static const char *help =
 	" - show slab" CRLF
 	" - show palloc" CRLF
 	" - show stat" CRLF
+	" - show stall" CRLF
 	" - save coredump" CRLF
 	" - save snapshot" CRLF
 	" - lua command" CRLF
@@ -185,6 +187,7 @@ admin_dispatch(lua_State *L)
 		mod = "mo"("d")?;
 		palloc = "pa"("l"("l"("o"("c")?)?)?)?;
 		stat = "st"("a"("t")?)?;
+		stall = "stal"("l")?;
 		help = "h"("e"("l"("p")?)?)?;
 		exit = "e"("x"("i"("t")?)?)? | "q"("u"("i"("t")?)?)?;
 		save = "sa"("v"("e")?)?;
@@ -200,9 +203,10 @@ admin_dispatch(lua_State *L)
 			    show " "+ info		%{start(out); tarantool_info(out); end(out);}		|
 			    show " "+ fiber		%{start(out); fiber_info(out); end(out);}	|
 			    show " "+ configuration 	%show_configuration				|
-			    show " "+ slab		%{start(out); slab_stat(out); end(out);}	|
+			    show " "+ slab		%{start(out); slab_stat(out); mod_slab_stat(out); end(out);}	|
 			    show " "+ palloc		%{start(out); palloc_stat(out); end(out);}	|
 			    show " "+ stat		%{start(out); stat_print(out);end(out);}	|
+			    show " "+ stall		%{start(out); stall_info(out); end(out);}	|
 			    save " "+ coredump		%{coredump(60); ok(out);}			|
 			    save " "+ snapshot		%save_snapshot					|
 			    check " "+ slab		%{slab_validate(); ok(out);}			|
@@ -245,8 +249,13 @@ admin_handler(void *data __attribute__((unused)))
 int
 admin_init(void)
 {
-	if (fiber_server("admin", cfg.admin_port, admin_handler, NULL, NULL) == NULL) {
-		say_syserror("can't bind to %d", cfg.admin_port);
+	int port = cfg.admin_port;
+	/* Shards listen next to the router, see cfg.shards. */
+	if (shard_no >= 0 && port != 0)
+		port += shard_no + 1;
+
+	if (fiber_server("admin", port, admin_handler, NULL, NULL) == NULL) {
+		say_syserror("can't bind to %d", port);
 		return -1;
 	}
 	return 0;
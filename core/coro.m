@@ -34,11 +34,100 @@
 #include "third_party/valgrind/memcheck.h"
 
 #include <palloc.h>
+#include <util.h>
+
+/*
+ * Coroutine stacks are mmap()ed with a PROT_NONE guard page below
+ * the stack, so that an overflow faults instead of silently
+ * overwriting the neighbouring memory, see tarantool_coro_guard().
+ *
+ * Stacks of the default size are not unmapped when a coroutine
+ * is destroyed, but kept in a pool for the next coroutine, so
+ * that the pages, already faulted in, are reused without any
+ * system calls. A free stack is linked into the pool through
+ * its first bytes. Such a stack is pre-faulted when it's mapped,
+ * so that a fiber never takes a page fault on its stack in the
+ * middle of a request.
+ */
+
+enum { CORO_STACK_POOL_MAX = 64 };
+
+static size_t coro_page_size;
+static size_t coro_stack_size;
+static void *coro_stack_pool;
+static int coro_stack_pool_size;
+
+static size_t
+coro_page_align(size_t size)
+{
+	return (size + coro_page_size - 1) & ~(coro_page_size - 1);
+}
+
+void
+tarantool_coro_init(size_t stack_size)
+{
+	coro_page_size = sysconf(_SC_PAGESIZE);
+	if (stack_size == 0)
+		stack_size = TARANTOOL_CORO_STACK_SIZE;
+	coro_stack_size = coro_page_align(stack_size);
+}
+
+static void *
+coro_stack_alloc(size_t stack_size)
+{
+	if (stack_size == coro_stack_size && coro_stack_pool != NULL) {
+		void *stack = coro_stack_pool;
+		coro_stack_pool = *(void **) stack;
+		coro_stack_pool_size--;
+		return stack;
+	}
+
+	char *map = mmap(0, stack_size + coro_page_size,
+			 PROT_READ | PROT_WRITE | PROT_EXEC,
+			 MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (map == MAP_FAILED)
+		return NULL;
+
+	/* The stack grows down: the guard page is the lowest one. */
+	if (mprotect(map, coro_page_size, PROT_NONE) != 0) {
+		munmap(map, stack_size + coro_page_size);
+		return NULL;
+	}
+	char *stack = map + coro_page_size;
+
+	/* Touch every page above the guard once: it goes to the pool. */
+	if (stack_size == coro_stack_size) {
+		for (size_t offset = 0; offset < stack_size; offset += coro_page_size)
+			stack[offset] = 0;
+	}
+	return stack;
+}
+
+static void
+coro_stack_free(void *stack, size_t stack_size)
+{
+	if (stack_size == coro_stack_size &&
+	    coro_stack_pool_size < CORO_STACK_POOL_MAX) {
+		*(void **) stack = coro_stack_pool;
+		coro_stack_pool = stack;
+		coro_stack_pool_size++;
+		return;
+	}
+	munmap((char *) stack - coro_page_size, stack_size + coro_page_size);
+}
 
 struct tarantool_coro *
 tarantool_coro_create(struct tarantool_coro *coro, void (*f) (void *), void *data)
 {
-	const int page = sysconf(_SC_PAGESIZE);
+	return tarantool_coro_create_stack(coro, f, data, 0);
+}
+
+struct tarantool_coro *
+tarantool_coro_create_stack(struct tarantool_coro *coro, void (*f) (void *),
+			    void *data, size_t stack_size)
+{
+	if (coro_stack_size == 0)
+		tarantool_coro_init(0);
 
 	if (coro == NULL)
 		coro = palloc(eter_pool, sizeof(*coro));
@@ -48,15 +137,14 @@ tarantool_coro_create(struct tarantool_coro *coro, void (*f) (void *), void *dat
 
 	memset(coro, 0, sizeof(*coro));
 
-	/* TODO: guard pages */
-	coro->stack_size = page * 16;
-	coro->stack = mmap(0, coro->stack_size, PROT_READ | PROT_WRITE | PROT_EXEC,
-			   MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	coro->stack_size = MAX(coro_page_align(stack_size), coro_stack_size);
+	coro->stack = coro_stack_alloc(coro->stack_size);
 
-	if (coro->stack == MAP_FAILED)
+	if (coro->stack == NULL)
 		return NULL;
 
-	VALGRIND_STACK_REGISTER(coro->stack, coro->stack + coro->stack_size);
+	coro->valgrind_id =
+		VALGRIND_STACK_REGISTER(coro->stack, coro->stack + coro->stack_size);
 
 	coro_create(&coro->ctx, f, data, coro->stack, coro->stack_size);
 
@@ -66,6 +154,17 @@ tarantool_coro_create(struct tarantool_coro *coro, void (*f) (void *), void *dat
 void
 tarantool_coro_destroy(struct tarantool_coro *coro)
 {
-	if (coro->stack != NULL && coro->stack != MAP_FAILED)
-		munmap(coro->stack, coro->stack_size);
+	if (coro->stack != NULL) {
+		VALGRIND_STACK_DEREGISTER(coro->valgrind_id);
+		coro_stack_free(coro->stack, coro->stack_size);
+		coro->stack = NULL;
+	}
+}
+
+bool
+tarantool_coro_guard(const struct tarantool_coro *coro, const void *addr)
+{
+	const char *stack = coro->stack;
+	return stack != NULL && (const char *) addr < stack &&
+		(const char *) addr >= stack - coro_page_size;
 }
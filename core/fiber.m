@@ -51,9 +51,11 @@
 #include TARANTOOL_CONFIG
 #include <tarantool_ev.h>
 #include <tbuf.h>
+#include <uring.h>
 #include <util.h>
 #include <stat.h>
 #include <pickle.h>
+#include <cpu_feature.h>
 
 @implementation FiberCancelException
 @end
@@ -102,6 +104,44 @@ update_last_stack_frame(struct fiber *fiber)
 #endif /* ENABLE_BACKTRACE */
 }
 
+static bool fiber_stat_enabled;
+/* The TSC and the time at startup, to calibrate the TSC. */
+static u64 fiber_stat_tsc0;
+static double fiber_stat_time0;
+
+double
+fiber_stat_seconds(u64 tsc)
+{
+	double elapsed = ev_time() - fiber_stat_time0;
+	u64 cycles = cpu_rdtsc() - fiber_stat_tsc0;
+
+	if (elapsed <= 0 || cycles == 0)
+		return 0;
+	return tsc * elapsed / cycles;
+}
+
+/** Account the switch from caller to callee. */
+static inline void
+fiber_stat_switch(struct fiber *caller, struct fiber *callee)
+{
+	u64 now = cpu_rdtsc();
+	u64 slice = now - caller->stat.run_start;
+
+	caller->stat.run_time += slice;
+	if (slice > caller->stat.max_slice)
+		caller->stat.max_slice = slice;
+
+	callee->stat.run_start = now;
+	if (callee->stat.wakeup_start != 0) {
+		u64 latency = now - callee->stat.wakeup_start;
+		callee->stat.wakeups++;
+		callee->stat.wakeup_latency += latency;
+		if (latency > callee->stat.max_wakeup_latency)
+			callee->stat.max_wakeup_latency = latency;
+		callee->stat.wakeup_start = 0;
+	}
+}
+
 /** @retval true if check failed, false otherwise */
 bool
 fiber_checkstack()
@@ -123,6 +163,8 @@ fiber_call(struct fiber *callee)
 	update_last_stack_frame(caller);
 
 	callee->csw++;
+	if (fiber_stat_enabled)
+		fiber_stat_switch(caller, callee);
 	coro_transfer(&caller->coro.ctx, &callee->coro.ctx);
 }
 
@@ -135,6 +177,8 @@ fiber_call(struct fiber *callee)
 void
 fiber_wakeup(struct fiber *f)
 {
+	if (fiber_stat_enabled && f->stat.wakeup_start == 0)
+		f->stat.wakeup_start = cpu_rdtsc();
 	ev_async_start(&f->async);
 	ev_async_send(&f->async);
 }
@@ -248,6 +292,8 @@ fiber_yield(void)
 	update_last_stack_frame(caller);
 
 	callee->csw++;
+	if (fiber_stat_enabled)
+		fiber_stat_switch(caller, callee);
 	coro_transfer(&caller->coro.ctx, &callee->coro.ctx);
 }
 
@@ -258,10 +304,9 @@ fiber_yield(void)
 void
 fiber_sleep(ev_tstamp delay)
 {
-	ev_timer_set(&fiber->timer, delay, 0.);
-	ev_timer_start(&fiber->timer);
+	wheel_timer_start(&fiber->timer, delay);
 	fiber_yield();
-	ev_timer_stop(&fiber->timer);
+	wheel_timer_stop(&fiber->timer);
 	fiber_testcancel();
 }
 
@@ -280,12 +325,24 @@ wait_for_child(pid_t pid)
 }
 
 
+/*
+ * Connection I/O is speculative: fiber_bread() and iov_flush()
+ * read or write first and wait for the socket only on EAGAIN.
+ * After a read, the watcher is left armed, so that a request and
+ * reply round trip needs no watcher changes, and thus no
+ * epoll_ctl() calls. If the socket becomes readable while the
+ * fiber is busy with something else, the watcher is disarmed
+ * instead of waking the fiber up, see fiber_io_ready().
+ */
+
 void
 fiber_io_start(int fd, int events)
 {
 	ev_io *io = &fiber->io;
 
-	assert (!ev_is_active(io));
+	/* Left armed by fiber_bread(). */
+	if (ev_is_active(io))
+		ev_io_stop(io);
 
 	ev_io_set(io, fd, events);
 	ev_io_start(io);
@@ -299,7 +356,9 @@ fiber_io_yield()
 {
 	assert(ev_is_active(&fiber->io));
 
+	fiber->flags |= FIBER_IO_WAIT;
 	fiber_yield();
+	fiber->flags &= ~FIBER_IO_WAIT;
 
 	if (fiber_is_cancelled()) {
 		ev_io_stop(&fiber->io);
@@ -324,6 +383,47 @@ ev_schedule(ev_watcher *watcher, int event __attribute__((unused)))
 	fiber_call(watcher->data);
 }
 
+static void
+fiber_timer_ready(struct wheel_timer *timer)
+{
+	assert(fiber == &sched);
+	fiber_call(timer->data);
+}
+
+static void
+fiber_io_ready(ev_io *io, int event __attribute__((unused)))
+{
+	struct fiber *f = io->data;
+
+	assert(fiber == &sched);
+	if (f->flags & FIBER_IO_WAIT)
+		fiber_call(f);
+	else
+		ev_io_stop(io);
+}
+
+/**
+ * Wait until the socket is ready, arming the watcher unless it's
+ * already armed for the same events.
+ *
+ * @note: this is a cancellation point.
+ */
+
+static void
+fiber_io_wait(int fd, int events)
+{
+	ev_io *io = &fiber->io;
+
+	if (!ev_is_active(io) || io->fd != fd ||
+	    (io->events & (EV_READ | EV_WRITE)) != events) {
+		if (ev_is_active(io))
+			ev_io_stop(io);
+		ev_io_set(io, fd, events);
+		ev_io_start(io);
+	}
+	fiber_io_yield();
+}
+
 struct fiber *
 fiber_find(int fid)
 {
@@ -443,6 +543,8 @@ fiber_zombificate()
 		fiber_wakeup(fiber->waiter);
 	fiber->waiter = NULL;
 	fiber_set_name(fiber, "zombie");
+	if (ev_is_active(&fiber->io))
+		ev_io_stop(&fiber->io);
 	fiber->f = NULL;
 	unregister_fid(fiber);
 	fiber->fid = 0;
@@ -487,24 +589,45 @@ fiber_set_name(struct fiber *fiber, const char *name)
 	snprintf(fiber->name, sizeof(fiber->name), "%s", name);
 }
 
+/** Take a zombie with a stack of at least stack_size bytes. */
+static struct fiber *
+fiber_take_zombie(size_t stack_size)
+{
+	struct fiber *zombie;
+
+	SLIST_FOREACH(zombie, &zombie_fibers, zombie_link) {
+		if (zombie->coro.stack_size >= stack_size) {
+			SLIST_REMOVE(&zombie_fibers, zombie, fiber, zombie_link);
+			return zombie;
+		}
+	}
+	return NULL;
+}
+
 /* fiber never dies, just become zombie */
 struct fiber *
 fiber_create(const char *name, int fd, int inbox_size, void (*f) (void *), void *f_data)
+{
+	return fiber_create_stack(name, 0, fd, inbox_size, f, f_data);
+}
+
+struct fiber *
+fiber_create_stack(const char *name, size_t stack_size, int fd, int inbox_size,
+		   void (*f) (void *), void *f_data)
 {
 	struct fiber *fiber = NULL;
 	if (inbox_size <= 0)
 		inbox_size = 64;
 
-	if (!SLIST_EMPTY(&zombie_fibers)) {
-		fiber = SLIST_FIRST(&zombie_fibers);
-		SLIST_REMOVE_HEAD(&zombie_fibers, zombie_link);
-	} else {
+	fiber = fiber_take_zombie(stack_size);
+	if (fiber == NULL) {
 		fiber = palloc(eter_pool, sizeof(*fiber));
 		if (fiber == NULL)
 			return NULL;
 
 		memset(fiber, 0, sizeof(*fiber));
-		if (tarantool_coro_create(&fiber->coro, fiber_loop, NULL) == NULL)
+		if (tarantool_coro_create_stack(&fiber->coro, fiber_loop, NULL,
+						stack_size) == NULL)
 			return NULL;
 
 		fiber->gc_pool = palloc_create_pool("");
@@ -513,11 +636,11 @@ fiber_create(const char *name, int fd, int inbox_size, void (*f) (void *), void
 		fiber->inbox->size = inbox_size;
 
 		fiber_alloc(fiber);
-		ev_init(&fiber->io, (void *)ev_schedule);
+		ev_init(&fiber->io, fiber_io_ready);
 		ev_async_init(&fiber->async, (void *)ev_schedule);
-		ev_init(&fiber->timer, (void *)ev_schedule);
+		wheel_timer_init(&fiber->timer, fiber_timer_ready, fiber);
 		ev_init(&fiber->cw, (void *)ev_schedule);
-		fiber->io.data = fiber->async.data = fiber->timer.data = fiber->cw.data = fiber;
+		fiber->io.data = fiber->async.data = fiber->cw.data = fiber;
 
 		SLIST_INSERT_HEAD(&fibers, fiber, link);
 	}
@@ -529,6 +652,7 @@ fiber_create(const char *name, int fd, int inbox_size, void (*f) (void *), void
 	fiber->fid = last_used_fid;
 	fiber->flags = 0;
 	fiber->waiter = NULL;
+	memset(&fiber->stat, 0, sizeof(fiber->stat));
 	fiber_set_name(fiber, name);
 	palloc_set_name(fiber->gc_pool, fiber->name);
 	register_fid(fiber);
@@ -693,21 +817,29 @@ fiber_bread(struct tbuf *buf, size_t at_least)
 	tbuf_ensure(buf, MAX(cfg.readahead, at_least));
 	size_t stop_at = buf->size + at_least;
 
-	fiber_io_start(fiber->fd, EV_READ);
+	if (uring_enabled) {
+		while (buf->size < stop_at) {
+			r = uring_read(fiber->fd, buf->data + buf->size,
+				       buf->capacity - buf->size);
+			if (r <= 0)
+				break;
+			buf->size += r;
+		}
+		fiber_testcancel();
+		return r;
+	}
 
 	while (buf->size < stop_at) {
-		fiber_io_yield();
-
 		r = read(fiber->fd, buf->data + buf->size, buf->capacity - buf->size);
-		if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			fiber_io_wait(fiber->fd, EV_READ);
 			continue;
-		else if (r <= 0)
+		} else if (r <= 0)
 			break;
 
 		buf->size += r;
 	}
-	fiber_io_stop(fiber->fd, EV_READ);
-
+	/* The watcher stays armed for the next read. */
 	return r;
 }
 
@@ -729,16 +861,22 @@ iov_flush(void)
 	struct iovec *iov = iovec(fiber->iov);
 	size_t iov_cnt = fiber->iov_cnt;
 
-	fiber_io_start(fiber->fd, EV_WRITE);
+	bool waited = false;
 	while (iov_cnt > 0) {
-		fiber_io_yield();
-		bytes += r = writev(fiber->fd, iov, MIN(iov_cnt, IOV_MAX));
+		/* io_uring waits for the socket itself, never EAGAIN. */
+		if (uring_enabled)
+			r = uring_writev(fiber->fd, iov, MIN(iov_cnt, IOV_MAX));
+		else
+			r = writev(fiber->fd, iov, MIN(iov_cnt, IOV_MAX));
 		if (r <= 0) {
-			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				fiber_io_wait(fiber->fd, EV_WRITE);
+				waited = true;
 				continue;
-			else
+			} else
 				break;
 		}
+		bytes += r;
 
 		while (iov_cnt > 0) {
 			if (iov->iov_len > r) {
@@ -752,7 +890,8 @@ iov_flush(void)
 			}
 		}
 	}
-	fiber_io_stop(fiber->fd, EV_WRITE);
+	if (waited && ev_is_active(&fiber->io))
+		fiber_io_stop(fiber->fd, EV_WRITE);
 
 	if (r < 0) {
 		size_t rem = 0;
@@ -1281,12 +1420,28 @@ fiber_info(struct tbuf *out)
 {
 	struct fiber *fiber;
 
+	if (fiber_stat_enabled)
+		tbuf_printf(out, "fiber_stat_clock: " CPU_RDTSC_CLOCK CRLF);
 	tbuf_printf(out, "fibers:" CRLF);
 	SLIST_FOREACH(fiber, &fibers, link) {
 		void *stack_top = fiber->coro.stack + fiber->coro.stack_size;
 
 		tbuf_printf(out, "  - fid: %4i" CRLF, fiber->fid);
 		tbuf_printf(out, "    csw: %i" CRLF, fiber->csw);
+		if (fiber_stat_enabled) {
+			struct fiber_stat *stat = &fiber->stat;
+			u64 wakeups = MAX(stat->wakeups, 1);
+
+			tbuf_printf(out, "    run_time: %.6f" CRLF,
+				    fiber_stat_seconds(stat->run_time));
+			tbuf_printf(out, "    max_slice: %.6f" CRLF,
+				    fiber_stat_seconds(stat->max_slice));
+			tbuf_printf(out, "    wakeups: %" PRIu64 CRLF, stat->wakeups);
+			tbuf_printf(out, "    wakeup_latency: %.6f" CRLF,
+				    fiber_stat_seconds(stat->wakeup_latency / wakeups));
+			tbuf_printf(out, "    max_wakeup_latency: %.6f" CRLF,
+				    fiber_stat_seconds(stat->max_wakeup_latency));
+		}
 		tbuf_printf(out, "    name: %s" CRLF, fiber->name);
 		tbuf_printf(out, "    inbox: %i" CRLF, ring_size(fiber->inbox));
 		tbuf_printf(out, "    fd: %4i" CRLF, fiber->fd);
@@ -1300,11 +1455,63 @@ fiber_info(struct tbuf *out)
 	}
 }
 
+/*
+ * A fiber which overflows its stack faults on the guard page
+ * below it, see coro.m. Say so before dying: the handler runs on
+ * an alternate signal stack, since the fiber's one is exhausted.
+ */
+static void
+fiber_sigsegv(int signo, siginfo_t *info, void *context __attribute__((unused)))
+{
+	if (fiber != NULL && tarantool_coro_guard(&fiber->coro, info->si_addr)) {
+		static const char prefix[] = "stack overflow in fiber `";
+		static const char suffix[] = "', aborting\n";
+		char buf[sizeof(prefix) + FIBER_NAME_MAXLEN + sizeof(suffix)];
+		size_t len = strnlen(fiber->name, FIBER_NAME_MAXLEN);
+		char *p = buf;
+
+		memcpy(p, prefix, sizeof(prefix) - 1);
+		p += sizeof(prefix) - 1;
+		memcpy(p, fiber->name, len);
+		p += len;
+		memcpy(p, suffix, sizeof(suffix) - 1);
+		p += sizeof(suffix) - 1;
+		ssize_t r = write(STDERR_FILENO, buf, p - buf);
+		(void) r;
+	}
+	/* The fault repeats with the default action and dumps core. */
+	signal(signo, SIG_DFL);
+}
+
+static void
+fiber_sigsegv_init(void)
+{
+	stack_t ss;
+	struct sigaction sa;
+
+	ss.ss_size = MAX(SIGSTKSZ, 16384);
+	ss.ss_sp = malloc(ss.ss_size);
+	ss.ss_flags = 0;
+	if (ss.ss_sp == NULL || sigaltstack(&ss, NULL) != 0) {
+		say_syserror("sigaltstack");
+		free(ss.ss_sp);
+		return;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sigemptyset(&sa.sa_mask);
+	sa.sa_sigaction = fiber_sigsegv;
+	sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+	if (sigaction(SIGSEGV, &sa, NULL) == -1)
+		say_syserror("sigaction");
+}
+
 void
 fiber_init(void)
 {
 	SLIST_INIT(&fibers);
 	fibers_registry = mh_i32ptr_init();
+	fiber_sigsegv_init();
 
 	ex_pool = palloc_create_pool("ex_pool");
 
@@ -1316,6 +1523,11 @@ fiber_init(void)
 	sp = call_stack;
 	fiber = &sched;
 	last_used_fid = 100;
+
+	fiber_stat_enabled = cfg.fiber_stat;
+	fiber_stat_tsc0 = cpu_rdtsc();
+	fiber_stat_time0 = ev_time();
+	sched.stat.run_start = fiber_stat_tsc0;
 }
 
 void
@@ -27,55 +27,480 @@
 #include "exception.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <limits.h>
+#ifdef TARGET_OS_LINUX
+#include <pthread.h>
+#include <sys/epoll.h>
+#endif
 
 #include <errcode.h>
 #include <palloc.h>
 #include <fiber.h>
 #include <tbuf.h>
 #include <say.h>
+#include <third_party/queue.h>
 
 const uint32_t msg_ping = 0xff00;
 
 static void iproto_reply(iproto_callback callback, struct tbuf *request);
+static void iproto_interact_threaded(iproto_callback *callback);
+static int iproto_threads_count;
+static int iproto_inflight_limit = 1;
+static iproto_is_write_f iproto_is_write;
+static bool iproto_lazy_fibers;
+static size_t iproto_lazy_readahead;
+static bool iproto_lazy_interact(iproto_callback *callback);
+
+/*
+ * With iproto_inflight_limit > 1, requests of a connection are
+ * pipelined: each one is executed by a worker fiber of its own,
+ * and the reply is sent as soon as it's ready, so that a request
+ * waiting for the WAL doesn't hold up the requests behind it.
+ * The client matches replies by sync. The connection fiber keeps
+ * reading requests until the limit of requests in flight is hit.
+ * Writes of a connection are still executed one at a time and in
+ * order: the worker of a write waits for the worker of the
+ * previous write, so that a write doesn't find the tuple locked
+ * by the previous one. The reader never waits for a write, and
+ * reads go past the writes waiting for their turn.
+ */
+struct iproto_waiter {
+	struct fiber *fiber;
+	STAILQ_ENTRY(iproto_waiter) link;
+};
+
+/** A FIFO lock of the workers of a connection. */
+struct iproto_turn {
+	bool busy;
+	STAILQ_HEAD(, iproto_waiter) waiters;
+};
+
+struct iproto_pipeline {
+	iproto_callback *callback;
+	struct fiber *reader;
+	bool reader_waiting;
+	int inflight;
+	/* Writes are executed one at a time. */
+	struct iproto_turn write_turn;
+	/* The socket, when replies are written by the workers. */
+	int fd;
+	int error;
+	/* Workers write their replies one at a time. */
+	struct iproto_turn reply_turn;
+	/* The connection, when replies go to a network thread. */
+	struct iproto_conn *conn;
+};
+
+struct iproto_job {
+	struct iproto_pipeline *pipeline;
+	struct tbuf *request;
+	bool write;
+};
+
+static void iproto_conn_reply(struct iproto_conn *conn);
+
+static void
+iproto_pipeline_init(struct iproto_pipeline *pipeline, iproto_callback *callback,
+		     int fd, struct iproto_conn *conn)
+{
+	memset(pipeline, 0, sizeof(*pipeline));
+	pipeline->callback = callback;
+	pipeline->reader = fiber;
+	pipeline->fd = fd;
+	pipeline->conn = conn;
+	STAILQ_INIT(&pipeline->write_turn.waiters);
+	STAILQ_INIT(&pipeline->reply_turn.waiters);
+	/* Workers inherit the cookie of the connection. */
+	fiber_peer_name(fiber);
+}
+
+/** Wait until the fibers which came first are done. */
+static void
+iproto_turn_take(struct iproto_turn *turn)
+{
+	struct iproto_waiter waiter = { .fiber = fiber };
+	if (turn->busy) {
+		STAILQ_INSERT_TAIL(&turn->waiters, &waiter, link);
+		/* Woken up by the previous fiber, see below. */
+		fiber_yield();
+	}
+	turn->busy = true;
+}
+
+/** Pass the turn on to the next fiber in the queue, if any. */
+static void
+iproto_turn_give(struct iproto_turn *turn)
+{
+	if (!STAILQ_EMPTY(&turn->waiters)) {
+		struct iproto_waiter *next = STAILQ_FIRST(&turn->waiters);
+		STAILQ_REMOVE_HEAD(&turn->waiters, link);
+		fiber_wakeup(next->fiber);
+	} else {
+		turn->busy = false;
+	}
+}
+
+/** Write the reply stacked in the fiber's io vector. */
+static void
+iproto_pipeline_deliver(struct iproto_pipeline *pipeline)
+{
+	if (pipeline->conn != NULL) {
+		iproto_conn_reply(pipeline->conn);
+		return;
+	}
+
+	iproto_turn_take(&pipeline->reply_turn);
+
+	int fd = fiber->fd;
+	fiber->fd = pipeline->fd;
+	if (pipeline->error == 0 && iov_flush() < 0)
+		pipeline->error = errno;
+	iov_reset();
+	fiber->fd = fd;
+
+	iproto_turn_give(&pipeline->reply_turn);
+}
+
+static void
+iproto_worker(void *data)
+{
+	struct iproto_job *job = data;
+	struct iproto_pipeline *pipeline = job->pipeline;
+	bool write_turn = false;
+
+	/* The reader waits for the workers, whatever happens to them. */
+	@try {
+		if (job->write) {
+			/* Queued in the order of dispatch: see fiber_call() there. */
+			iproto_turn_take(&pipeline->write_turn);
+			write_turn = true;
+		}
+		iproto_reply(*pipeline->callback, job->request);
+		if (write_turn) {
+			/* The reply may wait for the socket, the next write needn't. */
+			iproto_turn_give(&pipeline->write_turn);
+			write_turn = false;
+		}
+		iproto_pipeline_deliver(pipeline);
+	} @finally {
+		if (write_turn)
+			iproto_turn_give(&pipeline->write_turn);
+		pipeline->inflight--;
+		if (pipeline->reader_waiting)
+			fiber_wakeup(pipeline->reader);
+	}
+	fiber_gc();
+}
+
+/** Wait until no more than count requests are in flight. */
+static void
+iproto_pipeline_wait(struct iproto_pipeline *pipeline, int count)
+{
+	while (pipeline->inflight > count) {
+		pipeline->reader_waiting = true;
+		fiber_yield();
+		pipeline->reader_waiting = false;
+	}
+}
+
+/** Pass a request to a new worker fiber. */
+static void
+iproto_pipeline_dispatch(struct iproto_pipeline *pipeline, struct tbuf *request)
+{
+	u32 msg_code = iproto(request)->msg_code;
+	bool write = msg_code != msg_ping &&
+		(iproto_is_write == NULL || iproto_is_write(msg_code));
+
+	iproto_pipeline_wait(pipeline, iproto_inflight_limit - 1);
+
+	struct fiber *worker = fiber_create(fiber->name, -1, -1, iproto_worker, NULL);
+	if (worker == NULL) {
+		say_error("can't create a worker fiber, executing in place");
+		/* Let the writes in flight go first. */
+		if (write)
+			iproto_turn_take(&pipeline->write_turn);
+		@try {
+			iproto_reply(*pipeline->callback, request);
+		} @finally {
+			if (write)
+				iproto_turn_give(&pipeline->write_turn);
+		}
+		iproto_pipeline_deliver(pipeline);
+		return;
+	}
+
+	struct iproto_job *job = palloc(worker->gc_pool, sizeof(*job));
+	job->pipeline = pipeline;
+	job->request = tbuf_clone(worker->gc_pool, request);
+	job->write = write;
+	worker->cookie = fiber->cookie;
+	worker->f_data = job;
+
+	pipeline->inflight++;
+	/*
+	 * The worker runs until it blocks: a write worker takes
+	 * its place in the write queue before we read on.
+	 */
+	fiber_call(worker);
+}
 
 void
 iproto_interact(iproto_callback *callback)
 {
 	struct tbuf *in = fiber->rbuf;
 	ssize_t to_read = sizeof(struct iproto_header);
+	struct iproto_pipeline pipeline;
 
-	for (;;) {
-		if (to_read > 0 && fiber_bread(in, to_read) <= 0)
-			break;
+	if (iproto_threads_count > 0) {
+		iproto_interact_threaded(callback);
+		return;
+	}
 
-		ssize_t request_len = sizeof(struct iproto_header) + iproto(in)->len;
-		to_read = request_len - in->size;
+	bool pipelined = iproto_inflight_limit > 1;
+	if (!pipelined && iproto_lazy_fibers && iproto_lazy_interact(callback))
+		return;
+	if (pipelined)
+		iproto_pipeline_init(&pipeline, callback, fiber->fd, NULL);
 
-		if (to_read > 0 && fiber_bread(in, to_read) <= 0)
-			break;
+	@try {
+		for (;;) {
+			if (to_read > 0 && fiber_bread(in, to_read) <= 0)
+				break;
+
+			ssize_t request_len = sizeof(struct iproto_header) + iproto(in)->len;
+			to_read = request_len - in->size;
 
-		struct tbuf *request = tbuf_split(in, request_len);
-		iproto_reply(*callback, request);
+			if (to_read > 0 && fiber_bread(in, to_read) <= 0)
+				break;
 
-		to_read = sizeof(struct iproto_header) - in->size;
+			struct tbuf *request = tbuf_split(in, request_len);
+			if (pipelined)
+				iproto_pipeline_dispatch(&pipeline, request);
+			else
+				iproto_reply(*callback, request);
 
+			to_read = sizeof(struct iproto_header) - in->size;
+
+			/*
+			 * Flush output and garbage collect before reading
+			 * next header.
+			 */
+			if (to_read > 0) {
+				if (pipelined ? pipeline.error != 0 : iov_flush() < 0) {
+					say_warn("io_error: %s",
+						 strerror(pipelined ? pipeline.error : errno));
+					break;
+				}
+				fiber_gc();
+				/* Must be reset after fiber_gc() */
+				in = fiber->rbuf;
+			}
+		}
+	} @finally {
 		/*
-		 * Flush output and garbage collect before reading
-		 * next header.
+		 * Workers use the socket and the pipeline on our
+		 * stack: let them finish first, even if we are
+		 * being cancelled.
 		 */
-		if (to_read > 0) {
-			if (iov_flush() < 0) {
-				say_warn("io_error: %s", strerror(errno));
-				break;
+		if (pipelined)
+			iproto_pipeline_wait(&pipeline, 0);
+	}
+}
+
+void
+iproto_set_inflight_limit(int limit, iproto_is_write_f is_write)
+{
+	iproto_inflight_limit = limit > 0 ? limit : 1;
+	iproto_is_write = is_write;
+}
+
+/* {{{ Lazy connection fibers. ************************************/
+
+/*
+ * With iproto_lazy_fibers, an idle connection doesn't own a
+ * fiber, and so a coroutine stack. The connection is kept in a
+ * small iproto_lazy_conn, and its socket is watched right from
+ * the scheduler. Input is accumulated there until a complete
+ * request arrives; only then a fiber is taken from the zombie
+ * list to execute the buffered requests and write the replies.
+ * Once the input is drained, the fiber detaches from the socket
+ * and goes back to the zombie list.
+ */
+struct iproto_lazy_conn {
+	ev_io io;
+	int fd;
+	iproto_callback *callback;
+	u64 cookie;
+	/* Input of an incomplete request, malloc()ed. */
+	char *in;
+	size_t in_size;
+	size_t in_capacity;
+	char name[FIBER_NAME_MAXLEN];
+};
+
+static void
+iproto_lazy_close(struct iproto_lazy_conn *conn)
+{
+	if (ev_is_active(&conn->io))
+		ev_io_stop(&conn->io);
+	close(conn->fd);
+	free(conn->in);
+	free(conn);
+}
+
+/** Whether the buffered input holds at least one complete request. */
+static bool
+iproto_lazy_has_request(struct iproto_lazy_conn *conn)
+{
+	if (conn->in_size < sizeof(struct iproto_header))
+		return false;
+	struct iproto_header *header = (struct iproto_header *) conn->in;
+	return conn->in_size >= sizeof(struct iproto_header) + header->len;
+}
+
+/**
+ * Execute buffered requests, then let the fiber go. The
+ * connection is closed on any error, including exceptions.
+ */
+static void
+iproto_lazy_handler(void *data)
+{
+	struct iproto_lazy_conn *conn = data;
+	struct tbuf *in = fiber->rbuf;
+	bool idle = false;
+
+	@try {
+		tbuf_append(in, conn->in, conn->in_size);
+
+		while (in->size >= sizeof(struct iproto_header) &&
+		       in->size >= sizeof(struct iproto_header) + iproto(in)->len) {
+			size_t request_len = sizeof(struct iproto_header) + iproto(in)->len;
+			iproto_reply(*conn->callback, tbuf_split(in, request_len));
+		}
+
+		if (iov_flush() < 0) {
+			say_warn("io_error: %s", strerror(errno));
+		} else {
+			/* Keep the beginning of the next request, if any. */
+			if (in->size > 0) {
+				memcpy(conn->in, in->data, in->size);
+			} else {
+				free(conn->in);
+				conn->in = NULL;
+				conn->in_capacity = 0;
 			}
-			fiber_gc();
-			/* Must be reset after fiber_gc() */
-			in = fiber->rbuf;
+			conn->in_size = in->size;
+			idle = true;
+		}
+	}
+	@finally {
+		if (ev_is_active(&fiber->io))
+			ev_io_stop(&fiber->io);
+		fiber->fd = -1;
+		if (idle)
+			ev_io_start(&conn->io);
+		else
+			iproto_lazy_close(conn);
+	}
+}
+
+/** Socket readiness, called by the scheduler. */
+static void
+iproto_lazy_cb(ev_io *watcher, int revents __attribute__((unused)))
+{
+	struct iproto_lazy_conn *conn = watcher->data;
+
+	if (conn->in_capacity - conn->in_size < iproto_lazy_readahead) {
+		size_t capacity = conn->in_size + iproto_lazy_readahead;
+		char *in = realloc(conn->in, capacity);
+		if (in == NULL) {
+			say_error("can't allocate connection input buffer");
+			iproto_lazy_close(conn);
+			return;
+		}
+		conn->in = in;
+		conn->in_capacity = capacity;
+	}
+
+	ssize_t r = read(conn->fd, conn->in + conn->in_size,
+			 conn->in_capacity - conn->in_size);
+	if (r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+		       errno != EINTR)) {
+		if (r < 0)
+			say_syserror("read");
+		iproto_lazy_close(conn);
+		return;
+	}
+	if (r > 0)
+		conn->in_size += r;
+
+	if (!iproto_lazy_has_request(conn)) {
+		/* Don't hold on to the buffer of an idle connection. */
+		if (conn->in_size == 0) {
+			free(conn->in);
+			conn->in = NULL;
+			conn->in_capacity = 0;
 		}
+		return;
+	}
+
+	struct fiber *h = fiber_create(conn->name, conn->fd, -1,
+				       iproto_lazy_handler, conn);
+	if (h == NULL) {
+		say_error("can't create handler fiber, dropping client connection");
+		iproto_lazy_close(conn);
+		return;
 	}
+	ev_io_stop(&conn->io);
+	h->cookie = conn->cookie;
+	fiber_call(h);
+}
+
+/**
+ * Detach the connection of the current fiber and wait for
+ * requests without it. Returns false if that's not possible.
+ */
+static bool
+iproto_lazy_interact(iproto_callback *callback)
+{
+	struct iproto_lazy_conn *conn = calloc(1, sizeof(*conn));
+	if (conn == NULL)
+		return false;
+
+	/* Requests of the connection are logged with its cookie. */
+	fiber_peer_name(fiber);
+
+	conn->fd = fiber->fd;
+	conn->callback = callback;
+	conn->cookie = fiber->cookie;
+	snprintf(conn->name, sizeof(conn->name), "%s", fiber->name);
+	ev_io_init(&conn->io, iproto_lazy_cb, conn->fd, EV_READ);
+	conn->io.data = conn;
+
+	/* The fiber returns to the zombie list without the socket. */
+	if (ev_is_active(&fiber->io))
+		ev_io_stop(&fiber->io);
+	fiber->fd = -1;
+	fiber->has_peer = false;
+
+	ev_io_start(&conn->io);
+	return true;
 }
 
+void
+iproto_set_lazy_fibers(bool lazy, int readahead)
+{
+	iproto_lazy_fibers = lazy;
+	iproto_lazy_readahead = MAX(readahead, (int) sizeof(struct iproto_header));
+}
+
+/* }}} */
+
 /** Stack a reply to a single request to the fiber's io vector. */
 
 static void iproto_reply(iproto_callback callback, struct tbuf *request)
@@ -112,3 +537,615 @@ static void iproto_reply(iproto_callback callback, struct tbuf *request)
 	for (; saved_iov_cnt < fiber->iov_cnt; saved_iov_cnt++)
 		reply->len += iovec(fiber->iov)[saved_iov_cnt].iov_len;
 }
+
+/* {{{ Network threads. *******************************************/
+
+/*
+ * With iproto_threads > 0, client sockets are owned by network
+ * threads. A network thread reads the socket, splits the input
+ * into requests and passes complete requests to the transaction
+ * (TX) thread. There, the requests of a connection are executed
+ * by the connection's fiber one after another, exactly like
+ * iproto_interact() does, and the replies to all requests received
+ * so far are sent back to the network thread in one message.
+ *
+ * Messages travel between threads over lock-free stacks: the
+ * consumer takes the whole stack at once and reverses it, so that
+ * messages of every producer are consumed in the order they were
+ * sent. The TX thread is woken up with an ev_async, a network
+ * thread with a pipe.
+ *
+ * A network thread stops reading a connection once its requests
+ * not yet taken by the TX thread reach IPROTO_CONN_QUEUE_MAX
+ * bytes, and resumes when the TX thread replies.
+ *
+ * A connection is freed by its network thread, once the TX thread
+ * has released it: the socket is closed, which the TX thread has
+ * seen (IPROTO_MSG_CLOSE), and the connection fiber is gone. When
+ * the fiber ends first, it asks the network thread to close the
+ * socket (IPROTO_MSG_SHUTDOWN).
+ *
+ * Nothing but malloc() is used by a network thread: fibers,
+ * palloc and the logger belong to the TX thread.
+ */
+
+#ifdef TARGET_OS_LINUX
+
+enum { IPROTO_CONN_QUEUE_MAX = 1024 * 1024 };
+
+enum iproto_msg_type {
+	/* network thread -> TX */
+	IPROTO_MSG_REQUEST,
+	IPROTO_MSG_CLOSE,
+	/* TX -> network thread */
+	IPROTO_MSG_CONNECT,
+	IPROTO_MSG_REPLY,
+	IPROTO_MSG_SHUTDOWN,
+	IPROTO_MSG_RELEASE
+};
+
+struct iproto_msg {
+	struct iproto_msg *next;
+	struct iproto_conn *conn;
+	enum iproto_msg_type type;
+	u32 size;
+	u8 data[];
+};
+
+struct iproto_stack {
+	struct iproto_msg *volatile top;
+};
+
+struct iproto_thread {
+	pthread_t thread;
+	int epfd;
+	int wakeup[2];
+	struct iproto_stack inbox;
+	/* Released connections, freed after the current epoll batch. */
+	struct iproto_conn *released;
+};
+
+struct iproto_conn {
+	int fd;
+	struct iproto_thread *thread;
+	/* Owned by the network thread. */
+	u8 *in;
+	size_t in_size, in_capacity;
+	struct iproto_msg *out_first, *out_last;
+	size_t out_offset;
+	bool closed;
+	u32 events;
+	struct iproto_conn *next_released;
+	/* Bytes of requests not yet taken by the TX thread. */
+	size_t queued;
+	/* Owned by the TX thread; fiber is NULL once it's gone. */
+	struct fiber *fiber;
+	struct iproto_msg *tx_first, *tx_last;
+	bool tx_closed, tx_waiting;
+	/* Why the network thread closed the socket, for the log */
+	int error;
+};
+
+static struct iproto_thread *iproto_threads;
+static size_t iproto_readahead;
+static struct iproto_stack iproto_tx_inbox;
+static ev_async iproto_tx_async;
+
+static void
+iproto_stack_push(struct iproto_stack *stack, struct iproto_msg *msg)
+{
+	struct iproto_msg *top;
+
+	do {
+		top = stack->top;
+		msg->next = top;
+	} while (!__sync_bool_compare_and_swap(&stack->top, top, msg));
+}
+
+/** Take all messages, oldest first. */
+static struct iproto_msg *
+iproto_stack_take(struct iproto_stack *stack)
+{
+	struct iproto_msg *msg = __sync_lock_test_and_set(&stack->top, NULL);
+	struct iproto_msg *fifo = NULL, *next;
+
+	for (; msg != NULL; msg = next) {
+		next = msg->next;
+		msg->next = fifo;
+		fifo = msg;
+	}
+	return fifo;
+}
+
+static struct iproto_msg *
+iproto_msg_new(struct iproto_conn *conn, enum iproto_msg_type type, size_t size)
+{
+	struct iproto_msg *msg = malloc(sizeof(*msg) + size);
+
+	if (msg == NULL)
+		abort();
+	msg->next = NULL;
+	msg->conn = conn;
+	msg->type = type;
+	msg->size = size;
+	return msg;
+}
+
+static void
+iproto_thread_send(struct iproto_thread *thread, struct iproto_msg *msg)
+{
+	char c = 0;
+
+	iproto_stack_push(&thread->inbox, msg);
+	/* A full pipe will wake the thread up anyway. */
+	if (write(thread->wakeup[1], &c, sizeof(c)) < 0 && errno != EAGAIN)
+		panic_syserror("write");
+}
+
+/** Network thread: the client is gone, let the TX thread know. */
+static void
+iproto_conn_close(struct iproto_conn *conn, int error)
+{
+	struct iproto_msg *msg, *next;
+
+	epoll_ctl(conn->thread->epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+	close(conn->fd);
+	conn->closed = true;
+	conn->error = error;
+
+	free(conn->in);
+	conn->in = NULL;
+	for (msg = conn->out_first; msg != NULL; msg = next) {
+		next = msg->next;
+		free(msg);
+	}
+	conn->out_first = conn->out_last = NULL;
+
+	iproto_stack_push(&iproto_tx_inbox, iproto_msg_new(conn, IPROTO_MSG_CLOSE, 0));
+}
+
+/** Network thread: watch for the events the connection needs now. */
+static void
+iproto_conn_update_events(struct iproto_conn *conn)
+{
+	u32 events = 0;
+
+	if (conn->queued < IPROTO_CONN_QUEUE_MAX)
+		events |= EPOLLIN;
+	if (conn->out_first != NULL)
+		events |= EPOLLOUT;
+	if (events == conn->events)
+		return;
+
+	struct epoll_event ev = { .events = events, .data.ptr = conn };
+	epoll_ctl(conn->thread->epfd, EPOLL_CTL_MOD, conn->fd, &ev);
+	conn->events = events;
+}
+
+/**
+ * Network thread: pass complete requests of the input on to the
+ * TX thread, as long as the connection's queue isn't full.
+ *
+ * @retval true if the TX thread has got new messages
+ */
+static bool
+iproto_conn_parse(struct iproto_conn *conn)
+{
+	bool sent = false;
+	size_t offset = 0;
+
+	while (conn->queued < IPROTO_CONN_QUEUE_MAX &&
+	       conn->in_size - offset >= sizeof(struct iproto_header)) {
+		struct iproto_header *header = (void *) (conn->in + offset);
+		size_t request_len = sizeof(*header) + header->len;
+
+		if (conn->in_size - offset < request_len)
+			break;
+
+		struct iproto_msg *msg = iproto_msg_new(conn, IPROTO_MSG_REQUEST,
+							request_len);
+		memcpy(msg->data, header, request_len);
+		__sync_add_and_fetch(&conn->queued, request_len);
+		iproto_stack_push(&iproto_tx_inbox, msg);
+		offset += request_len;
+		sent = true;
+	}
+	if (offset > 0) {
+		memmove(conn->in, conn->in + offset, conn->in_size - offset);
+		conn->in_size -= offset;
+	}
+	iproto_conn_update_events(conn);
+	return sent;
+}
+
+/**
+ * Network thread: read what's available and pass complete
+ * requests on to the TX thread.
+ *
+ * @retval true if the TX thread has got new messages
+ */
+static bool
+iproto_conn_read(struct iproto_conn *conn)
+{
+	if (conn->in_capacity - conn->in_size < iproto_readahead) {
+		size_t capacity = MAX(conn->in_capacity * 2,
+				      conn->in_size + iproto_readahead);
+		u8 *in = realloc(conn->in, capacity);
+		if (in == NULL)
+			abort();
+		conn->in = in;
+		conn->in_capacity = capacity;
+	}
+
+	ssize_t r = read(conn->fd, conn->in + conn->in_size,
+			 conn->in_capacity - conn->in_size);
+	if (r <= 0) {
+		if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+			return false;
+		iproto_conn_close(conn, r < 0 ? errno : 0);
+		return true;
+	}
+	conn->in_size += r;
+
+	return iproto_conn_parse(conn);
+}
+
+/** Network thread: write as much of the replies as the socket takes. */
+static bool
+iproto_conn_write(struct iproto_conn *conn)
+{
+	while (conn->out_first != NULL) {
+		struct iovec iov[IOV_MAX];
+		int iovcnt = 0;
+		size_t offset = conn->out_offset;
+
+		for (struct iproto_msg *msg = conn->out_first;
+		     msg != NULL && iovcnt < IOV_MAX; msg = msg->next) {
+			iov[iovcnt].iov_base = msg->data + offset;
+			iov[iovcnt].iov_len = msg->size - offset;
+			iovcnt++;
+			offset = 0;
+		}
+
+		ssize_t r = writev(conn->fd, iov, iovcnt);
+		if (r < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+				break;
+			iproto_conn_close(conn, errno);
+			return true;
+		}
+
+		while (r > 0) {
+			struct iproto_msg *msg = conn->out_first;
+			size_t left = msg->size - conn->out_offset;
+
+			if ((size_t) r < left) {
+				conn->out_offset += r;
+				break;
+			}
+			r -= left;
+			conn->out_offset = 0;
+			conn->out_first = msg->next;
+			free(msg);
+		}
+		if (conn->out_first == NULL)
+			conn->out_last = NULL;
+	}
+
+	iproto_conn_update_events(conn);
+	return false;
+}
+
+/** Network thread: handle the messages from the TX thread. */
+static bool
+iproto_thread_inbox(struct iproto_thread *thread)
+{
+	struct iproto_msg *msg = iproto_stack_take(&thread->inbox), *next;
+	bool sent = false;
+
+	for (; msg != NULL; msg = next) {
+		struct iproto_conn *conn = msg->conn;
+		next = msg->next;
+
+		switch (msg->type) {
+		case IPROTO_MSG_CONNECT: {
+			struct epoll_event ev = { .events = EPOLLIN, .data.ptr = conn };
+			free(msg);
+			conn->events = EPOLLIN;
+			if (epoll_ctl(thread->epfd, EPOLL_CTL_ADD, conn->fd, &ev) != 0) {
+				iproto_conn_close(conn, errno);
+				sent = true;
+			}
+			break;
+		}
+		case IPROTO_MSG_REPLY:
+			if (conn->closed) {
+				free(msg);
+				break;
+			}
+			msg->next = NULL;
+			if (conn->out_last != NULL)
+				conn->out_last->next = msg;
+			else
+				conn->out_first = msg;
+			conn->out_last = msg;
+			sent |= iproto_conn_write(conn);
+			/* The TX thread has taken requests off the queue. */
+			if (!conn->closed)
+				sent |= iproto_conn_parse(conn);
+			break;
+		case IPROTO_MSG_SHUTDOWN:
+			free(msg);
+			/*
+			 * The connection fiber has died. The TX thread
+			 * releases the connection once it sees it closed.
+			 */
+			if (!conn->closed) {
+				iproto_conn_close(conn, 0);
+				sent = true;
+			}
+			break;
+		case IPROTO_MSG_RELEASE:
+			free(msg);
+			/*
+			 * Nothing refers to the connection any more, but
+			 * the current epoll batch may: free it after.
+			 */
+			conn->next_released = thread->released;
+			thread->released = conn;
+			break;
+		default:
+			assert(false);
+		}
+	}
+	return sent;
+}
+
+static void *
+iproto_thread_loop(void *data)
+{
+	struct iproto_thread *thread = data;
+	struct epoll_event events[64];
+
+	for (;;) {
+		int n = epoll_wait(thread->epfd, events, lengthof(events), -1);
+		bool sent = false;
+
+		for (int i = 0; i < n; i++) {
+			struct iproto_conn *conn = events[i].data.ptr;
+
+			if (conn == NULL) {
+				char buf[64];
+				/* Drain the pipe before taking the messages. */
+				while (read(thread->wakeup[0], buf, sizeof(buf)) > 0)
+					;
+				sent |= iproto_thread_inbox(thread);
+				continue;
+			}
+			if (conn->closed)
+				continue;
+			if (events[i].events & EPOLLOUT)
+				sent |= iproto_conn_write(conn);
+			if (!conn->closed &&
+			    (events[i].events & (EPOLLERR | EPOLLHUP) ||
+			     (events[i].events & EPOLLIN && conn->events & EPOLLIN)))
+				sent |= iproto_conn_read(conn);
+		}
+		while (thread->released != NULL) {
+			struct iproto_conn *conn = thread->released;
+			thread->released = conn->next_released;
+			free(conn);
+		}
+		if (sent)
+			ev_async_send(&iproto_tx_async);
+	}
+	return NULL;
+}
+
+/** TX thread: dispatch the messages from network threads. */
+static void
+iproto_tx_cb(ev_async *w __attribute__((unused)),
+	     int revents __attribute__((unused)))
+{
+	struct iproto_msg *msg = iproto_stack_take(&iproto_tx_inbox), *next;
+
+	for (; msg != NULL; msg = next) {
+		struct iproto_conn *conn = msg->conn;
+		next = msg->next;
+
+		if (conn->fiber == NULL) {
+			/*
+			 * The connection fiber is gone and has asked to
+			 * close the socket: CLOSE is the last message of
+			 * the connection.
+			 */
+			if (msg->type == IPROTO_MSG_CLOSE)
+				iproto_thread_send(conn->thread,
+						   iproto_msg_new(conn, IPROTO_MSG_RELEASE, 0));
+			free(msg);
+			continue;
+		}
+		if (msg->type == IPROTO_MSG_CLOSE) {
+			conn->tx_closed = true;
+			free(msg);
+		} else {
+			msg->next = NULL;
+			if (conn->tx_last != NULL)
+				conn->tx_last->next = msg;
+			else
+				conn->tx_first = msg;
+			conn->tx_last = msg;
+		}
+		if (conn->tx_waiting)
+			fiber_call(conn->fiber);
+	}
+}
+
+/**
+ * TX thread: send the replies stacked in the fiber's io vector.
+ * They point to tuples: copy them while they're pinned.
+ */
+static void
+iproto_conn_reply(struct iproto_conn *conn)
+{
+	size_t size = 0;
+	struct iovec *iov = iovec(fiber->iov);
+	for (int i = 0; i < fiber->iov_cnt; i++)
+		size += iov[i].iov_len;
+
+	struct iproto_msg *reply = iproto_msg_new(conn, IPROTO_MSG_REPLY, size);
+	u8 *pos = reply->data;
+	for (int i = 0; i < fiber->iov_cnt; i++) {
+		memcpy(pos, iov[i].iov_base, iov[i].iov_len);
+		pos += iov[i].iov_len;
+	}
+	iov_reset();
+
+	iproto_thread_send(conn->thread, reply);
+}
+
+/**
+ * TX thread: the connection fiber. Run the requests, and send
+ * the replies to all requests received so far at once.
+ */
+static void
+iproto_interact_threaded(iproto_callback *callback)
+{
+	static u32 next_thread;
+	struct iproto_conn *conn = calloc(1, sizeof(*conn));
+
+	if (conn == NULL) {
+		say_error("can't allocate a connection, dropping it");
+		return;
+	}
+
+	/* Remember the peer: the socket is about to leave. */
+	fiber_peer_name(fiber);
+	conn->fd = fiber->fd;
+	fiber->fd = -1;
+	conn->fiber = fiber;
+	conn->thread = &iproto_threads[next_thread++ % iproto_threads_count];
+	iproto_thread_send(conn->thread, iproto_msg_new(conn, IPROTO_MSG_CONNECT, 0));
+
+	struct iproto_pipeline pipeline;
+	bool pipelined = iproto_inflight_limit > 1;
+	if (pipelined)
+		iproto_pipeline_init(&pipeline, callback, -1, conn);
+
+	@try {
+		for (;;) {
+			while (conn->tx_first == NULL && !conn->tx_closed) {
+				conn->tx_waiting = true;
+				fiber_yield();
+				conn->tx_waiting = false;
+			}
+			if (conn->tx_closed)
+				break;
+
+			struct iproto_msg *msg = conn->tx_first, *next;
+			conn->tx_first = conn->tx_last = NULL;
+
+			for (; msg != NULL; msg = next) {
+				next = msg->next;
+				struct tbuf *request = tbuf_alloc(fiber->gc_pool);
+				tbuf_append(request, msg->data, msg->size);
+				/* Replies come after this, resuming the reads. */
+				__sync_sub_and_fetch(&conn->queued, msg->size);
+				free(msg);
+				if (pipelined)
+					iproto_pipeline_dispatch(&pipeline, request);
+				else
+					iproto_reply(*callback, request);
+			}
+
+			if (!pipelined)
+				iproto_conn_reply(conn);
+			fiber_gc();
+		}
+
+		if (conn->error != 0)
+			say_warn("io_error: %s", strerror(conn->error));
+	} @finally {
+		/* Workers send replies to the connection: let them finish first. */
+		if (pipelined)
+			iproto_pipeline_wait(&pipeline, 0);
+		/* Drop the requests the client didn't wait for. */
+		for (struct iproto_msg *msg = conn->tx_first, *next; msg != NULL; msg = next) {
+			next = msg->next;
+			free(msg);
+		}
+		conn->tx_first = conn->tx_last = NULL;
+		conn->fiber = NULL;
+		iproto_thread_send(conn->thread,
+				   iproto_msg_new(conn, conn->tx_closed ?
+						  IPROTO_MSG_RELEASE : IPROTO_MSG_SHUTDOWN, 0));
+	}
+}
+
+void
+iproto_threads_init(int count, int readahead)
+{
+	sigset_t all, orig;
+
+	if (count <= 0)
+		return;
+
+	iproto_readahead = readahead > 0 ? readahead : 16320;
+
+	iproto_threads = calloc(count, sizeof(*iproto_threads));
+	if (iproto_threads == NULL)
+		panic("can't allocate %i network threads", count);
+
+	ev_async_init(&iproto_tx_async, iproto_tx_cb);
+	ev_async_start(&iproto_tx_async);
+
+	/* Signals are handled by the TX thread only. */
+	sigfillset(&all);
+	pthread_sigmask(SIG_BLOCK, &all, &orig);
+
+	for (int i = 0; i < count; i++) {
+		struct iproto_thread *thread = &iproto_threads[i];
+		struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+
+		thread->epfd = epoll_create(64);
+		if (thread->epfd < 0)
+			panic_syserror("epoll_create");
+		if (pipe(thread->wakeup) != 0 ||
+		    set_nonblock(thread->wakeup[0]) == -1 ||
+		    set_nonblock(thread->wakeup[1]) == -1)
+			panic_syserror("pipe");
+		if (epoll_ctl(thread->epfd, EPOLL_CTL_ADD, thread->wakeup[0], &ev) != 0)
+			panic_syserror("epoll_ctl");
+		if (pthread_create(&thread->thread, NULL, iproto_thread_loop, thread) != 0)
+			panic("can't create a network thread");
+	}
+
+	pthread_sigmask(SIG_SETMASK, &orig, NULL);
+	iproto_threads_count = count;
+	say_info("started %i network thread(s)", count);
+}
+
+#else /* !TARGET_OS_LINUX */
+
+static void
+iproto_interact_threaded(iproto_callback *callback __attribute__((unused)))
+{
+	assert(false);
+}
+
+static void
+iproto_conn_reply(struct iproto_conn *conn __attribute__((unused)))
+{
+	assert(false);
+}
+
+void
+iproto_threads_init(int count, int readahead __attribute__((unused)))
+{
+	if (count > 0)
+		say_warn("network threads are not supported on this platform");
+}
+
+#endif /* TARGET_OS_LINUX */
+
+/* }}} */
@@ -404,7 +404,7 @@ scan_dir(struct log_io_class *class, i64 **ret_lsn)
 	return result;
 }
 
-static i64
+i64
 greatest_lsn(struct log_io_class *class)
 {
 	i64 *lsn;
@@ -801,7 +801,7 @@ read_log(const char *filename,
 	return i.error;
 }
 
-static int
+int
 recover_snap(struct recovery_state *r)
 {
 	struct log_io_iter i;
@@ -1177,6 +1177,28 @@ wal_write_request(const struct tbuf *t)
 	return t->data;
 }
 
+struct tbuf *
+convert_to_v11(struct tbuf *orig, u16 tag, u64 cookie, i64 lsn)
+{
+	struct tbuf *row = tbuf_alloc(orig->pool);
+
+	tbuf_ensure(row, sizeof(struct row_v11));
+	row->size = sizeof(struct row_v11);
+	tbuf_append(row, &tag, sizeof(tag));
+	tbuf_append(row, &cookie, sizeof(cookie));
+	tbuf_append(row, orig->data, orig->size);
+
+	row_v11(row)->lsn = lsn;
+	row_v11(row)->tm = ev_now();
+	row_v11(row)->len = row->size - sizeof(struct row_v11);
+	row_v11(row)->data_crc32c =
+		crc32c(0, row_v11(row)->data, row_v11(row)->len);
+	row_v11(row)->header_crc32c =
+		crc32c(0, row->data + field_sizeof(struct row_v11, header_crc32c),
+		       sizeof(struct row_v11) - field_sizeof(struct row_v11, header_crc32c));
+	return row;
+}
+
 static struct tbuf *
 write_to_disk(void *_state, struct tbuf *t)
 {
@@ -1305,9 +1327,127 @@ wal_write(struct recovery_state *r, u16 tag, u64 cookie, i64 lsn, struct tbuf *r
 	say_debug("wal_write reply=%" PRIu32, reply);
 	if (reply != 0)
 		say_warn("wal writer returned error status");
+	else if (r->wal_ring != NULL)
+		wal_ring_append(r->wal_ring, lsn, tag, cookie, row);
 	return reply == 0;
 }
 
+struct wal_ring *
+wal_ring_create(u32 size, i64 confirmed_lsn)
+{
+	struct wal_ring *ring = calloc(1, sizeof(*ring) + size * sizeof(ring->row[0]));
+
+	if (ring == NULL)
+		panic("can't allocate WAL ring of %" PRIu32 " rows", size);
+
+	ring->size = size;
+	ring->head = 0;
+	ring->first_lsn = confirmed_lsn + 1;
+	ring->last_lsn = confirmed_lsn;
+	SLIST_INIT(&ring->readers);
+	return ring;
+}
+
+static void
+wal_ring_evict(struct wal_ring *ring)
+{
+	assert(ring->first_lsn <= ring->last_lsn);
+
+	free(ring->row[ring->head]);
+	ring->row[ring->head] = NULL;
+	ring->head = (ring->head + 1) % ring->size;
+	ring->first_lsn++;
+}
+
+static void
+wal_ring_reset(struct wal_ring *ring, i64 next_lsn)
+{
+	while (ring->first_lsn <= ring->last_lsn)
+		wal_ring_evict(ring);
+
+	ring->head = 0;
+	ring->first_lsn = next_lsn;
+	ring->last_lsn = next_lsn - 1;
+}
+
+void
+wal_ring_append(struct wal_ring *ring, i64 lsn, u16 tag, u64 cookie, struct tbuf *data)
+{
+	struct wal_ring_reader *reader;
+	struct row_v11 *row;
+	u32 len = sizeof(tag) + sizeof(cookie) + data->size;
+
+	if (lsn != ring->last_lsn + 1) {
+		say_warn("WAL ring: non consecutive lsn, last:%" PRIi64
+			 " new:%" PRIi64 ", dropping the ring",
+			 ring->last_lsn, lsn);
+		wal_ring_reset(ring, lsn);
+	}
+
+	if (ring->last_lsn - ring->first_lsn + 1 == ring->size)
+		wal_ring_evict(ring);
+
+	row = malloc(sizeof(*row) + len);
+	if (row == NULL) {
+		say_error("can't allocate WAL ring row, dropping the ring");
+		wal_ring_reset(ring, lsn + 1);
+		goto wakeup;
+	}
+
+	memcpy(row->data, &tag, sizeof(tag));
+	memcpy(row->data + sizeof(tag), &cookie, sizeof(cookie));
+	memcpy(row->data + sizeof(tag) + sizeof(cookie), data->data, data->size);
+
+	row->lsn = lsn;
+	row->tm = ev_now();
+	row->len = len;
+	row->data_crc32c = crc32c(0, row->data, len);
+	row->header_crc32c =
+		crc32c(0, (u8 *)row + field_sizeof(struct row_v11, header_crc32c),
+		       sizeof(struct row_v11) - field_sizeof(struct row_v11, header_crc32c));
+
+	ring->row[(ring->head + (lsn - ring->first_lsn)) % ring->size] = row;
+	ring->last_lsn = lsn;
+
+wakeup:
+	/*
+	 * Readers which lost their position in the ring must
+	 * learn about it as well, so wake up everybody who
+	 * waits for a row not newer than the last one.
+	 */
+	SLIST_FOREACH(reader, &ring->readers, link) {
+		if (reader->fiber != NULL && reader->lsn <= ring->last_lsn) {
+			fiber_wakeup(reader->fiber);
+			reader->fiber = NULL;
+		}
+	}
+}
+
+bool
+wal_ring_has(struct wal_ring *ring, i64 lsn)
+{
+	return lsn >= ring->first_lsn && lsn <= ring->last_lsn + 1;
+}
+
+struct row_v11 *
+wal_ring_row(struct wal_ring *ring, i64 lsn)
+{
+	if (lsn < ring->first_lsn || lsn > ring->last_lsn)
+		return NULL;
+
+	return ring->row[(ring->head + (lsn - ring->first_lsn)) % ring->size];
+}
+
+void
+wal_ring_wait(struct wal_ring *ring, struct wal_ring_reader *reader)
+{
+	if (reader->lsn > ring->last_lsn) {
+		reader->fiber = fiber;
+		fiber_yield();
+		reader->fiber = NULL;
+	}
+}
+
 struct recovery_state *
 recover_init(const char *snap_dirname, const char *wal_dirname,
 	     row_handler row_handler,
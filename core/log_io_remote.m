@@ -37,7 +37,44 @@
 #include <errno.h>
 
 #include <say.h>
+#include <tarantool.h>
+#include <palloc.h>
 #include <pickle.h>
+#include <third_party/lzf.h>
+#include <third_party/queue.h>
+
+/*
+ * Applying a row in memory never yields, while writing it to
+ * the WAL takes a round trip to the WAL writer. So the replica
+ * applies rows strictly one after another, in the order the
+ * master committed them, and then passes each row to a fiber of
+ * its own to be written to the WAL: up to REMOTE_WRITES_MAX
+ * writes are in flight at once. Since every row sees the changes
+ * of all rows before it, no conflict detection is necessary.
+ * Rows are confirmed in LSN order, whatever the order of the
+ * WAL writer replies.
+ */
+enum { REMOTE_WRITES_MAX = 64 };
+
+struct remote_write {
+	struct recovery_state *r;
+	i64 lsn;
+	u16 tag;
+	struct tbuf *data;
+	/* Set when the row is in the WAL, but not yet confirmed */
+	struct fiber *fiber;
+	STAILQ_ENTRY(remote_write) link;
+};
+
+static STAILQ_HEAD(, remote_write) remote_writes =
+	STAILQ_HEAD_INITIALIZER(remote_writes);
+static u32 remote_writes_count;
+/* The pull fiber, waiting for a free slot or for all writes to end */
+static struct fiber *remote_writes_waiter;
+static u32 remote_writes_wait_count;
+
+/* Set while the master streams its snapshot to us */
+static bool remote_bootstrap;
 
 static int
 default_remote_row_handler(struct recovery_state *r, struct tbuf *row);
@@ -63,53 +100,157 @@ error:
 	return NULL;
 }
 
+/**
+ * Read the next frame header and, if the frame is compressed,
+ * replace it in the read buffer with the uncompressed rows.
+ */
+static int
+remote_read_frame(struct recovery_state *r)
+{
+	struct replication_frame frame;
+	ssize_t to_read = sizeof(frame) - fiber->rbuf->size;
+
+	if (to_read > 0 && fiber_bread(fiber->rbuf, to_read) <= 0)
+		return -1;
+
+	memcpy(&frame, tbuf_peek(fiber->rbuf, sizeof(frame)), sizeof(frame));
+
+	if (frame.size != frame.uncompressed_size) {
+		if ((r->remote_accepted & REPLICATION_COMPRESS) == 0) {
+			say_error("unexpected compressed frame");
+			return -1;
+		}
+
+		to_read = frame.size - fiber->rbuf->size;
+		if (to_read > 0 && fiber_bread(fiber->rbuf, to_read) <= 0)
+			return -1;
+
+		struct tbuf *rows = tbuf_alloc(fiber->gc_pool);
+		tbuf_ensure(rows, frame.uncompressed_size + fiber->rbuf->size - frame.size + 1);
+		if (lzf_decompress(fiber->rbuf->data, frame.size, rows->data,
+				   frame.uncompressed_size) != frame.uncompressed_size) {
+			say_error("can't decompress frame");
+			return -1;
+		}
+		rows->size = frame.uncompressed_size;
+		/* Keep what has already been read past the frame. */
+		tbuf_append(rows, fiber->rbuf->data + frame.size,
+			    fiber->rbuf->size - frame.size);
+		fiber->rbuf = rows;
+	}
+
+	r->remote_frame_left = frame.uncompressed_size;
+	return 0;
+}
+
+static int
+remote_handshake(struct recovery_state *r, i64 initial_lsn, const char **err)
+{
+	u32 version;
+
+	r->remote_accepted = 0;
+	r->remote_frame_left = 0;
+
+	if (r->remote_features == 0) {
+		if (fiber_write(&initial_lsn, sizeof(initial_lsn)) != sizeof(initial_lsn)) {
+			*err = "can't write version";
+			return -1;
+		}
+	} else {
+		struct replication_greeting greeting = {
+			.magic = REPLICATION_GREETING_MAGIC,
+			.lsn = initial_lsn,
+			.features = r->remote_features
+		};
+		if (fiber_write(&greeting, sizeof(greeting)) != sizeof(greeting)) {
+			*err = "can't write greeting";
+			return -1;
+		}
+	}
+
+	if (fiber_read(&version, sizeof(version)) != sizeof(version)) {
+		*err = "can't read version";
+		return -1;
+	}
+
+	if (version != default_version) {
+		*err = "remote version mismatch";
+		return -1;
+	}
+
+	if (r->remote_features != 0 &&
+	    fiber_read(&r->remote_accepted, sizeof(r->remote_accepted)) !=
+	    sizeof(r->remote_accepted)) {
+		*err = "can't read accepted features";
+		return -1;
+	}
+
+	/* Either way, it's no longer a replica with no data. */
+	remote_bootstrap = r->remote_accepted & REPLICATION_BOOTSTRAP;
+	r->remote_features &= ~REPLICATION_BOOTSTRAP;
+	return 0;
+}
+
 static struct tbuf *
-remote_read_row(struct sockaddr_in *remote_addr, i64 initial_lsn)
+remote_read_row(struct recovery_state *r, i64 initial_lsn)
 {
 	struct tbuf *row;
 	bool warning_said = false;
 	const int reconnect_delay = 1;
 	const char *err = NULL;
-	u32 version;
 
 	for (;;) {
 		if (fiber->fd < 0) {
-			if (fiber_connect(remote_addr) < 0) {
+			if (fiber_connect(&r->remote_addr) < 0) {
 				err = "can't connect to master";
 				goto err;
 			}
 
-			if (fiber_write(&initial_lsn, sizeof(initial_lsn)) != sizeof(initial_lsn)) {
-				err = "can't write version";
-				goto err;
-			}
-
-			if (fiber_read(&version, sizeof(version)) != sizeof(version)) {
-				err = "can't read version";
-				goto err;
-			}
+			/* Drop whatever is left from the old connection. */
+			tbuf_reset(fiber->rbuf);
 
-			if (version != default_version) {
-				err = "remote version mismatch";
+			if (remote_handshake(r, initial_lsn, &err) != 0)
 				goto err;
-			}
 
 			say_crit("successfully connected to master");
-			say_crit("starting replication from lsn:%" PRIi64, initial_lsn);
+			say_crit("starting replication from lsn:%" PRIi64
+				 ", features:0x%" PRIx32, initial_lsn, r->remote_accepted);
 
 			warning_said = false;
 			err = NULL;
 		}
 
+		if (r->remote_accepted & REPLICATION_FRAMES) {
+			while (r->remote_frame_left == 0) {
+				if (remote_read_frame(r) != 0) {
+					err = "can't read frame";
+					goto err;
+				}
+			}
+		}
+
 		row = remote_row_reader_v11();
 		if (row == NULL) {
 			err = "can't read row";
 			goto err;
 		}
 
+		if (r->remote_accepted & REPLICATION_FRAMES) {
+			if (row->size > r->remote_frame_left) {
+				err = "row crosses frame boundary";
+				goto err;
+			}
+			r->remote_frame_left -= row->size;
+		}
+
 		return row;
 
 	      err:
+		/* Can't resume: a part of the snapshot is applied. */
+		if (remote_bootstrap)
+			panic("replica bootstrap interrupted: %s, "
+			      "remove the data and restart the replica", err);
+
 		if (err != NULL && !warning_said) {
 			say_info("%s", err);
 			say_info("will retry every %i second", reconnect_delay);
@@ -120,6 +261,77 @@ remote_read_row(struct sockaddr_in *remote_addr, i64 initial_lsn)
 	}
 }
 
+/**
+ * Apply a row of the snapshot streamed by the master. The rows
+ * go straight to the module, the way a local snapshot is loaded,
+ * rather than to the WAL: once the snapshot is over, it's saved
+ * locally at once.
+ */
+static void
+remote_bootstrap_row(struct recovery_state *r, struct tbuf *row)
+{
+	i64 lsn = row_v11(row)->lsn;
+	u16 tag;
+
+	if (row_v11(row)->len < sizeof(tag))
+		panic("replication failure: bad snapshot row");
+	memcpy(&tag, row_v11(row)->data, sizeof(tag));
+	if (tag != snap_tag)
+		panic("replication failure: unexpected row in snapshot");
+
+	if (lsn == 0) {
+		if (r->row_handler(r, row) < 0)
+			panic("replication failure: can't apply snapshot row");
+		return;
+	}
+
+	/* A row with the snapshot LSN marks the end. */
+	remote_bootstrap = false;
+	r->lsn = r->confirmed_lsn = lsn;
+	say_info("bootstrapped from the master, saving snapshot, lsn:%" PRIi64, lsn);
+	if (snapshot(NULL, 0) != 0)
+		panic("can't save the bootstrapped snapshot");
+}
+
+/** Wait until no more than count rows are being written to the WAL. */
+static void
+remote_writes_wait(u32 count)
+{
+	while (remote_writes_count > count) {
+		remote_writes_waiter = fiber;
+		remote_writes_wait_count = count;
+		fiber_yield();
+		remote_writes_waiter = NULL;
+	}
+}
+
+static void
+remote_write_row(void *data)
+{
+	struct remote_write *w = data;
+	struct recovery_state *r = w->r;
+
+	if (wal_write(r, w->tag, r->cookie, w->lsn, w->data) == false)
+		panic("replication failure: can't write row to WAL");
+
+	/* Let the rows before this one be confirmed first. */
+	while (STAILQ_FIRST(&remote_writes) != w) {
+		w->fiber = fiber;
+		fiber_yield();
+	}
+
+	STAILQ_REMOVE_HEAD(&remote_writes, link);
+	remote_writes_count--;
+	confirm_lsn(r, w->lsn);
+
+	struct remote_write *next = STAILQ_FIRST(&remote_writes);
+	if (next != NULL && next->fiber != NULL)
+		fiber_wakeup(next->fiber);
+	if (remote_writes_waiter != NULL &&
+	    remote_writes_count <= remote_writes_wait_count)
+		fiber_wakeup(remote_writes_waiter);
+}
+
 static void
 pull_from_remote(void *state)
 {
@@ -127,18 +339,46 @@ pull_from_remote(void *state)
 	struct tbuf *row;
 
 	for (;;) {
+		/*
+		 * Rows being written to the WAL are already
+		 * applied: never ask the master for them again.
+		 */
 		fiber_setcancelstate(true);
-		row = remote_read_row(&r->remote_addr, r->confirmed_lsn + 1);
+		row = remote_read_row(r, r->lsn + 1);
 		fiber_setcancelstate(false);
 
 		r->recovery_lag = ev_now() - row_v11(row)->tm;
 		r->recovery_last_update_tstamp = ev_now();
 
+		if (remote_bootstrap) {
+			remote_bootstrap_row(r, row);
+			fiber_gc();
+			continue;
+		}
+
 		if (default_remote_row_handler(r, row) < 0) {
 			fiber_close();
 			continue;
 		}
 
+		/* Acknowledge a whole batch of rows at once. */
+		bool batch_end = fiber->rbuf->size == 0 ||
+			((r->remote_accepted & REPLICATION_FRAMES) &&
+			 r->remote_frame_left == 0);
+		if ((r->remote_accepted & REPLICATION_ACK) && batch_end) {
+			remote_writes_wait(0);
+			if (fiber_write(&r->confirmed_lsn, sizeof(r->confirmed_lsn)) !=
+			    sizeof(r->confirmed_lsn)) {
+				say_info("can't send acknowledgement");
+				fiber_close();
+				continue;
+			}
+		}
+
+		/*
+		 * Rows of a decompressed frame live in the
+		 * read buffer, which survives fiber_gc().
+		 */
 		fiber_gc();
 	}
 }
@@ -150,6 +390,14 @@ default_remote_row_handler(struct recovery_state *r, struct tbuf *row)
 	i64 lsn = row_v11(row)->lsn;
 	u16 tag;
 
+	/*
+	 * Don't overflow the WAL writer inbox: a failed
+	 * write is fatal for a replica.
+	 */
+	u32 writes_max = MIN(REMOTE_WRITES_MAX,
+			     r->wal_writer->out->inbox->size - 1);
+	remote_writes_wait(writes_max > 0 ? writes_max - 1 : 0);
+
 	/* save row data since wal_row_handler may clobber it */
 	data = tbuf_alloc(row->pool);
 	tbuf_append(data, row_v11(row)->data, row_v11(row)->len);
@@ -160,11 +408,24 @@ default_remote_row_handler(struct recovery_state *r, struct tbuf *row)
 	tag = read_u16(data);
 	(void)read_u64(data); /* drop the cookie */
 
-	if (wal_write(r, tag, r->cookie, lsn, data) == false)
-		panic("replication failure: can't write row to WAL");
-
 	next_lsn(r, lsn);
-	confirm_lsn(r, lsn);
+
+	struct fiber *f = fiber_create("replica/wal", -1, -1,
+				       remote_write_row, NULL);
+	if (f == NULL)
+		panic("replication failure: can't create a WAL write fiber");
+
+	struct remote_write *w = palloc(f->gc_pool, sizeof(*w));
+	w->r = r;
+	w->lsn = lsn;
+	w->tag = tag;
+	w->data = tbuf_clone(f->gc_pool, data);
+	w->fiber = NULL;
+	f->f_data = w;
+
+	STAILQ_INSERT_TAIL(&remote_writes, w, link);
+	remote_writes_count++;
+	fiber_call(f);
 
 	return 0;
 }
@@ -211,6 +472,8 @@ recovery_stop_remote(struct recovery_state *r)
 {
 	say_info("shutting down the replica");
 	fiber_cancel(r->remote_recovery);
+	/* Let the rows already applied reach the WAL. */
+	remote_writes_wait(0);
 	r->remote_recovery = NULL;
 	memset(&r->remote_addr, 0, sizeof(r->remote_addr));
 }
@@ -26,11 +26,14 @@
 #include <replication.h>
 #include <say.h>
 #include <fiber.h>
+#include <log_io.h>
 #include TARANTOOL_CONFIG
 #include <palloc.h>
 #include <stddef.h>
 
 #include <stddef.h>
+#include <fcntl.h>
+#include <third_party/lzf.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/wait.h>
@@ -65,9 +68,69 @@
  * Upon shutdown, the master closes its end of the socket pair.
  * The spawner then reads EOF from its end, terminates all
  * children and exits.
+ *
+ * Most replicas, however, are up to date or lag only slightly
+ * behind the master, and the rows they need are still in the
+ * master's memory. The master keeps a ring of recently written
+ * WAL rows (struct wal_ring), and the acceptor first hands every
+ * client socket to an in-process relay fiber. If the requested
+ * LSN is in the ring, the fiber streams rows straight from memory
+ * as soon as they are written, batching them into large writev()
+ * calls. Only replicas asking for older rows are sent to the
+ * spawner and served from xlog files. A fiber relay which falls
+ * so far behind that its rows are evicted from the ring closes
+ * the connection, and the replica reconnects to a file relay.
+ *
+ * Replicas may acknowledge the rows they have written
+ * (REPLICATION_ACK). Fiber relays keep track of the acknowledged
+ * LSN of each replica, which allows a committing fiber to wait
+ * until a quorum of replicas has the row
+ * (replication_wait_quorum()). A file relay of an acknowledging
+ * replica exits as soon as it has sent everything there is in
+ * the xlog files, so that the replica reconnects to a fiber
+ * relay and is counted in the quorum.
  */
 static int master_to_spawner_sock;
 
+/** Stop collecting rows for a write once this much is queued. */
+#define RELAY_BATCH_SIZE (256 * 1024)
+
+/** An in-process replication relay. */
+struct relay {
+	struct fiber *fiber;
+	struct wal_ring_reader reader;
+	/** Accepted replication_features. */
+	u32 features;
+	/** Bytes of rows sent, before and after compression. */
+	u64 bytes_rows, bytes_sent;
+	/** The last LSN acknowledged by the replica. */
+	i64 acked_lsn;
+	/** Reads acknowledgements, see REPLICATION_ACK. */
+	ev_io ack_ev;
+	/** A partially read acknowledgement. */
+	union {
+		i64 lsn;
+		u8 data[sizeof(i64)];
+	} ack;
+	size_t ack_size;
+	/** Set when the replica has closed the connection. */
+	bool closed;
+	SLIST_ENTRY(relay) link;
+};
+
+/** All in-process relays, for show info. */
+static SLIST_HEAD(, relay) relays = SLIST_HEAD_INITIALIZER(relays);
+
+/** A fiber waiting for a quorum of acknowledgements. */
+struct quorum_waiter {
+	struct fiber *fiber;
+	i64 lsn;
+	SLIST_ENTRY(quorum_waiter) link;
+};
+
+static SLIST_HEAD(, quorum_waiter) quorum_waiters =
+	SLIST_HEAD_INITIALIZER(quorum_waiters);
+
 /** replication_port acceptor fiber */
 static void
 acceptor_handler(void *data __attribute__((unused)));
@@ -75,9 +138,17 @@ acceptor_handler(void *data __attribute__((unused)));
 /** Send a file descriptor to replication relay spawner.
  *
  * @param client_sock the file descriptor to be sent.
+ * @param request the replica's request, already read from it.
+ * @param size the size of the request.
  */
 static void
-acceptor_send_sock(int client_sock);
+acceptor_send_sock(int client_sock, void *request, size_t size);
+
+/** In-process replication relay fiber: sends rows from the WAL
+ * ring or passes the client to the spawner.
+ */
+static void
+relay_fiber_handler(void *data __attribute__((unused)));
 
 /** Replication spawner process */
 static struct spawner {
@@ -117,7 +188,7 @@ spawner_sigchld_handler(int signal __attribute__((unused)));
  * @return 0 on success, -1 on error
  */
 static int
-spawner_create_replication_relay(int client_sock);
+spawner_create_replication_relay(int client_sock, void *request, size_t size);
 
 /** Shut down all relays when shutting down the spawner. */
 static void
@@ -125,7 +196,7 @@ spawner_shutdown_children();
 
 /** Initialize replication relay process. */
 static void
-replication_relay_loop(int client_sock);
+replication_relay_loop(int client_sock, void *request, size_t size);
 
 /** A libev callback invoked when a relay client socket is ready
  * for read. This currently only happens when the client closes
@@ -138,6 +209,27 @@ replication_relay_recv(struct ev_io *w, int revents);
 static int
 replication_relay_send_row(struct recovery_state *r __attribute__((unused)), struct tbuf *t);
 
+/** Write a buffer to the client. */
+static void
+replication_relay_write(struct tbuf *t);
+
+/** Send the rows collected so far in a frame. */
+static void
+replication_relay_flush(void);
+
+/** A libev callback invoked before the relay goes to sleep. */
+static void
+replication_relay_prepare(struct ev_prepare *w, int revents);
+
+/** Replication relay process (one per client) */
+static struct {
+	/** accepted replication_features */
+	u32 features;
+	/** rows to be sent in the next frame, when using frames */
+	struct palloc_pool *pool;
+	struct tbuf *rows;
+} relay_process;
+
 
 /*-----------------------------------------------------------------------------*/
 /* replication module                                                          */
@@ -154,6 +246,13 @@ replication_check_config(struct tarantool_cfg *config)
 		return -1;
 	}
 
+	if (config->replication_port != 0 &&
+	    config->replication_ring_size <= 0) {
+		say_error("invalid replication ring size: %"PRId32,
+			  config->replication_ring_size);
+		return -1;
+	}
+
 	return 0;
 }
 
@@ -211,6 +310,9 @@ replication_init()
 
 	char fiber_name[FIBER_NAME_MAXLEN];
 
+	recovery_state->wal_ring = wal_ring_create(cfg.replication_ring_size,
+						   recovery_state->confirmed_lsn);
+
 	/* create acceptor fiber */
 	snprintf(fiber_name, FIBER_NAME_MAXLEN, "%i/replication", cfg.replication_port);
 
@@ -254,30 +356,342 @@ acceptor_handler(void *data __attribute__((unused)))
 		}
 		fiber_io_stop(fiber->fd, EV_READ);
 		say_info("connection from %s:%d", inet_ntoa(addr.sin_addr), ntohs(addr.sin_port));
-		acceptor_send_sock(client_sock);
+
+		if (set_nonblock(client_sock) == -1) {
+			say_error("can't set nonblock");
+			close(client_sock);
+			continue;
+		}
+
+		struct fiber *relay = fiber_create("relay", client_sock, -1,
+						   relay_fiber_handler, NULL);
+		if (relay == NULL) {
+			say_error("can't create relay fiber, dropping client connection");
+			close(client_sock);
+			continue;
+		}
+		relay->has_peer = true;
+		fiber_call(relay);
+	}
+}
+
+/** Read the replica's request. It stays in fiber->rbuf, for
+ * a file relay to get it, see relay_fallback_to_spawner().
+ *
+ * @return the size of the request, -1 if the client is gone.
+ */
+static ssize_t
+relay_read_request(struct replication_greeting *greeting)
+{
+	struct tbuf *rbuf = fiber->rbuf;
+	size_t size = sizeof(*greeting);
+
+	if (rbuf->size < sizeof(greeting->magic) &&
+	    fiber_bread(rbuf, sizeof(greeting->magic) - rbuf->size) <= 0)
+		return -1;
+
+	/* The original protocol: a bare LSN. */
+	if (*(i64 *) rbuf->data != REPLICATION_GREETING_MAGIC)
+		size = sizeof(greeting->magic);
+
+	if (rbuf->size < size && fiber_bread(rbuf, size - rbuf->size) <= 0)
+		return -1;
+
+	memset(greeting, 0, sizeof(*greeting));
+	if (size == sizeof(greeting->magic))
+		greeting->lsn = *(i64 *) rbuf->data;
+	else
+		memcpy(greeting, rbuf->data, size);
+	return size;
+}
+
+/** Features a relay agrees to use out of the requested ones. */
+static u32
+relay_accept_features(u32 features)
+{
+	u32 accepted = features & REPLICATION_ACK;
+
+	if (features & REPLICATION_FRAMES)
+		accepted |= features & (REPLICATION_FRAMES | REPLICATION_COMPRESS);
+	return accepted;
+}
+
+/** The number of replicas which have acknowledged the LSN. */
+static int
+replication_acked(i64 lsn)
+{
+	struct relay *relay;
+	int count = 0;
+
+	SLIST_FOREACH(relay, &relays, link) {
+		if (relay->acked_lsn >= lsn)
+			count++;
+	}
+	return count;
+}
+
+int
+replication_wait_quorum(i64 lsn, int quorum, ev_tstamp timeout)
+{
+	struct quorum_waiter waiter = { .fiber = fiber, .lsn = lsn };
+	ev_tstamp deadline = ev_now() + timeout;
+
+	while (replication_acked(lsn) < quorum) {
+		if (ev_now() >= deadline)
+			return -1;
+
+		/* Not a cancellation point: the row is already written. */
+		SLIST_INSERT_HEAD(&quorum_waiters, &waiter, link);
+		wheel_timer_start(&fiber->timer, deadline - ev_now());
+		fiber_yield();
+		wheel_timer_stop(&fiber->timer);
+		SLIST_REMOVE(&quorum_waiters, &waiter, quorum_waiter, link);
+	}
+	return 0;
+}
+
+/** Let the waiters for this LSN or older recount the acknowledgements. */
+static void
+relay_wakeup_quorum_waiters(i64 lsn)
+{
+	struct quorum_waiter *waiter;
+
+	/* Waiters run later, from the event loop, not inside this callback. */
+	SLIST_FOREACH(waiter, &quorum_waiters, link) {
+		if (waiter->lsn <= lsn)
+			fiber_wakeup(waiter->fiber);
+	}
+}
+
+/** Replica is gone: make its relay fiber notice it. */
+static void
+relay_close(struct relay *relay)
+{
+	relay->closed = true;
+	ev_io_stop(&relay->ack_ev);
+	if (relay->reader.fiber != NULL)
+		fiber_wakeup(relay->fiber);
+}
+
+/** A libev callback invoked when there are acknowledgements to read. */
+static void
+relay_ack_cb(struct ev_io *w, int revents __attribute__((unused)))
+{
+	struct relay *relay = w->data;
+	ssize_t r;
+
+	for (;;) {
+		r = recv(w->fd, relay->ack.data + relay->ack_size,
+			 sizeof(relay->ack) - relay->ack_size, 0);
+		if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break;
+		if (r <= 0) {
+			if (r < 0 && errno != ECONNRESET)
+				say_syserror("recv");
+			relay_close(relay);
+			return;
+		}
+		relay->ack_size += r;
+		if (relay->ack_size < sizeof(relay->ack))
+			continue;
+
+		relay->ack_size = 0;
+		if (relay->ack.lsn > relay->acked_lsn)
+			relay->acked_lsn = relay->ack.lsn;
+	}
+	relay_wakeup_quorum_waiters(relay->acked_lsn);
+}
+
+/** Wrap rows into a frame, compressing them if asked to and if
+ * that makes them smaller.
+ */
+static struct tbuf *
+relay_frame(struct palloc_pool *pool, struct tbuf *rows, bool compress)
+{
+	struct tbuf *frame = tbuf_alloc(pool);
+	struct replication_frame *header;
+	size_t size = 0;
+
+	tbuf_ensure(frame, sizeof(*header) + rows->size);
+	if (compress)
+		size = lzf_compress(rows->data, rows->size,
+				    frame->data + sizeof(*header), rows->size - 1);
+	if (size == 0) {
+		memcpy(frame->data + sizeof(*header), rows->data, rows->size);
+		size = rows->size;
+	}
+	header = frame->data;
+	header->size = size;
+	header->uncompressed_size = rows->size;
+	frame->size = sizeof(*header) + size;
+	return frame;
+}
+
+/** Hand the client over to a file relay in the spawner. */
+static void
+relay_fallback_to_spawner(void *request, size_t size)
+{
+	/* Left armed by fiber_bread(). */
+	if (ev_is_active(&fiber->io))
+		fiber_io_stop(fiber->fd, EV_READ);
+	/*
+	 * The file relay uses blocking I/O, and O_NONBLOCK
+	 * is shared by all copies of the descriptor.
+	 */
+	int flags = fcntl(fiber->fd, F_GETFL, 0);
+	if (flags < 0 || fcntl(fiber->fd, F_SETFL, flags & ~O_NONBLOCK) < 0) {
+		say_syserror("fcntl");
+		return;
+	}
+	acceptor_send_sock(fiber->fd, request, size);
+	/* The socket is closed by acceptor_send_sock(). */
+	fiber->fd = -1;
+	fiber->has_peer = false;
+}
+
+/** In-process relay fiber handler. */
+static void
+relay_fiber_handler(void *data __attribute__((unused)))
+{
+	struct wal_ring *ring = recovery_state->wal_ring;
+	struct replication_greeting greeting;
+	struct relay relay;
+	char name[FIBER_NAME_MAXLEN];
+	struct row_v11 *row;
+	ssize_t request_size;
+
+	snprintf(name, sizeof(name), "relay/%s", fiber_peer_name(fiber));
+	fiber_set_name(fiber, name);
+
+	request_size = relay_read_request(&greeting);
+	if (request_size < 0) {
+		say_info("the client has closed its replication socket");
+		return;
+	}
+
+	if (!wal_ring_has(ring, greeting.lsn)) {
+		say_info("lsn:%"PRIi64" is not in the WAL ring, "
+			 "relaying from xlog files", greeting.lsn);
+		relay_fallback_to_spawner(fiber->rbuf->data, request_size);
+		return;
+	}
+	tbuf_ltrim(fiber->rbuf, request_size);
+
+	memset(&relay, 0, sizeof(relay));
+	relay.fiber = fiber;
+	relay.reader.lsn = greeting.lsn;
+	if (request_size == sizeof(greeting))
+		relay.features = relay_accept_features(greeting.features);
+
+	say_info("starting relay from memory, lsn:%"PRIi64", features:0x%"PRIx32,
+		 relay.reader.lsn, relay.features);
+	iov_add(&default_version, sizeof(default_version));
+	if (request_size == sizeof(greeting))
+		iov_add(&relay.features, sizeof(relay.features));
+
+	/*
+	 * Replicas which don't acknowledge rows only ever send
+	 * EOF, which is better noticed right away, too.
+	 */
+	ev_io_init(&relay.ack_ev, relay_ack_cb, fiber->fd, EV_READ);
+	relay.ack_ev.data = &relay;
+	ev_io_start(&relay.ack_ev);
+
+	SLIST_INSERT_HEAD(&ring->readers, &relay.reader, link);
+	SLIST_INSERT_HEAD(&relays, &relay, link);
+	@try {
+		while (!relay.closed) {
+			struct tbuf *rows = tbuf_alloc(fiber->gc_pool);
+
+			/*
+			 * Copy the rows: they may be evicted while
+			 * we're waiting for the socket.
+			 */
+			while (rows->size < RELAY_BATCH_SIZE &&
+			       (row = wal_ring_row(ring, relay.reader.lsn)) != NULL) {
+				tbuf_append(rows, row, sizeof(*row) + row->len);
+				relay.reader.lsn++;
+			}
+
+			if (rows->size > 0) {
+				relay.bytes_rows += rows->size;
+				if (relay.features & REPLICATION_FRAMES)
+					rows = relay_frame(fiber->gc_pool, rows,
+							   relay.features & REPLICATION_COMPRESS);
+				relay.bytes_sent += rows->size;
+				iov_add(rows->data, rows->size);
+			}
+
+			if (fiber->iov_cnt > 0) {
+				if (iov_flush() < 0)
+					break;
+				fiber_gc();
+				continue;
+			}
+
+			if (relay.reader.lsn < ring->first_lsn) {
+				say_warn("relay fell behind the WAL ring at lsn:%"PRIi64
+					 ", disconnecting", relay.reader.lsn);
+				break;
+			}
+
+			wal_ring_wait(ring, &relay.reader);
+		}
+	} @finally {
+		ev_io_stop(&relay.ack_ev);
+		SLIST_REMOVE(&relays, &relay, relay, link);
+		SLIST_REMOVE(&ring->readers, &relay.reader, wal_ring_reader, link);
 	}
+	say_info("closing relay at lsn:%"PRIi64, relay.reader.lsn);
 }
 
+void
+replication_info(struct tbuf *out)
+{
+	struct wal_ring *ring = recovery_state->wal_ring;
+	struct relay *relay;
+
+	if (ring == NULL)
+		return;
+
+	tbuf_printf(out, "  replication:" CRLF);
+	SLIST_FOREACH(relay, &relays, link) {
+		struct row_v11 *row = wal_ring_row(ring, relay->reader.lsn);
+		ev_tstamp lag = row != NULL ? ev_now() - row->tm : 0;
+		double ratio = relay->bytes_sent > 0 ?
+			(double) relay->bytes_rows / relay->bytes_sent : 1;
+
+		tbuf_printf(out, "    - peer: %s" CRLF, fiber_peer_name(relay->fiber));
+		tbuf_printf(out, "      lsn: %" PRIi64 CRLF, relay->reader.lsn - 1);
+		if (relay->features & REPLICATION_ACK)
+			tbuf_printf(out, "      acked_lsn: %" PRIi64 CRLF, relay->acked_lsn);
+		tbuf_printf(out, "      lag: %.3f" CRLF, lag);
+		tbuf_printf(out, "      bytes_sent: %" PRIu64 CRLF, relay->bytes_sent);
+		tbuf_printf(out, "      compression_ratio: %.2f" CRLF, ratio);
+	}
+}
 
 /** Send a file descriptor to the spawner. */
 static void
-acceptor_send_sock(int client_sock)
+acceptor_send_sock(int client_sock, void *request, size_t size)
 {
 	struct msghdr msg;
-	struct iovec iov[1];
+	struct iovec iov[2];
 	char control_buf[CMSG_SPACE(sizeof(int))];
 	struct cmsghdr *control_message = NULL;
 	int cmd_code = 0;
 
 	iov[0].iov_base = &cmd_code;
 	iov[0].iov_len = sizeof(cmd_code);
+	iov[1].iov_base = request;
+	iov[1].iov_len = size;
 
 	memset(&msg, 0, sizeof(msg));
 
 	msg.msg_name = NULL;
 	msg.msg_namelen = 0;
 	msg.msg_iov = iov;
-	msg.msg_iovlen = 1;
+	msg.msg_iovlen = 2;
 	msg.msg_control = control_buf;
 	msg.msg_controllen = sizeof(control_buf);
 
@@ -371,18 +785,21 @@ static void
 spawner_main_loop()
 {
 	struct msghdr msg;
-	struct iovec iov[1];
+	struct iovec iov[2];
 	char control_buf[CMSG_SPACE(sizeof(int))];
 	int cmd_code = 0;
+	struct replication_greeting request;
 	int client_sock;
 
 	iov[0].iov_base = &cmd_code;
 	iov[0].iov_len = sizeof(cmd_code);
+	iov[1].iov_base = &request;
+	iov[1].iov_len = sizeof(request);
 
 	msg.msg_name = NULL;
 	msg.msg_namelen = 0;
 	msg.msg_iov = iov;
-	msg.msg_iovlen = 1;
+	msg.msg_iovlen = 2;
 	msg.msg_control = control_buf;
 	msg.msg_controllen = sizeof(control_buf);
 
@@ -390,7 +807,8 @@ spawner_main_loop()
 		int msglen = recvmsg(spawner.sock, &msg, 0);
 		if (msglen > 0) {
 			client_sock = spawner_unpack_cmsg(&msg);
-			spawner_create_replication_relay(client_sock);
+			spawner_create_replication_relay(client_sock, &request,
+							 msglen - sizeof(cmd_code));
 		} else if (msglen == 0) { /* orderly master shutdown */
 			say_info("Exiting: master shutdown");
 			break;
@@ -443,7 +861,7 @@ spawner_sigchld_handler(int signo __attribute__((unused)))
 
 /** Create replication client handler process. */
 static int
-spawner_create_replication_relay(int client_sock)
+spawner_create_replication_relay(int client_sock, void *request, size_t size)
 {
 	pid_t pid = fork();
 
@@ -456,7 +874,7 @@ spawner_create_replication_relay(int client_sock)
 		ev_default_fork();
 		ev_loop(EVLOOP_NONBLOCK);
 		close(spawner.sock);
-		replication_relay_loop(client_sock);
+		replication_relay_loop(client_sock, request, size);
 	} else {
 		spawner.child_count++;
 		close(client_sock);
@@ -538,14 +956,13 @@ retry:
 
 /** The main loop of replication client service process. */
 static void
-replication_relay_loop(int client_sock)
+replication_relay_loop(int client_sock, void *request, size_t size)
 {
 	char name[FIBER_NAME_MAXLEN];
 	struct sigaction sa;
 	struct recovery_state *log_io;
 	struct tbuf *ver;
 	i64 lsn;
-	ssize_t r;
 
 	fiber->has_peer = true;
 	fiber->fd = client_sock;
@@ -573,21 +990,58 @@ replication_relay_loop(int client_sock)
 	if (sigaction(SIGPIPE, &sa, NULL) == -1)
 		say_syserror("sigaction");
 
-	r = read(fiber->fd, &lsn, sizeof(lsn));
-	if (r != sizeof(lsn)) {
-		if (r < 0) {
-			panic_syserror("read");
-		}
-		panic("invalid LSN request size: %zu", r);
+	/* The request was read by the relay fiber in the master. */
+	struct replication_greeting greeting = { .features = 0 };
+	bool greeted = size == sizeof(greeting);
+	if (greeted) {
+		memcpy(&greeting, request, sizeof(greeting));
+		lsn = greeting.lsn;
+		relay_process.features = relay_accept_features(greeting.features);
+	} else if (size == sizeof(lsn)) {
+		memcpy(&lsn, request, sizeof(lsn));
+	} else {
+		panic("invalid LSN request size: %zu", size);
 	}
-	say_info("starting recovery from lsn:%"PRIi64, lsn);
+
+	/* init libev events handlers */
+	ev_default_loop(0);
+
+	/* init reovery porcess */
+	log_io = recover_init(cfg.snap_dir, cfg.wal_dir,
+			      replication_relay_send_row, INT32_MAX, 0, 64, RECOVER_READONLY, false);
+
+	/*
+	 * A replica with no data is better off with the latest
+	 * snapshot than with all the xlogs since the beginning
+	 * of time, if there are any.
+	 */
+	if ((greeting.features & REPLICATION_BOOTSTRAP) &&
+	    greatest_lsn(log_io->snap_class) >= lsn)
+		relay_process.features |= REPLICATION_BOOTSTRAP;
+
+	say_info("starting recovery from lsn:%"PRIi64", features:0x%"PRIx32,
+		 lsn, relay_process.features);
 
 	ver = tbuf_alloc(fiber->gc_pool);
 	tbuf_append(ver, &default_version, sizeof(default_version));
-	replication_relay_send_row(NULL, ver);
+	if (greeted)
+		tbuf_append(ver, &relay_process.features, sizeof(relay_process.features));
+	replication_relay_write(ver);
 
-	/* init libev events handlers */
-	ev_default_loop(0);
+	/*
+	 * With frames, rows are collected and sent either when
+	 * there are enough of them or when there are no more
+	 * rows to read for now, i.e. right before the relay
+	 * goes to sleep. That's also when an acknowledging
+	 * replica is handed over to the master.
+	 */
+	struct ev_prepare flush_ev;
+	if (relay_process.features & (REPLICATION_FRAMES | REPLICATION_ACK)) {
+		relay_process.pool = palloc_create_pool("relay");
+		relay_process.rows = tbuf_alloc(relay_process.pool);
+		ev_prepare_init(&flush_ev, replication_relay_prepare);
+		ev_prepare_start(&flush_ev);
+	}
 
 	/* init read events */
 	struct ev_io sock_read_ev;
@@ -596,9 +1050,20 @@ replication_relay_loop(int client_sock)
 	ev_io_init(&sock_read_ev, replication_relay_recv, sock_read_fd, EV_READ);
 	ev_io_start(&sock_read_ev);
 
-	/* init reovery porcess */
-	log_io = recover_init(NULL, cfg.wal_dir,
-			      replication_relay_send_row, INT32_MAX, 0, 64, RECOVER_READONLY, false);
+	/*
+	 * The snapshot is read from disk by this process, so
+	 * the master doesn't need to fork to produce one.
+	 */
+	if (relay_process.features & REPLICATION_BOOTSTRAP) {
+		if (recover_snap(log_io) != 0)
+			panic("can't relay the snapshot");
+		say_info("sent the snapshot, lsn:%"PRIi64, log_io->confirmed_lsn);
+
+		struct tbuf *end = convert_to_v11(tbuf_alloc(fiber->gc_pool),
+						  snap_tag, 0, log_io->confirmed_lsn);
+		replication_relay_send_row(log_io, end);
+		lsn = log_io->confirmed_lsn + 1;
+	}
 
 	recover(log_io, lsn);
 	recover_follow(log_io, 0.1);
@@ -614,9 +1079,9 @@ static void
 replication_relay_recv(struct ev_io *w, int __attribute__((unused)) revents)
 {
 	int fd = *((int *)w->data);
-	u8 data;
+	u8 data[64];
 
-	int result = recv(fd, &data, sizeof(data), 0);
+	int result = recv(fd, data, sizeof(data), 0);
 
 	if (result == 0 || (result < 0 && errno == ECONNRESET)) {
 		say_info("the client has closed its replication socket, exiting");
@@ -624,13 +1089,15 @@ replication_relay_recv(struct ev_io *w, int __attribute__((unused)) revents)
 	}
 	if (result < 0)
 		say_syserror("recv");
+	else if (relay_process.features & REPLICATION_ACK)
+		return; /* nobody waits for acknowledgements here */
 
 	exit(EXIT_FAILURE);
 }
 
-/** Send to row to client. */
-static int
-replication_relay_send_row(struct recovery_state *r __attribute__((unused)), struct tbuf *t)
+/** Write a buffer to the client. */
+static void
+replication_relay_write(struct tbuf *t)
 {
 	u8 *data = t->data;
 	ssize_t bytes, len = t->size;
@@ -646,11 +1113,49 @@ replication_relay_send_row(struct recovery_state *r __attribute__((unused)), str
 		len -= bytes;
 		data += bytes;
 	}
-
-	say_debug("send row: %" PRIu32 " bytes %s", t->size, tbuf_to_hex(t));
-	return 0;
+	return;
 shutdown_handler:
 	say_info("the client has closed its replication socket, exiting");
 	exit(EXIT_SUCCESS);
 }
 
+/** Send to row to client. */
+static int
+replication_relay_send_row(struct recovery_state *r __attribute__((unused)), struct tbuf *t)
+{
+	if (relay_process.features & REPLICATION_FRAMES) {
+		tbuf_append(relay_process.rows, t->data, t->size);
+		if (relay_process.rows->size >= RELAY_BATCH_SIZE)
+			replication_relay_flush();
+	} else {
+		replication_relay_write(t);
+	}
+
+	say_debug("send row: %" PRIu32 " bytes %s", t->size, tbuf_to_hex(t));
+	return 0;
+}
+
+/** Send the collected rows in a frame. */
+static void
+replication_relay_flush(void)
+{
+	struct tbuf *frame = relay_frame(relay_process.pool, relay_process.rows,
+					 relay_process.features & REPLICATION_COMPRESS);
+	replication_relay_write(frame);
+	prelease(relay_process.pool);
+	relay_process.rows = tbuf_alloc(relay_process.pool);
+}
+
+static void
+replication_relay_prepare(struct ev_prepare *w __attribute__((unused)),
+			  int revents __attribute__((unused)))
+{
+	if (relay_process.rows->size > 0)
+		replication_relay_flush();
+
+	if (relay_process.features & REPLICATION_ACK) {
+		say_info("sent all rows from xlog files, "
+			 "handing the replica over to the master");
+		exit(EXIT_SUCCESS);
+	}
+}
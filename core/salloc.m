@@ -26,18 +26,22 @@
 #include "salloc.h"
 
 #include "config.h"
+#include <errno.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <unistd.h>
 
 #include "third_party/valgrind/memcheck.h"
 #include <third_party/queue.h>
 #include <util.h>
 #include <tbuf.h>
 #include <say.h>
+#include <tarantool_ev.h>
 
 #define SLAB_ALIGN_PTR(ptr) (void *)((uintptr_t)(ptr) & ~(SLAB_SIZE - 1))
 
@@ -63,6 +67,12 @@ struct slab {
 	struct slab_item *free;
 	struct slab_class *class;
 	void *brk;
+	/** Items are being moved out, see slab_evacuate_begin(). */
+	bool evacuating;
+	/** When the slab became empty, for slab_reclaim(). */
+	ev_tstamp free_since;
+	/** The pages of an empty slab are given back to the OS. */
+	bool released;
 	 SLIST_ENTRY(slab) link;
 	 SLIST_ENTRY(slab) free_link;
 	 TAILQ_ENTRY(slab) class_free_link;
@@ -75,6 +85,13 @@ TAILQ_HEAD(slab_tailq_head, slab);
 struct slab_class {
 	size_t item_size;
 	struct slab_tailq_head slabs, free_slabs;
+	/** Sparse slabs taken out of free_slabs while evacuated. */
+	struct slab_tailq_head evacuating;
+	u32 n_slabs;
+	u64 n_items;
+	u64 bytes_used;
+	/** Allocations failed for the lack of a slab. */
+	u64 n_failures;
 };
 
 struct arena {
@@ -84,6 +101,15 @@ struct arena {
 	void *base;
 	size_t size;
 	size_t used;
+
+	/** How the arena is backed: "hugetlb", "thp" or "none". */
+	const char *huge_pages;
+	/**
+	 * Page size the arena is backed with, in bytes. With "thp",
+	 * the transparent huge page size the kernel may use.
+	 */
+	size_t page_size;
+	bool prefaulted;
 };
 
 size_t slab_active_classes;
@@ -92,6 +118,11 @@ struct arena arena;
 
 struct slab_slist_head slabs, free_slabs;
 
+void (*salloc_on_shortage)(void) = NULL;
+
+static ev_timer reclaim_timer;
+static ev_tstamp reclaim_delay;
+
 static struct slab *
 slab_header(void *ptr)
 {
@@ -104,14 +135,19 @@ static void
 slab_classes_init(size_t minimal, double factor)
 {
 	int i, size;
-	const size_t ptr_size = sizeof(void *);
+	/*
+	 * Item sizes, and so items, stay 8-byte aligned: a free
+	 * item holds a pointer, and a tuple may hold NUM64 fields.
+	 */
+	const size_t align = sizeof(u64);
 
-	for (i = 0, size = minimal; i < nelem(slab_classes) && size <= MAX_SLAB_ITEM; i++) {
+	for (i = 0, size = (minimal + align - 1) & ~(align - 1); i < nelem(slab_classes) && size <= MAX_SLAB_ITEM; i++) {
 		slab_classes[i].item_size = size - sizeof(red_zone);
 		TAILQ_INIT(&slab_classes[i].free_slabs);
+		TAILQ_INIT(&slab_classes[i].evacuating);
 
-		size = MAX((size_t)(size * factor) & ~(ptr_size - 1),
-			   (size + ptr_size) & ~(ptr_size - 1));
+		size = MAX((size_t)(size * factor) & ~(align - 1),
+			   (size + align) & ~(align - 1));
 	}
 
 	SLIST_INIT(&slabs);
@@ -119,21 +155,119 @@ slab_classes_init(size_t minimal, double factor)
 	slab_active_classes = i;
 }
 
+#ifdef MAP_HUGETLB
+/**
+ * Map the arena with explicit huge pages of huge_page_mb
+ * megabytes. The length of a hugetlb mapping must be a multiple
+ * of the page size, hence mmap_size is rounded up.
+ */
 static bool
-arena_init(struct arena *arena, size_t size)
+arena_map_hugetlb(struct arena *arena, int huge_page_mb)
+{
+	size_t page_size = (size_t)huge_page_mb << 20;
+	size_t mmap_size = (arena->mmap_size + page_size - 1) & ~(page_size - 1);
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+	flags |= __builtin_ctzl(page_size) << MAP_HUGE_SHIFT;
+#endif
+	void *base = mmap(NULL, mmap_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (base == MAP_FAILED) {
+		say_warn("can't map the slab arena with %i MB huge pages: %s",
+			 huge_page_mb, strerror(errno));
+		return false;
+	}
+	arena->mmap_base = base;
+	arena->mmap_size = mmap_size;
+	arena->huge_pages = "hugetlb";
+	arena->page_size = page_size;
+	return true;
+}
+#endif
+
+#ifdef MADV_HUGEPAGE
+/** The transparent huge page size, 2 MB if the kernel doesn't tell. */
+static size_t
+arena_thp_page_size(void)
+{
+	size_t page_size = 2 << 20;
+	FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r");
+
+	if (f != NULL) {
+		if (fscanf(f, "%zu", &page_size) != 1)
+			page_size = 2 << 20;
+		fclose(f);
+	}
+	return page_size;
+}
+#endif
+
+/**
+ * Touch every page of the arena, so that the kernel commits
+ * (and, with transparent huge pages, collapses) the memory now
+ * instead of in the middle of a request.
+ */
+static void
+arena_prefault(struct arena *arena)
+{
+	/*
+	 * The arena is only SLAB_SIZE-aligned, so start from the
+	 * page it begins in to reach the page of its last byte.
+	 * A transparent huge page may fall back to small pages:
+	 * touch every small page then.
+	 */
+	size_t step = arena->page_size;
+	if (strcmp(arena->huge_pages, "thp") == 0)
+		step = sysconf(_SC_PAGESIZE);
+	char *p = (char *)((uintptr_t)arena->base & ~(step - 1));
+	char *last = (char *)arena->base + arena->size - 1;
+
+	for (; p <= last; p += step)
+		*(volatile char *)p = 0;
+	arena->prefaulted = true;
+}
+
+static bool
+arena_init(struct arena *arena, size_t size, int huge_page_mb, bool prefault)
 {
 	arena->used = 0;
 	arena->size = size - size % SLAB_SIZE;
 	arena->mmap_size = size - size % SLAB_SIZE + SLAB_SIZE;	/* spend SLAB_SIZE bytes on align :-( */
-
-	arena->mmap_base = mmap(NULL, arena->mmap_size,
-				PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-	if (arena->mmap_base == MAP_FAILED) {
-		say_syserror("mmap");
-		return false;
+	arena->mmap_base = NULL;
+	arena->huge_pages = "none";
+	arena->page_size = sysconf(_SC_PAGESIZE);
+	arena->prefaulted = false;
+
+#ifdef MAP_HUGETLB
+	if (huge_page_mb > 0)
+		arena_map_hugetlb(arena, huge_page_mb);
+#endif
+	if (arena->mmap_base == NULL) {
+		arena->mmap_base = mmap(NULL, arena->mmap_size,
+					PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (arena->mmap_base == MAP_FAILED) {
+			arena->mmap_base = NULL;
+			say_syserror("mmap");
+			return false;
+		}
+#ifdef MADV_HUGEPAGE
+		if (huge_page_mb > 0) {
+			if (madvise(arena->mmap_base, arena->mmap_size, MADV_HUGEPAGE) == 0) {
+				arena->huge_pages = "thp";
+				arena->page_size = arena_thp_page_size();
+			} else
+				say_warn("madvise(MADV_HUGEPAGE): %s", strerror(errno));
+		}
+#endif
 	}
 
 	arena->base = (char *)SLAB_ALIGN_PTR(arena->mmap_base) + SLAB_SIZE;
+
+	if (huge_page_mb > 0)
+		say_info("slab arena huge pages: %s", arena->huge_pages);
+	if (prefault) {
+		say_info("prefaulting %zu MB of slab arena", arena->size >> 20);
+		arena_prefault(arena);
+	}
 	return true;
 }
 
@@ -153,12 +287,13 @@ arena_alloc(struct arena *arena)
 }
 
 bool
-salloc_init(size_t size, size_t minimal, double factor)
+salloc_init(size_t size, size_t minimal, double factor,
+	    int huge_page_mb, bool prefault)
 {
 	if (size < SLAB_SIZE * 2)
 		return false;
 
-	if (!arena_init(&arena, size))
+	if (!arena_init(&arena, size, huge_page_mb, prefault))
 		return false;
 
 	slab_classes_init(MAX(sizeof(void *), minimal), factor);
@@ -184,7 +319,10 @@ format_slab(struct slab_class *class, struct slab *slab)
 	slab->class = class;
 	slab->items = 0;
 	slab->used = 0;
+	slab->evacuating = false;
+	slab->released = false;
 	slab->brk = (void *)CACHEALIGN((void *)slab + sizeof(struct slab));
+	class->n_slabs++;
 
 	TAILQ_INSERT_HEAD(&class->slabs, slab, class_link);
 	TAILQ_INSERT_HEAD(&class->free_slabs, slab, class_free_link);
@@ -196,6 +334,23 @@ fully_formatted(struct slab *slab)
 	return slab->brk + slab->class->item_size >= (void *)slab + SLAB_SIZE;
 }
 
+/** The number of items a slab of the class can hold. */
+static size_t
+slab_capacity(struct slab_class *class)
+{
+	return (SLAB_SIZE - sizeof(struct slab)) / (class->item_size + sizeof(red_zone));
+}
+
+/** Put an evacuated slab back to the class free list. */
+static void
+slab_evacuate_cancel(struct slab *slab)
+{
+	assert(slab->evacuating);
+	TAILQ_REMOVE(&slab->class->evacuating, slab, class_free_link);
+	TAILQ_INSERT_TAIL(&slab->class->free_slabs, slab, class_free_link);
+	slab->evacuating = false;
+}
+
 void
 slab_validate(void)
 {
@@ -245,6 +400,13 @@ slab_of(struct slab_class *class)
 		return slab;
 	}
 
+	/* Out of memory: rather use a slab that is being evacuated. */
+	if (!TAILQ_EMPTY(&class->evacuating)) {
+		slab = TAILQ_FIRST(&class->evacuating);
+		slab_evacuate_cancel(slab);
+		return slab;
+	}
+
 	return NULL;
 }
 
@@ -267,8 +429,12 @@ salloc(size_t size)
 	if ((class = class_for(size)) == NULL)
 		return NULL;
 
-	if ((slab = slab_of(class)) == NULL)
+	if ((slab = slab_of(class)) == NULL) {
+		class->n_failures++;
+		if (salloc_on_shortage != NULL)
+			salloc_on_shortage();
 		return NULL;
+	}
 
 	if (slab->free == NULL) {
 		assert(valid_item(slab, slab->brk));
@@ -289,11 +455,40 @@ salloc(size_t size)
 
 	slab->used += class->item_size + sizeof(red_zone);
 	slab->items += 1;
+	class->bytes_used += class->item_size + sizeof(red_zone);
+	class->n_items += 1;
 
 	VALGRIND_MALLOCLIKE_BLOCK(item, class->item_size, sizeof(red_zone), 0);
 	return (void *)item;
 }
 
+size_t
+salloc_size(void *ptr)
+{
+	return slab_header(ptr)->class->item_size + sizeof(red_zone);
+}
+
+size_t
+salloc_class_size(size_t size)
+{
+	struct slab_class *class = class_for(size);
+
+	return class == NULL ? 0 : class->item_size + sizeof(red_zone);
+}
+
+bool
+salloc_has_room(size_t size)
+{
+	struct slab_class *class = class_for(size);
+
+	if (class == NULL)
+		return false;
+
+	return !TAILQ_EMPTY(&class->free_slabs) || !SLIST_EMPTY(&free_slabs) ||
+		arena.size - arena.used >= SLAB_SIZE ||
+		!TAILQ_EMPTY(&class->evacuating);
+}
+
 void
 sfree(void *ptr)
 {
@@ -313,44 +508,190 @@ sfree(void *ptr)
 	slab->free = item;
 	slab->used -= class->item_size + sizeof(red_zone);
 	slab->items -= 1;
+	class->bytes_used -= class->item_size + sizeof(red_zone);
+	class->n_items -= 1;
 
 	if (slab->items == 0) {
-		TAILQ_REMOVE(&class->free_slabs, slab, class_free_link);
+		if (slab->evacuating) {
+			TAILQ_REMOVE(&class->evacuating, slab, class_free_link);
+			slab->evacuating = false;
+		} else {
+			TAILQ_REMOVE(&class->free_slabs, slab, class_free_link);
+		}
 		TAILQ_REMOVE(&class->slabs, slab, class_link);
 		SLIST_INSERT_HEAD(&free_slabs, slab, free_link);
+		class->n_slabs--;
+		slab->free_since = ev_now();
 	}
 
 	VALGRIND_FREELIKE_BLOCK(item, sizeof(red_zone));
 }
 
+static int
+slab_cmp_items(const void *a, const void *b)
+{
+	const struct slab *slab_a = *(const struct slab **)a;
+	const struct slab *slab_b = *(const struct slab **)b;
+
+	return slab_a->items < slab_b->items ? -1 : slab_a->items > slab_b->items;
+}
+
+int
+slab_evacuate_begin(double fill)
+{
+	int marked = 0;
+
+	for (int i = 0; i < slab_active_classes; i++) {
+		struct slab_class *class = &slab_classes[i];
+		size_t capacity = slab_capacity(class);
+		size_t n_slabs = 0, n_sparse = 0;
+		/* Signed: goes below zero once the rest is full. */
+		i64 free_items = 0;
+		struct slab *slab;
+
+		TAILQ_FOREACH(slab, &class->slabs, class_link) {
+			if (slab->evacuating)
+				continue;
+			free_items += capacity - MIN(slab->items, capacity);
+			n_slabs++;
+		}
+		if (n_slabs < 2)
+			continue;
+
+		struct slab **sparse = malloc(n_slabs * sizeof(struct slab *));
+		if (sparse == NULL)
+			break;
+
+		TAILQ_FOREACH(slab, &class->slabs, class_link) {
+			if (!slab->evacuating && slab->items < capacity * fill &&
+			    !(fully_formatted(slab) && slab->free == NULL))
+				sparse[n_sparse++] = slab;
+		}
+		qsort(sparse, n_sparse, sizeof(struct slab *), slab_cmp_items);
+
+		/*
+		 * Take the sparsest slabs first, while their items
+		 * still fit into the free room of the remaining ones.
+		 */
+		for (size_t j = 0; j < n_sparse; j++) {
+			slab = sparse[j];
+			/* The room of the slab itself doesn't count. */
+			free_items -= capacity - MIN(slab->items, capacity);
+			if ((i64) slab->items > free_items)
+				break;
+			free_items -= slab->items;
+
+			TAILQ_REMOVE(&class->free_slabs, slab, class_free_link);
+			TAILQ_INSERT_TAIL(&class->evacuating, slab, class_free_link);
+			slab->evacuating = true;
+			marked++;
+		}
+		free(sparse);
+	}
+	return marked;
+}
+
+bool
+salloc_evacuating(void *ptr)
+{
+	return slab_header(ptr)->evacuating;
+}
+
+int
+slab_evacuate_end(void)
+{
+	int left = 0;
+
+	for (int i = 0; i < slab_active_classes; i++) {
+		struct slab_class *class = &slab_classes[i];
+		while (!TAILQ_EMPTY(&class->evacuating)) {
+			slab_evacuate_cancel(TAILQ_FIRST(&class->evacuating));
+			left++;
+		}
+	}
+	return left;
+}
+
+/**
+ * Give the pages of the slabs which have been empty for longer
+ * than reclaim_delay back to the OS, so that RSS follows the
+ * live data rather than the historical peak. The first page,
+ * with the slab header and list links, is kept. A released
+ * slab is faulted in again on reuse.
+ */
+static void
+slab_reclaim(ev_timer *w __attribute__((unused)),
+	     int revents __attribute__((unused)))
+{
+	ev_tstamp now = ev_now();
+	/* Never a huge page: reclaim is off with hugetlb. */
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	struct slab *slab;
+
+	SLIST_FOREACH(slab, &free_slabs, free_link) {
+		if (slab->released || now - slab->free_since < reclaim_delay)
+			continue;
+		if (madvise((char *)slab + page_size, SLAB_SIZE - page_size,
+			    MADV_DONTNEED) != 0) {
+			say_syserror("madvise(MADV_DONTNEED)");
+			return;
+		}
+		slab->released = true;
+	}
+}
+
+void
+slab_reclaim_init(double delay)
+{
+	if (delay <= 0)
+		return;
+	/* Explicit huge pages are reserved for the arena anyway. */
+	if (strcmp(arena.huge_pages, "hugetlb") == 0) {
+		say_warn("slab_reclaim_delay has no effect with explicit huge pages");
+		return;
+	}
+	reclaim_delay = delay;
+	ev_timer_init(&reclaim_timer, slab_reclaim, delay, delay);
+	ev_timer_start(&reclaim_timer);
+}
+
 void
 slab_stat(struct tbuf *t)
 {
 	struct slab *slab;
-	int slabs;
-	i64 items, used, free, total_used = 0;
+	i64 used, free, total_used = 0;
+	int n_free = 0, n_released = 0;
 	tbuf_printf(t, "slab statistics:\n  classes:" CRLF);
 	for (int i = 0; i < slab_active_classes; i++) {
-		slabs = items = used = free = 0;
-		TAILQ_FOREACH(slab, &slab_classes[i].slabs, class_link) {
-			free += SLAB_SIZE - slab->used - sizeof(struct slab);
-			items += slab->items;
-			used += sizeof(struct slab) + slab->used;
-			total_used += sizeof(struct slab) + slab->used;
-			slabs++;
-		}
+		struct slab_class *class = &slab_classes[i];
 
-		if (slabs == 0)
+		if (class->n_slabs == 0)
 			continue;
 
+		used = class->n_slabs * sizeof(struct slab) + class->bytes_used;
+		free = class->n_slabs * (SLAB_SIZE - sizeof(struct slab)) - class->bytes_used;
+		total_used += used;
+
 		tbuf_printf(t,
 			    "     - { item_size: %- 5i, slabs: %- 3i, items: %- 11" PRIi64
-			    ", bytes_used: %- 12" PRIi64 ", bytes_free: %- 12" PRIi64 " }" CRLF,
-			    (int)slab_classes[i].item_size, slabs, items, used, free);
+			    ", bytes_used: %- 12" PRIi64 ", bytes_free: %- 12" PRIi64
+			    ", failures: %" PRIu64 " }" CRLF,
+			    (int)class->item_size, (int)class->n_slabs, (i64)class->n_items,
+			    used, free, class->n_failures);
 
 	}
+	SLIST_FOREACH(slab, &free_slabs, free_link) {
+		n_free++;
+		if (slab->released)
+			n_released++;
+	}
 	tbuf_printf(t, "  items_used: %.2f" CRLF, (double)total_used / arena.size * 100);
 	tbuf_printf(t, "  arena_used: %.2f" CRLF, (double)arena.used / arena.size * 100);
+	tbuf_printf(t, "  free_slabs: %i" CRLF, n_free);
+	tbuf_printf(t, "  released_slabs: %i" CRLF, n_released);
+	tbuf_printf(t, "  huge_pages: %s" CRLF, arena.huge_pages);
+	tbuf_printf(t, "  page_size: %zu" CRLF, arena.page_size);
+	tbuf_printf(t, "  prefaulted: %s" CRLF, arena.prefaulted ? "true" : "false");
 }
 
 void
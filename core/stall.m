@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2010, 2011 Mail.RU
+ * Copyright (C) 2010, 2011 Yuriy Vostrikov
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "stall.h"
+#include "config.h"
+
+#include <fiber.h>
+#include <say.h>
+#include <tbuf.h>
+#include <util.h>
+
+#ifdef TARGET_OS_LINUX
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+
+/*
+ * Stall detection.
+ *
+ * The event loop marks the moment it stops polling and starts
+ * running callbacks and fibers (ev_check), and the moment it
+ * goes back to polling (ev_prepare). A watchdog thread wakes up
+ * a few times per threshold; if the loop has been busy for longer
+ * than the threshold, it sends SIGPROF to the main thread.
+ *
+ * The signal handler runs in the stalled fiber itself: it records
+ * the fiber and, with ENABLE_BACKTRACE, the return addresses of
+ * its stack into a ring of the latest stalls. The handler only
+ * reads memory, symbols are resolved by "show stall". When the
+ * loop gets back to polling, the duration of the stall is filled
+ * in and a warning is logged.
+ */
+
+enum { STALL_FRAMES = 32 };
+
+struct stall {
+	/* When the loop stopped polling, ev_time(). */
+	double start;
+	/* 0 until the loop polls again. */
+	double duration;
+	u32 fid;
+	char name[FIBER_NAME_MAXLEN];
+	int frame_count;
+	void *frames[STALL_FRAMES];
+};
+
+static double stall_threshold;
+static pthread_t stall_main_thread;
+static struct ev_prepare stall_prepare;
+static struct ev_check stall_check;
+
+/* Written by the main thread, read by the watchdog. */
+static volatile double loop_busy_since;
+static volatile unsigned loop_iteration;
+/* The iteration the watchdog has signalled, set by the watchdog. */
+static volatile unsigned stall_signalled;
+
+static struct stall stalls[STALL_HISTORY];
+static unsigned stall_count;
+/* The stall being recorded, if the loop hasn't polled yet. */
+static struct stall *stall_current;
+
+static void
+stall_loop_check(struct ev_check *w __attribute__((unused)),
+		 int revents __attribute__((unused)))
+{
+	loop_iteration++;
+	loop_busy_since = ev_time();
+}
+
+static void
+stall_loop_prepare(struct ev_prepare *w __attribute__((unused)),
+		   int revents __attribute__((unused)))
+{
+	loop_busy_since = 0;
+
+	struct stall *stall = stall_current;
+	if (stall != NULL) {
+		stall_current = NULL;
+		stall->duration = ev_time() - stall->start;
+		say_warn("event loop stalled for %.3f sec in fiber `%s'",
+			 stall->duration, stall->name);
+	}
+}
+
+static void
+stall_signal(int signo __attribute__((unused)),
+	     siginfo_t *info __attribute__((unused)), void *context)
+{
+	double start = loop_busy_since;
+
+	/* The loop may have polled since the watchdog looked. */
+	if (start == 0 || stall_signalled != loop_iteration ||
+	    stall_current != NULL)
+		return;
+
+	struct stall *stall = &stalls[stall_count++ % STALL_HISTORY];
+	memset(stall, 0, sizeof(*stall));
+	stall->start = start;
+	stall->fid = fiber->fid;
+	memcpy(stall->name, fiber->name, sizeof(stall->name));
+	stall_current = stall;
+
+#ifdef ENABLE_BACKTRACE
+	void *frame = __builtin_frame_address(0);
+	void *stack = fiber->coro.stack;
+	size_t stack_size = fiber->coro.stack_size;
+# ifdef __x86_64__
+	/* Start right from the interrupted instruction. */
+	ucontext_t *uc = context;
+	stall->frames[stall->frame_count++] = (void *) uc->uc_mcontext.gregs[REG_RIP];
+	frame = (void *) uc->uc_mcontext.gregs[REG_RBP];
+# else
+	(void) context;
+# endif
+	if (stack == NULL) {
+		/* sched runs on the main thread stack. */
+		stack = frame;
+		stack_size = __libc_stack_end - frame;
+	}
+	stall->frame_count += backtrace_collect(frame, stack, stack_size,
+						stall->frames + stall->frame_count,
+						STALL_FRAMES - stall->frame_count);
+#else
+	(void) context;
+#endif /* ENABLE_BACKTRACE */
+}
+
+static void *
+stall_watchdog(void *data __attribute__((unused)))
+{
+	double interval = stall_threshold / 4;
+	struct timespec ts = {
+		.tv_sec = (time_t) interval,
+		.tv_nsec = (long) ((interval - (time_t) interval) * 1e9)
+	};
+	unsigned reported = 0;
+
+	for (;;) {
+		nanosleep(&ts, NULL);
+
+		double since = loop_busy_since;
+		unsigned iteration = loop_iteration;
+		if (since == 0 || iteration == reported ||
+		    ev_time() - since < stall_threshold)
+			continue;
+
+		reported = iteration;
+		stall_signalled = iteration;
+		pthread_kill(stall_main_thread, SIGPROF);
+	}
+	return NULL;
+}
+
+void
+stall_init(double threshold)
+{
+	struct sigaction sa;
+	sigset_t all, orig;
+	pthread_t thread;
+
+	if (threshold <= 0)
+		return;
+
+	stall_threshold = threshold;
+	stall_main_thread = pthread_self();
+
+	memset(&sa, 0, sizeof(sa));
+	sigemptyset(&sa.sa_mask);
+	sa.sa_sigaction = stall_signal;
+	sa.sa_flags = SA_SIGINFO | SA_RESTART;
+	if (sigaction(SIGPROF, &sa, NULL) == -1) {
+		say_syserror("sigaction");
+		return;
+	}
+
+	ev_prepare_init(&stall_prepare, stall_loop_prepare);
+	ev_prepare_start(&stall_prepare);
+	ev_check_init(&stall_check, stall_loop_check);
+	ev_check_start(&stall_check);
+
+	/* The watchdog doesn't handle any signals. */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &orig);
+	int rc = pthread_create(&thread, NULL, stall_watchdog, NULL);
+	pthread_sigmask(SIG_SETMASK, &orig, NULL);
+	if (rc != 0) {
+		errno = rc;
+		say_syserror("pthread_create");
+		ev_prepare_stop(&stall_prepare);
+		ev_check_stop(&stall_check);
+		return;
+	}
+	pthread_detach(thread);
+	say_info("stall detector started, threshold %.3f sec", threshold);
+}
+
+void
+stall_info(struct tbuf *out)
+{
+	unsigned count = MIN(stall_count, STALL_HISTORY);
+
+	tbuf_printf(out, "stalls:" CRLF);
+	for (unsigned i = 0; i < count; i++) {
+		struct stall *stall = &stalls[(stall_count - 1 - i) % STALL_HISTORY];
+		double duration = stall->duration;
+
+		if (stall == stall_current)
+			duration = ev_time() - stall->start;
+		tbuf_printf(out, "  - start: %.3f" CRLF, stall->start);
+		tbuf_printf(out, "    duration: %.3f" CRLF, duration);
+		tbuf_printf(out, "    fid: %" PRIu32 CRLF, stall->fid);
+		tbuf_printf(out, "    name: %s" CRLF, stall->name);
+#ifdef ENABLE_BACKTRACE
+		tbuf_printf(out, "    backtrace:" CRLF);
+		backtrace_print(out, stall->frames, stall->frame_count);
+#endif /* ENABLE_BACKTRACE */
+	}
+}
+
+#else /* !TARGET_OS_LINUX */
+
+void
+stall_init(double threshold)
+{
+	if (threshold > 0)
+		say_warn("stall detection is not supported on this platform");
+}
+
+void
+stall_info(struct tbuf *out)
+{
+	tbuf_printf(out, "stalls:" CRLF);
+}
+
+#endif /* TARGET_OS_LINUX */
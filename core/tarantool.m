@@ -27,6 +27,8 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <errno.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -34,6 +36,8 @@
 #include <sys/wait.h>
 #include <sys/types.h>
 #include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <pwd.h>
 #include <unistd.h>
 #include <getopt.h>
@@ -52,6 +56,8 @@
 #include <salloc.h>
 #include <say.h>
 #include <stat.h>
+#include <uring.h>
+#include <stall.h>
 #include TARANTOOL_CONFIG
 #include <util.h>
 #include <third_party/gopt/gopt.h>
@@ -73,6 +79,9 @@ struct recovery_state *recovery_state;
 static ev_signal *sigs = NULL;
 
 bool init_storage, booting = true;
+int shard_no = -1;
+int *shard_links;
+static pid_t *shard_pids;
 
 static i32
 load_cfg(struct tarantool_cfg *conf, i32 check_rdonly)
@@ -102,6 +111,17 @@ load_cfg(struct tarantool_cfg *conf, i32 check_rdonly)
 	if (n_accepted == 0 || n_skipped != 0)
 		return -1;
 
+	if (conf->slab_alloc_huge_pages != 0 && conf->slab_alloc_huge_pages != 2 &&
+	    conf->slab_alloc_huge_pages != 1024) {
+		out_warning(0, "slab_alloc_huge_pages must be 0, 2 or 1024");
+		return -1;
+	}
+
+	if (conf->fiber_stack_size < 16384) {
+		out_warning(0, "fiber_stack_size must be at least 16384 bytes");
+		return -1;
+	}
+
 	if (replication_check_config(conf) != 0)
 		return -1;
 
@@ -378,19 +398,86 @@ tarantool_free(void)
 		tarantool_lua_close(tarantool_L);
 }
 
+/**
+ * Fork cfg.shards shard processes. A shard works in its own
+ * directory, work_dir/shard_<no>, and talks to the main process,
+ * the router, over a socket pair. The shards go away with the
+ * router.
+ */
+static void
+shards_prefork(void)
+{
+	if (cfg.shards == 0)
+		return;
+
+	shard_links = palloc(eter_pool, sizeof(*shard_links) * cfg.shards);
+	shard_pids = palloc(eter_pool, sizeof(*shard_pids) * cfg.shards);
+
+	for (int i = 0; i < cfg.shards; i++) {
+		int sockpair[2];
+		if (socketpair(PF_LOCAL, SOCK_STREAM, 0, sockpair) != 0)
+			panic_syserror("socketpair");
+
+		pid_t pid = fork();
+		if (pid == -1)
+			panic_syserror("fork");
+
+		if (pid == 0) {
+			for (int j = 0; j < i; j++)
+				close(shard_links[j]);
+			close(sockpair[0]);
+			shard_links[i] = sockpair[1];
+			shard_no = i;
+#ifdef TARGET_OS_LINUX
+			prctl(PR_SET_PDEATHSIG, SIGTERM, 0, 0, 0);
+#endif
+			char dir[32];
+			snprintf(dir, sizeof(dir), "shard_%i", i);
+			if (mkdir(dir, 0755) == -1 && errno != EEXIST)
+				panic_syserror("can't create `%s'", dir);
+			if (chdir(dir) == -1)
+				panic_syserror("can't chdir to `%s'", dir);
+			return;
+		}
+		close(sockpair[1]);
+		shard_links[i] = sockpair[0];
+		shard_pids[i] = pid;
+	}
+}
+
+/** Wait for all shards to exit, -1 if any of them failed. */
+static int
+shards_wait(void)
+{
+	int rc = 0;
+
+	for (int i = 0; i < cfg.shards; i++) {
+		int status;
+		if (waitpid(shard_pids[i], &status, 0) == -1 ||
+		    !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			say_error("shard %i failed", i);
+			rc = -1;
+		}
+	}
+	return rc;
+}
+
 static void
-initialize(double slab_alloc_arena, int slab_alloc_minimal, double slab_alloc_factor)
+initialize(double slab_alloc_arena, int slab_alloc_minimal, double slab_alloc_factor,
+	   int slab_alloc_huge_pages, bool slab_alloc_prefault)
 {
-	if (!salloc_init(slab_alloc_arena * (1 << 30), slab_alloc_minimal, slab_alloc_factor))
+	if (!salloc_init(slab_alloc_arena * (1 << 30), slab_alloc_minimal, slab_alloc_factor,
+			 slab_alloc_huge_pages, slab_alloc_prefault))
 		panic_syserror("can't initialize slab allocator");
 
+	tarantool_coro_init(cfg.fiber_stack_size);
 	fiber_init();
 }
 
 static void
 initialize_minimal()
 {
-	initialize(0.1, 4, 2);
+	initialize(0.1, 4, 2, 0, false);
 }
 
 int
@@ -581,6 +668,10 @@ main(int argc, char **argv)
 
 	if (gopt(opt, 'I')) {
 		init_storage = true;
+		shards_prefork();
+		/* The router has no storage: only the shards do. */
+		if (shard_no < 0 && cfg.shards > 0)
+			exit(shards_wait() == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
 		initialize_minimal();
 		mod_init();
 		next_lsn(recovery_state, 1);
@@ -602,6 +693,8 @@ main(int argc, char **argv)
 
 	say_logger_init(cfg.logger_nonblock);
 
+	shards_prefork();
+
 	/* init process title */
 	if (cfg.custom_proc_title == NULL) {
 		custom_proc_title = "";
@@ -610,6 +703,11 @@ main(int argc, char **argv)
 		strcpy(custom_proc_title, "@");
 		strcat(custom_proc_title, cfg.custom_proc_title);
 	}
+	if (shard_no >= 0) {
+		char *title = palloc(eter_pool, strlen(custom_proc_title) + 32);
+		sprintf(title, "%s@shard_%i", custom_proc_title, shard_no);
+		custom_proc_title = title;
+	}
 
 	booting = false;
 
@@ -618,7 +716,11 @@ main(int argc, char **argv)
 
 	ev_default_loop(EVFLAG_AUTO);
 
-	initialize(cfg.slab_alloc_arena, cfg.slab_alloc_minimal, cfg.slab_alloc_factor);
+	initialize(cfg.slab_alloc_arena, cfg.slab_alloc_minimal, cfg.slab_alloc_factor,
+		   cfg.slab_alloc_huge_pages, cfg.slab_alloc_prefault);
+	slab_reclaim_init(cfg.slab_reclaim_delay);
+	if (cfg.io_uring && uring_init(URING_ENTRIES) != 0)
+		say_warn("io_uring is not available, using libev");
 	replication_prefork();
 
 	signal_init();
@@ -636,6 +738,7 @@ main(int argc, char **argv)
 		ev_set_io_collect_interval(cfg.io_collect_interval);
 	ev_now_update();
 	start_time = ev_now();
+	stall_init(cfg.stall_threshold);
 	ev_loop(0);
 	say_crit("exiting loop");
 	/* freeing resources */
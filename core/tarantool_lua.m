@@ -450,13 +450,27 @@ box_lua_fiber_run(void *arg __attribute__((unused)))
 static int
 lbox_fiber_create(struct lua_State *L)
 {
-        if (lua_gettop(L) != 1 || !lua_isfunction(L, 1))
-                luaL_error(L, "fiber.create(function): bad arguments");
+        if (lua_gettop(L) < 1 || lua_gettop(L) > 2 || !lua_isfunction(L, 1) ||
+	    (lua_gettop(L) == 2 && !lua_isnumber(L, 2)))
+                luaL_error(L, "fiber.create(function [, stack_size]): bad arguments");
 	if (fiber_checkstack()) {
 		luaL_error(L, "fiber.create(function): recursion limit"
 			   " reached");
 	}
-	struct fiber *f= fiber_create("lua", -1, -1, box_lua_fiber_run, NULL);
+	/* A deeply recursive function may ask for a larger stack. */
+	size_t stack_size = 0;
+	if (lua_gettop(L) == 2) {
+		lua_Number size = lua_tonumber(L, 2);
+		if (size < 0)
+			luaL_error(L, "fiber.create(function, stack_size): "
+				   "bad stack size");
+		stack_size = size;
+		lua_pop(L, 1);
+	}
+	struct fiber *f= fiber_create_stack("lua", stack_size, -1, -1,
+					    box_lua_fiber_run, NULL);
+	if (f == NULL)
+		luaL_error(L, "fiber.create(function): can't create a fiber");
 
 	lua_pushlightuserdata(L, f); /* associate coro with fiber */
 	struct lua_State *child_L = lua_newthread(L);
@@ -600,6 +614,37 @@ lbox_fiber_testcancel(struct lua_State *L)
 	return 0;
 }
 
+/**
+ * Run time accounting of a fiber, in seconds, see fiber_stat.
+ * nil if fiber_stat is off.
+ */
+static int
+lbox_fiber_stat(struct lua_State *L)
+{
+	struct fiber *f = lua_gettop(L) == 0 ? fiber : lbox_checkfiber(L, 1);
+	if (!cfg.fiber_stat) {
+		lua_pushnil(L);
+		return 1;
+	}
+	struct fiber_stat *stat = &f->stat;
+	u64 wakeups = MAX(stat->wakeups, 1);
+
+	lua_newtable(L);
+	lua_pushnumber(L, fiber_stat_seconds(stat->run_time));
+	lua_setfield(L, -2, "run_time");
+	lua_pushnumber(L, fiber_stat_seconds(stat->max_slice));
+	lua_setfield(L, -2, "max_slice");
+	lua_pushnumber(L, stat->wakeups);
+	lua_setfield(L, -2, "wakeups");
+	lua_pushnumber(L, fiber_stat_seconds(stat->wakeup_latency / wakeups));
+	lua_setfield(L, -2, "wakeup_latency");
+	lua_pushnumber(L, fiber_stat_seconds(stat->max_wakeup_latency));
+	lua_setfield(L, -2, "max_wakeup_latency");
+	lua_pushinteger(L, f->csw);
+	lua_setfield(L, -2, "csw");
+	return 1;
+}
+
 static const struct luaL_reg lbox_fiber_meta [] = {
 	{"id", lbox_fiber_id},
 	{"__gc", lbox_fiber_gc},
@@ -616,6 +661,7 @@ static const struct luaL_reg fiberlib[] = {
 	{"resume", lbox_fiber_resume},
 	{"yield", lbox_fiber_yield},
 	{"detach", lbox_fiber_detach},
+	{"stat", lbox_fiber_stat},
 	{NULL, NULL}
 };
 
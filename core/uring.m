@@ -0,0 +1,463 @@
+/*
+ * Copyright (C) 2010, 2011 Mail.RU
+ * Copyright (C) 2010, 2011 Yuriy Vostrikov
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "uring.h"
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <fiber.h>
+#include <say.h>
+
+bool uring_enabled = false;
+
+#if defined(TARGET_OS_LINUX) && defined(HAVE_LINUX_IO_URING_H)
+
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/* Linux 5.7+, not in the headers of older kernels. */
+#ifndef IORING_FEAT_FAST_POLL
+#define IORING_FEAT_FAST_POLL (1U << 5)
+#endif
+
+/*
+ * Fibers put their requests into the submission queue, and
+ * everything queued during an event loop iteration is submitted
+ * with a single io_uring_enter() right before the loop blocks.
+ * Completions are signalled through an eventfd watched by libev:
+ * its callback reaps the completion queue and resumes the fibers.
+ *
+ * Client sockets stay non-blocking. A read or a write goes to the
+ * ring alone: with IORING_FEAT_FAST_POLL the kernel arms a poll
+ * by itself when the socket isn't ready. Should it return EAGAIN
+ * anyway, or on an older kernel, the request is linked to a poll
+ * request and only runs once the socket is ready. Writes usually
+ * succeed right away, so a write is tried with a plain writev()
+ * first, and only goes to the ring if the socket is full. There
+ * are no epoll_ctl() calls on this path.
+ *
+ * A fiber waiting for the ring can be cancelled: its requests are
+ * cancelled with IORING_OP_ASYNC_CANCEL, and the fiber waits for
+ * all of them to complete, since the kernel owns the buffers until
+ * then.
+ */
+
+struct uring_req {
+	struct fiber *fiber;
+	int res;
+	bool done;
+};
+
+static struct uring {
+	int fd;
+	int eventfd;
+
+	void *sq_ptr, *cq_ptr;
+	size_t sq_size, cq_size;
+
+	unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned sq_entries;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+	/* Queued requests are published on submission. */
+	unsigned tail;
+	unsigned to_submit;
+
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	/* The kernel polls a socket which isn't ready by itself. */
+	bool fast_poll;
+
+	ev_io io;
+	ev_prepare prepare;
+} ring;
+
+static int
+sys_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+	return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int
+sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+		   unsigned flags)
+{
+	return syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+		       flags, NULL, 0);
+}
+
+static int
+sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+	return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void
+uring_submit(void)
+{
+	if (ring.to_submit == 0)
+		return;
+
+	__atomic_store_n(ring.sq_tail, ring.tail, __ATOMIC_RELEASE);
+
+	int r;
+	do {
+		r = sys_io_uring_enter(ring.fd, ring.to_submit, 0, 0);
+	} while (r < 0 && errno == EINTR);
+
+	if (r >= 0)
+		ring.to_submit -= r;
+	/* Out of resources: retry on the next loop iteration. */
+	else if (errno != EAGAIN && errno != EBUSY)
+		panic_syserror("io_uring_enter");
+}
+
+static unsigned
+uring_sq_space(void)
+{
+	return ring.sq_entries -
+		(ring.tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE));
+}
+
+static struct io_uring_sqe *
+uring_get_sqe(void)
+{
+	assert(uring_sq_space() > 0);
+
+	unsigned index = ring.tail & *ring.sq_mask;
+	struct io_uring_sqe *sqe = &ring.sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	ring.sq_array[index] = index;
+	ring.tail++;
+	ring.to_submit++;
+	return sqe;
+}
+
+static void
+uring_reap(void)
+{
+	unsigned head = *ring.cq_head;
+
+	for (;;) {
+		unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+		if (head == tail)
+			break;
+
+		struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+		struct uring_req *req = (void *)(uintptr_t) cqe->user_data;
+		int res = cqe->res;
+
+		__atomic_store_n(ring.cq_head, ++head, __ATOMIC_RELEASE);
+
+		req->res = res;
+		req->done = true;
+		fiber_call(req->fiber);
+	}
+}
+
+static void
+uring_io_cb(ev_io *w __attribute__((unused)),
+	    int revents __attribute__((unused)))
+{
+	uint64_t count;
+	while (read(ring.eventfd, &count, sizeof(count)) < 0 && errno == EINTR)
+		;
+	uring_reap();
+}
+
+static void
+uring_prepare_cb(ev_prepare *w __attribute__((unused)),
+		 int revents __attribute__((unused)))
+{
+	uring_reap();
+	uring_submit();
+}
+
+/** A ring can't be shared with a forked child. */
+static void
+uring_atfork_child(void)
+{
+	if (!uring_enabled)
+		return;
+
+	uring_enabled = false;
+	ev_io_stop(&ring.io);
+	ev_prepare_stop(&ring.prepare);
+	close(ring.eventfd);
+	close(ring.fd);
+}
+
+static void
+uring_unmap(void)
+{
+	if (ring.sq_ptr != NULL && ring.sq_ptr != MAP_FAILED)
+		munmap(ring.sq_ptr, ring.sq_size);
+	if (ring.cq_ptr != NULL && ring.cq_ptr != MAP_FAILED)
+		munmap(ring.cq_ptr, ring.cq_size);
+	if (ring.sqes != NULL && ring.sqes != MAP_FAILED)
+		munmap(ring.sqes, ring.sqes_size);
+}
+
+int
+uring_init(unsigned entries)
+{
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	memset(&ring, 0, sizeof(ring));
+
+	ring.fd = sys_io_uring_setup(entries, &p);
+	if (ring.fd < 0) {
+		say_syserror("io_uring_setup");
+		return -1;
+	}
+	/* Linked requests and no lost completions: Linux 5.5+. */
+	if (!(p.features & IORING_FEAT_NODROP)) {
+		say_warn("io_uring: the kernel is too old");
+		close(ring.fd);
+		return -1;
+	}
+
+	ring.fast_poll = p.features & IORING_FEAT_FAST_POLL;
+
+	ring.sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	ring.cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	ring.sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+	ring.sq_ptr = mmap(NULL, ring.sq_size, PROT_READ | PROT_WRITE,
+			   MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+	ring.cq_ptr = mmap(NULL, ring.cq_size, PROT_READ | PROT_WRITE,
+			   MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+	ring.sqes = mmap(NULL, ring.sqes_size, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+	if (ring.sq_ptr == MAP_FAILED || ring.cq_ptr == MAP_FAILED ||
+	    ring.sqes == MAP_FAILED) {
+		say_syserror("io_uring: mmap");
+		goto error;
+	}
+
+	ring.sq_head = ring.sq_ptr + p.sq_off.head;
+	ring.sq_tail = ring.sq_ptr + p.sq_off.tail;
+	ring.sq_mask = ring.sq_ptr + p.sq_off.ring_mask;
+	ring.sq_array = ring.sq_ptr + p.sq_off.array;
+	ring.sq_entries = p.sq_entries;
+	ring.tail = *ring.sq_tail;
+
+	ring.cq_head = ring.cq_ptr + p.cq_off.head;
+	ring.cq_tail = ring.cq_ptr + p.cq_off.tail;
+	ring.cq_mask = ring.cq_ptr + p.cq_off.ring_mask;
+	ring.cqes = ring.cq_ptr + p.cq_off.cqes;
+
+	ring.eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (ring.eventfd < 0) {
+		say_syserror("eventfd");
+		goto error;
+	}
+	if (sys_io_uring_register(ring.fd, IORING_REGISTER_EVENTFD,
+				  &ring.eventfd, 1) < 0) {
+		say_syserror("io_uring_register");
+		close(ring.eventfd);
+		goto error;
+	}
+
+	ev_io_init(&ring.io, uring_io_cb, ring.eventfd, EV_READ);
+	ev_io_start(&ring.io);
+	ev_prepare_init(&ring.prepare, uring_prepare_cb);
+	ev_prepare_start(&ring.prepare);
+
+	static bool atfork_registered = false;
+	if (!atfork_registered) {
+		pthread_atfork(NULL, NULL, uring_atfork_child);
+		atfork_registered = true;
+	}
+
+	uring_enabled = true;
+	say_info("io_uring: %u entries", ring.sq_entries);
+	return 0;
+error:
+	uring_unmap();
+	close(ring.fd);
+	return -1;
+}
+
+/**
+ * Make room for count requests in the submission queue. Not a
+ * cancellation point.
+ */
+static void
+uring_reserve(unsigned count)
+{
+	while (uring_sq_space() < count) {
+		uring_submit();
+		if (uring_sq_space() >= count)
+			break;
+		/* The kernel is out of resources: retry on the next iteration. */
+		wheel_timer_start(&fiber->timer, 0);
+		fiber_yield();
+		wheel_timer_stop(&fiber->timer);
+	}
+}
+
+/** Queue a cancellation of a request which is in flight. */
+static void
+uring_cancel(struct uring_req *cancel, struct uring_req *req)
+{
+	struct io_uring_sqe *sqe = uring_get_sqe();
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = -1;
+	sqe->addr = (uintptr_t) req;
+	sqe->user_data = (uintptr_t) cancel;
+	*cancel = (struct uring_req) { .fiber = fiber };
+}
+
+/**
+ * Wait for the requests of this fiber to complete. This is a
+ * cancellation point: the requests are cancelled, and
+ * FiberCancelException is raised once they have completed.
+ */
+static void
+uring_wait(struct uring_req *req, struct uring_req *linked)
+{
+	struct uring_req cancel[2];
+	int cancel_count = 0;
+	bool cancelled = false;
+
+	while (!req->done || (linked != NULL && !linked->done)) {
+		fiber_yield();
+		if (cancelled || !fiber_is_cancelled())
+			continue;
+
+		cancelled = true;
+		uring_reserve(2);
+		if (linked != NULL && !linked->done)
+			uring_cancel(&cancel[cancel_count++], linked);
+		if (!req->done)
+			uring_cancel(&cancel[cancel_count++], req);
+	}
+	for (int i = 0; i < cancel_count; i++) {
+		while (!cancel[i].done)
+			fiber_yield();
+	}
+	fiber_testcancel();
+}
+
+/**
+ * Run a read or a write on a non-blocking socket, waiting for
+ * readiness with a linked poll when poll_first is set or the
+ * socket isn't ready.
+ */
+static ssize_t
+uring_rw(int opcode, int fd, const struct iovec *iov, int iovcnt,
+	 short poll_events, bool poll_first)
+{
+	struct uring_req req, poll;
+
+	for (;;) {
+		/* Leave room for both requests of a linked pair. */
+		uring_reserve(2);
+		fiber_testcancel();
+
+		if (poll_first) {
+			struct io_uring_sqe *poll_sqe = uring_get_sqe();
+			poll_sqe->opcode = IORING_OP_POLL_ADD;
+			poll_sqe->fd = fd;
+			poll_sqe->poll_events = poll_events;
+			poll_sqe->flags = IOSQE_IO_LINK;
+			poll_sqe->user_data = (uintptr_t) &poll;
+			poll = (struct uring_req) { .fiber = fiber };
+		}
+		struct io_uring_sqe *sqe = uring_get_sqe();
+		sqe->opcode = opcode;
+		sqe->fd = fd;
+		sqe->addr = (uintptr_t) iov;
+		sqe->len = iovcnt;
+		sqe->user_data = (uintptr_t) &req;
+		req = (struct uring_req) { .fiber = fiber };
+
+		uring_wait(&req, poll_first ? &poll : NULL);
+
+		if (poll_first && poll.res < 0) {
+			errno = -poll.res;
+			return -1;
+		}
+		if (req.res == -EAGAIN) {
+			poll_first = true;
+			continue;
+		}
+		if (req.res < 0) {
+			errno = -req.res;
+			return -1;
+		}
+		return req.res;
+	}
+}
+
+ssize_t
+uring_read(int fd, void *buf, size_t count)
+{
+	struct iovec iov = { .iov_base = buf, .iov_len = count };
+	return uring_rw(IORING_OP_READV, fd, &iov, 1, POLLIN, !ring.fast_poll);
+}
+
+ssize_t
+uring_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+	ssize_t r = writev(fd, iov, iovcnt);
+	if (r >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+		return r;
+	return uring_rw(IORING_OP_WRITEV, fd, iov, iovcnt, POLLOUT, !ring.fast_poll);
+}
+
+#else /* !HAVE_LINUX_IO_URING_H */
+
+int
+uring_init(unsigned entries __attribute__((unused)))
+{
+	say_warn("io_uring is not supported on this platform");
+	return -1;
+}
+
+ssize_t
+uring_read(int fd, void *buf, size_t count)
+{
+	return read(fd, buf, count);
+}
+
+ssize_t
+uring_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+	return writev(fd, iov, iovcnt);
+}
+
+#endif /* HAVE_LINUX_IO_URING_H */
@@ -191,6 +191,41 @@ out:
 	*p = 0;
         return backtrace_buf;
 }
+
+/*
+ * Unlike backtrace(), only reads the stack, and so can be used
+ * in a signal handler.
+ */
+int
+backtrace_collect(void *frame_, void *stack, size_t stack_size, void **ret, int count)
+{
+	struct frame *frame = frame_;
+	void *stack_top = stack + stack_size;
+	int n = 0;
+
+	while (n < count && stack <= (void *)frame && (void *)frame < stack_top) {
+		ret[n++] = frame->ret;
+		/* The stack grows down: the caller frame is above. */
+		if ((void *)frame->rbp <= (void *)frame)
+			break;
+		frame = frame->rbp;
+	}
+	return n;
+}
+
+void
+backtrace_print(struct tbuf *out, void **ret, int count)
+{
+	for (int i = 0; i < count; i++) {
+		tbuf_printf(out, "        - { caller: %p", ret[i]);
+#ifdef HAVE_BFD
+		struct symbol *s = addr2symbol(ret[i]);
+		if (s != NULL)
+			tbuf_printf(out, " <%s+%"PRI_SZ"> ", s->name, ret[i] - s->addr);
+#endif /* HAVE_BFD */
+		tbuf_printf(out, " }" CRLF);
+	}
+}
 #endif /* ENABLE_BACKTRACE */
 
 void __attribute__ ((noreturn))
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2010, 2011 Mail.RU
+ * Copyright (C) 2010, 2011 Yuriy Vostrikov
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "wheel.h"
+
+#include <stdint.h>
+
+/*
+ * Timers are kept in WHEEL_LEVELS levels of WHEEL_SIZE slots.
+ * A timer which expires in less than WHEEL_SIZE ticks goes to a
+ * slot of level 0, one slot per tick. Level 1 slots span
+ * WHEEL_SIZE ticks each, level 2 slots WHEEL_SIZE^2 ticks, and so
+ * on. Each time the level 0 wheel completes a turn, the next slot
+ * of level 1 is cascaded: its timers are re-inserted, now into
+ * level 0, and so on up the levels. Timers further away than the
+ * whole wheel wait in its last slot and are re-inserted again.
+ *
+ * A single ev_timer is armed for the nearest non-empty tick. It
+ * is re-armed only when a timer expiring earlier is started, so
+ * the libev timer heap is not touched on the common path.
+ */
+
+enum {
+	WHEEL_BITS = 6,
+	WHEEL_SIZE = 1 << WHEEL_BITS,
+	WHEEL_MASK = WHEEL_SIZE - 1,
+	WHEEL_LEVELS = 4
+};
+
+#define WHEEL_SPAN (1ULL << (WHEEL_BITS * WHEEL_LEVELS))
+
+LIST_HEAD(wheel_slot, wheel_timer);
+
+static struct {
+	struct wheel_slot slots[WHEEL_LEVELS][WHEEL_SIZE];
+	/* The next tick to expire. */
+	u64 tick;
+	/* The tick the ev_timer is armed for, if any. */
+	u64 scheduled;
+	int count;
+	bool started;
+	ev_tstamp start;
+	ev_timer timer;
+} wheel;
+
+static void wheel_expire(ev_timer *timer, int revents);
+
+static u64
+wheel_now(void)
+{
+	/* Don't let a rounding error fire a timer a tick early. */
+	return (u64) ((ev_now() - wheel.start) / WHEEL_TICK + 1e-6);
+}
+
+static void
+wheel_insert(struct wheel_timer *timer)
+{
+	u64 expires = timer->expires < wheel.tick ? wheel.tick : timer->expires;
+	u64 delta = expires - wheel.tick;
+	int level = 0;
+
+	if (delta >= WHEEL_SPAN) {
+		expires = wheel.tick + WHEEL_SPAN - 1;
+		delta = WHEEL_SPAN - 1;
+	}
+	while (delta >= 1ULL << (WHEEL_BITS * (level + 1)))
+		level++;
+
+	int slot = (expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+	LIST_INSERT_HEAD(&wheel.slots[level][slot], timer, link);
+}
+
+/** Re-insert timers of the current slot of the level. */
+static void
+wheel_cascade(int level)
+{
+	int slot = (wheel.tick >> (WHEEL_BITS * level)) & WHEEL_MASK;
+	struct wheel_slot timers = LIST_HEAD_INITIALIZER(timers);
+	struct wheel_timer *timer;
+
+	if (slot == 0 && level + 1 < WHEEL_LEVELS)
+		wheel_cascade(level + 1);
+
+	while ((timer = LIST_FIRST(&wheel.slots[level][slot])) != NULL) {
+		LIST_REMOVE(timer, link);
+		LIST_INSERT_HEAD(&timers, timer, link);
+	}
+	while ((timer = LIST_FIRST(&timers)) != NULL) {
+		LIST_REMOVE(timer, link);
+		wheel_insert(timer);
+	}
+}
+
+/** The nearest tick at which something has to be done. */
+static u64
+wheel_next(void)
+{
+	for (int i = 0; i < WHEEL_SIZE; i++) {
+		u64 tick = wheel.tick + i;
+		/* A turn of level 0: a cascade is due. */
+		if ((tick & WHEEL_MASK) == 0 ||
+		    !LIST_EMPTY(&wheel.slots[0][tick & WHEEL_MASK]))
+			return tick;
+	}
+	return wheel.tick + WHEEL_SIZE;
+}
+
+static void
+wheel_schedule(u64 tick)
+{
+	ev_tstamp delay = wheel.start + tick * WHEEL_TICK - ev_now();
+
+	ev_timer_stop(&wheel.timer);
+	ev_timer_set(&wheel.timer, delay > 0 ? delay : 0, 0);
+	ev_timer_start(&wheel.timer);
+	wheel.scheduled = tick;
+}
+
+static void
+wheel_expire(ev_timer *timer __attribute__((unused)),
+	     int revents __attribute__((unused)))
+{
+	u64 now = wheel_now();
+
+	wheel.scheduled = UINT64_MAX;
+
+	while (wheel.tick <= now && wheel.count > 0) {
+		int slot = wheel.tick & WHEEL_MASK;
+		struct wheel_slot expired = LIST_HEAD_INITIALIZER(expired);
+		struct wheel_timer *t;
+
+		if (slot == 0)
+			wheel_cascade(1);
+		/*
+		 * Callbacks may start new timers, possibly in this
+		 * very slot: take the expired ones out first.
+		 */
+		while ((t = LIST_FIRST(&wheel.slots[0][slot])) != NULL) {
+			LIST_REMOVE(t, link);
+			LIST_INSERT_HEAD(&expired, t, link);
+		}
+		wheel.tick++;
+
+		while ((t = LIST_FIRST(&expired)) != NULL) {
+			LIST_REMOVE(t, link);
+			t->active = false;
+			wheel.count--;
+			t->cb(t);
+		}
+	}
+	/* Nothing to expire: catch up at once. */
+	if (wheel.count == 0 && wheel.tick <= now)
+		wheel.tick = now + 1;
+
+	if (wheel.count > 0)
+		wheel_schedule(wheel_next());
+}
+
+void
+wheel_timer_start(struct wheel_timer *timer, ev_tstamp delay)
+{
+	if (!wheel.started) {
+		wheel.start = ev_now();
+		wheel.scheduled = UINT64_MAX;
+		ev_init(&wheel.timer, wheel_expire);
+		wheel.started = true;
+	}
+	if (timer->active)
+		wheel_timer_stop(timer);
+	/* An idle wheel doesn't move: catch up before inserting. */
+	if (wheel.count == 0 && wheel.tick < wheel_now())
+		wheel.tick = wheel_now();
+
+	/* Round up: a timer never fires early. */
+	double at = (ev_now() - wheel.start + (delay > 0 ? delay : 0)) / WHEEL_TICK;
+	timer->expires = (u64) at;
+	if (timer->expires < at)
+		timer->expires++;
+	timer->active = true;
+	wheel.count++;
+	wheel_insert(timer);
+
+	u64 expires = timer->expires < wheel.tick ? wheel.tick : timer->expires;
+	if (expires < wheel.scheduled)
+		wheel_schedule(wheel_next());
+}
+
+void
+wheel_timer_stop(struct wheel_timer *timer)
+{
+	if (!timer->active)
+		return;
+	LIST_REMOVE(timer, link);
+	timer->active = false;
+	wheel.count--;
+	/* The ev_timer may fire for nothing, which is harmless. */
+}
@@ -42,6 +42,10 @@
 #define MAP_ANONYMOUS MAP_ANON
 #endif
 
+/*
+ * Set if the system has the io_uring header, see core/uring.m.
+ */
+#cmakedefine HAVE_LINUX_IO_URING_H 1
 /*
  * Set if this is a GNU system and libc has __libc_stack_end.
  */
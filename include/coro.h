@@ -25,18 +25,34 @@
  * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+#include <stdbool.h>
 #include <stddef.h> /* size_t */
 
 #include <third_party/coro/coro.h>
 
+/** The default coroutine stack size, in bytes. */
+#define TARANTOOL_CORO_STACK_SIZE (64 * 1024)
+
 struct tarantool_coro {
 	coro_context ctx;
 	void *stack;
 	size_t stack_size;
+	unsigned valgrind_id;
 };
 
+/**
+ * Set the default stack size, rounded up to a page. 0 means
+ * TARANTOOL_CORO_STACK_SIZE.
+ */
+void tarantool_coro_init(size_t stack_size);
 struct tarantool_coro *tarantool_coro_create(struct tarantool_coro *ctx, void (*f) (void *),
 					     void *data);
+/** Create a coroutine with a stack of at least stack_size bytes. */
+struct tarantool_coro *tarantool_coro_create_stack(struct tarantool_coro *ctx,
+						   void (*f) (void *), void *data,
+						   size_t stack_size);
 void tarantool_coro_destroy(struct tarantool_coro *ctx);
+/** Whether addr is in the guard page of the coroutine stack. */
+bool tarantool_coro_guard(const struct tarantool_coro *ctx, const void *addr);
 
 #endif /* TARANTOOL_CORO_H_INCLUDED */
@@ -45,6 +45,42 @@ int cpu_has (unsigned int feature);
 u_int32_t crc32c_hw(u_int32_t crc, unsigned char const *p, size_t len);
 
 
+#if defined (__x86_64__) || defined (__i386__)
+
+/* the clock cpu_rdtsc() reads */
+#define CPU_RDTSC_CLOCK "tsc"
+
+/* read the time stamp counter: cheap, but in CPU-specific units
+ */
+static inline u_int64_t
+cpu_rdtsc(void)
+{
+	u_int32_t lo, hi;
+
+	__asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((u_int64_t) hi << 32) | lo;
+}
+
+#else
+
+#include <time.h>
+
+#define CPU_RDTSC_CLOCK "monotonic"
+
+/* no time stamp counter: nanoseconds of the monotonic clock
+ */
+static inline u_int64_t
+cpu_rdtsc(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u_int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#endif
+
+
 #endif /* TARANTOOL_CPU_FEATURES_H */
 
 /* __EOF__ */
@@ -94,8 +94,8 @@ enum { TNT_ERRMSG_MAX = 512 };
 	/* 38 */_(ER_WRONG_VERSION,		2, "Unsupported version of protocol") \
 		/* end of silversearch error codes */					\
 	/* 39 */_(ER_WAL_IO,			2, "Failed to write to disk") \
-	/* 40 */_(ER_UNUSED40,			0, "Unused40") \
-	/* 41 */_(ER_UNUSED41,			0, "Unused41") \
+	/* 40 */_(ER_QUORUM_TIMEOUT,		2, "Timed out waiting for %u replica(s) to acknowledge the change") \
+	/* 41 */_(ER_SPACE_MEMORY_LIMIT,	2, "Space %u has reached its memory limit of %u MB") \
 	/* 42 */_(ER_UNUSED42,			0, "Unused42") \
 	/* 43 */_(ER_UNUSED43,			0, "Unused43") \
 	/* 44 */_(ER_UNUSED44,			0, "Unused44") \
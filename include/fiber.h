@@ -38,6 +38,7 @@
 #include <tbuf.h>
 #include <coro.h>
 #include <util.h>
+#include <wheel.h>
 #include "third_party/queue.h"
 
 #include "exception.h"
@@ -50,6 +51,8 @@
 #define FIBER_CANCELLABLE   0x2
 /** Indicates that a fiber has been cancelled. */
 #define FIBER_CANCEL        0x4
+/** The fiber is waiting for its io watcher, see fiber_io_yield(). */
+#define FIBER_IO_WAIT       0x8
 
 /** This is thrown by fiber_* API calls when the fiber is
  * cancelled.
@@ -68,6 +71,25 @@ struct ring {
 	struct msg *ring[];
 };
 
+/*
+ * With fiber_stat, each fiber accounts its run time. All times
+ * are in cpu_rdtsc() units: TSC cycles, or nanoseconds of the
+ * monotonic clock where there's no TSC; see fiber_stat_seconds().
+ */
+struct fiber_stat {
+	/* When the fiber was switched to last time. */
+	u64 run_start;
+	u64 run_time;
+	/* The longest single run without a yield. */
+	u64 max_slice;
+	/* When fiber_wakeup() was called, 0 if it wasn't. */
+	u64 wakeup_start;
+	u64 wakeups;
+	/* From fiber_wakeup() to the fiber running. */
+	u64 wakeup_latency;
+	u64 max_wakeup_latency;
+};
+
 struct fiber {
 	ev_io io;
 	ev_async async;
@@ -75,13 +97,15 @@ struct fiber {
 	void *last_stack_frame;
 #endif
 	int csw;
+	struct fiber_stat stat;
 	struct tarantool_coro coro;
 	/* A garbage-collected memory pool. */
 	struct palloc_pool *gc_pool;
 	uint32_t fid;
 	int fd;
 
-	ev_timer timer;
+	/* fiber_sleep() */
+	struct wheel_timer timer;
 	ev_child cw;
 
 	struct tbuf *iov;
@@ -130,8 +154,16 @@ void fiber_register_cleanup(fiber_cleanup_handler handler, void *data);
 extern struct fiber *fiber;
 
 void fiber_init(void);
+/** Convert a fiber_stat time to seconds. */
+double fiber_stat_seconds(u64 tsc);
 void fiber_free(void);
 struct fiber *fiber_create(const char *name, int fd, int inbox_size, void (*f) (void *), void *);
+/**
+ * Like fiber_create(), but the fiber gets a stack of at least
+ * stack_size bytes. 0 means the default stack size.
+ */
+struct fiber *fiber_create_stack(const char *name, size_t stack_size, int fd,
+				 int inbox_size, void (*f) (void *), void *);
 void fiber_set_name(struct fiber *fiber, const char *name);
 void wait_for_child(pid_t pid);
 
@@ -23,6 +23,7 @@
  * SUCH DAMAGE.
  */
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include <tbuf.h> /* for struct tbuf */
@@ -56,4 +57,30 @@ typedef void (*iproto_callback) (uint32_t msg_code, struct tbuf *request);
 
 void iproto_interact(iproto_callback *callback);
 
+/**
+ * Start network threads, which iproto_interact() hands client
+ * sockets over to, see iproto.m. Must be called before any
+ * connection is accepted. Linux only.
+ */
+void iproto_threads_init(int count, int readahead);
+
+typedef bool (*iproto_is_write_f) (uint32_t msg_code);
+
+/**
+ * Let up to limit requests of a connection execute at once,
+ * each replied to as soon as it's done. 1, the default, means
+ * requests are executed and replied to in order. Writes, told
+ * apart by is_write, are still executed one at a time and in
+ * order, while reads go past them; with is_write NULL every
+ * request is a write.
+ */
+void iproto_set_inflight_limit(int limit, iproto_is_write_f is_write);
+
+/**
+ * Don't keep a fiber for an idle connection: watch the socket
+ * from the event loop and take a fiber only to execute requests
+ * which have been read in full. readahead is the size of a read.
+ */
+void iproto_set_lazy_fibers(bool lazy, int readahead);
+
 #endif
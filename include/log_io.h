@@ -34,6 +34,7 @@
 #include <util.h>
 #include <palloc.h>
 #include <netinet/in.h> /* struct sockaddr_in */
+#include <third_party/queue.h>
 
 struct tbuf;
 
@@ -112,6 +113,10 @@ struct recovery_state {
 	row_handler *row_handler;
 	struct sockaddr_in remote_addr;
 	struct fiber *remote_recovery;
+	/* Replication features to ask the master for, and agreed on */
+	u32 remote_features, remote_accepted;
+	/* Bytes of the current frame not yet read, see replication_frame */
+	u32 remote_frame_left;
 
 	ev_timer wal_timer;
 	ev_tstamp recovery_lag, recovery_last_update_tstamp;
@@ -119,6 +124,8 @@ struct recovery_state {
 	int snap_io_rate_limit;
 	u64 cookie;
 	struct wait_lsn wait_lsn;
+	/* Recently written rows, kept for in-process replication relays */
+	struct wal_ring *wal_ring;
 
 	bool finalize;
 
@@ -126,6 +133,53 @@ struct recovery_state {
 	void *data;
 };
 
+/**
+ * Replication handshake.
+ *
+ * In the original protocol a replica sends the i64 LSN to start
+ * from, and the master replies with the u32 protocol version and
+ * a stream of rows. A replica may instead send a greeting, which
+ * starts with a magic that is never a valid LSN and lists the
+ * features the replica would like to use. The master then replies
+ * with the version and the u32 subset of features it accepted.
+ *
+ * With REPLICATION_FRAMES, rows are sent in frames, each a
+ * struct replication_frame followed by the payload: a sequence of
+ * rows, compressed with LZF if REPLICATION_COMPRESS is accepted
+ * and the frame's size and uncompressed_size differ.
+ *
+ * With REPLICATION_ACK, the replica sends back the i64 LSN of the
+ * last row it has written to its own WAL, whenever it runs out of
+ * rows to apply.
+ *
+ * REPLICATION_BOOTSTRAP is asked for by a replica with no data. If
+ * the master has a snapshot which covers the requested LSN, it
+ * accepts the feature and sends the snapshot rows (with tag
+ * snap_tag and LSN 0) first, then a snap_tag row with no data and
+ * the snapshot LSN, and then the rows following the snapshot.
+ */
+
+#define REPLICATION_GREETING_MAGIC ((i64) 0xfeedbeef0badc0deULL)
+
+enum replication_features {
+	REPLICATION_FRAMES = 0x1,
+	REPLICATION_COMPRESS = 0x2,
+	REPLICATION_ACK = 0x4,
+	REPLICATION_BOOTSTRAP = 0x8
+};
+
+struct replication_greeting {
+	i64 magic;
+	i64 lsn;
+	u32 features;
+} __attribute__((packed));
+
+struct replication_frame {
+	u32 size;
+	u32 uncompressed_size;
+	u8 data[];
+} __attribute__((packed));
+
 struct wal_write_request {
 	i64 lsn;
 	u32 len;
@@ -146,6 +200,47 @@ static inline struct row_v11 *row_v11(const struct tbuf *t)
 	return (struct row_v11 *)t->data;
 }
 
+/**
+ * An in-memory ring of the most recently written WAL rows.
+ *
+ * The ring is filled by wal_write() after the WAL writer has
+ * acknowledged a row, so it contains only rows that are already
+ * on disk. Rows in the ring always have consecutive LSNs,
+ * first_lsn..last_lsn: a hole in the LSN sequence (e.g. after a
+ * failed write) empties the ring. Replication relays running
+ * inside the master read rows from the ring and fall back to
+ * xlog files once the rows they need have been evicted.
+ */
+
+struct wal_ring_reader {
+	/** The fiber to wake up when new rows arrive. */
+	struct fiber *fiber;
+	/** LSN of the next row this reader is interested in. */
+	i64 lsn;
+	SLIST_ENTRY(wal_ring_reader) link;
+};
+
+struct wal_ring {
+	/** Total number of row slots and the slot of first_lsn. */
+	u32 size, head;
+	/** The ring is empty when first_lsn > last_lsn. */
+	i64 first_lsn, last_lsn;
+	SLIST_HEAD(, wal_ring_reader) readers;
+	/** Each slot points to a malloc()ed row with data. */
+	struct row_v11 *row[];
+};
+
+struct wal_ring *wal_ring_create(u32 size, i64 confirmed_lsn);
+void wal_ring_append(struct wal_ring *ring, i64 lsn, u16 tag, u64 cookie, struct tbuf *data);
+/** @retval true if the row with this LSN is in the ring or is the next to come. */
+bool wal_ring_has(struct wal_ring *ring, i64 lsn);
+/** @retval the row with this LSN or NULL if it is not in the ring. */
+struct row_v11 *wal_ring_row(struct wal_ring *ring, i64 lsn);
+/** Wait until the row with reader->lsn is appended or evicted,
+ * or until the reader's fiber is woken up by someone else.
+ */
+void wal_ring_wait(struct wal_ring *ring, struct wal_ring_reader *reader);
+
 struct tbuf *convert_to_v11(struct tbuf *orig, u16 tag, u64 cookie, i64 lsn);
 
 struct recovery_state *recover_init(const char *snap_dirname, const char *xlog_dirname,
@@ -158,6 +253,8 @@ void recover_follow(struct recovery_state *r, ev_tstamp wal_dir_rescan_delay);
 void recover_finalize(struct recovery_state *r);
 bool wal_write(struct recovery_state *r, u16 tag, u64 cookie, i64 lsn, struct tbuf *data);
 
+i64 greatest_lsn(struct log_io_class *class);
+int recover_snap(struct recovery_state *r);
 void recovery_setup_panic(struct recovery_state *r, bool on_snap_error, bool on_wal_error);
 
 int confirm_lsn(struct recovery_state *r, i64 lsn);
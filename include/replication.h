@@ -28,6 +28,8 @@
 #include <tarantool.h>
 #include <util.h>
 
+struct tbuf;
+
 /**
  * Check replication configuration.
  *
@@ -54,5 +56,20 @@ replication_prefork();
 void
 replication_init();
 
+/**
+ * Print the state of in-process replication relays for show info.
+ */
+void
+replication_info(struct tbuf *out);
+
+/**
+ * Wait until at least quorum replicas acknowledge the LSN.
+ * This is not a cancellation point.
+ *
+ * @return 0 on success, -1 on timeout.
+ */
+int
+replication_wait_quorum(i64 lsn, int quorum, ev_tstamp timeout);
+
 #endif // TARANTOOL_REPLICATION_H_INCLUDED
 
@@ -32,11 +32,41 @@
 
 struct tbuf;
 
-bool salloc_init(size_t size, size_t minimal, double factor);
+bool salloc_init(size_t size, size_t minimal, double factor,
+		 int huge_page_mb, bool prefault);
 void salloc_destroy(void);
 void *salloc(size_t size);
 void sfree(void *ptr);
+/** The amount of arena memory the item takes. */
+size_t salloc_size(void *ptr);
+/** The amount of arena memory salloc(size) would take, 0 if too big. */
+size_t salloc_class_size(size_t size);
+/** True if salloc(size) can succeed right away. */
+bool salloc_has_room(size_t size);
 void slab_validate();
 void slab_stat(struct tbuf *buf);
 void slab_stat2(u64 *bytes_used, u64 *items);
+
+/**
+ * Return the pages of slabs that stay empty for longer than
+ * delay seconds to the OS. 0 disables.
+ */
+void slab_reclaim_init(double delay);
+
+/** Called when an allocation fails for the lack of a free slab. */
+extern void (*salloc_on_shortage)(void);
+
+/*
+ * Slab compaction. slab_evacuate_begin() takes the slabs filled
+ * less than the given fraction out of allocation, as long as their
+ * items fit into the other slabs of the same class. The owner of
+ * the items then moves every item for which salloc_evacuating()
+ * is true into a fresh salloc() and frees the old copy: emptied
+ * slabs go back to the common pool. slab_evacuate_end() returns
+ * the slabs which still hold items to allocation, and the number
+ * of such slabs.
+ */
+int slab_evacuate_begin(double fill);
+bool salloc_evacuating(void *ptr);
+int slab_evacuate_end(void);
 #endif /* TARANTOOL_SALLOC_H_INCLUDED */
@@ -0,0 +1,52 @@
+#ifndef TARANTOOL_STALL_H_INCLUDED
+#define TARANTOOL_STALL_H_INCLUDED
+/*
+ * Copyright (C) 2010, 2011 Mail.RU
+ * Copyright (C) 2010, 2011 Yuriy Vostrikov
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+struct tbuf;
+
+/*
+ * The event loop stall detector, see stall.m. A stall is the
+ * event loop not getting back to polling for longer than the
+ * threshold: some fiber runs without yielding.
+ */
+
+/** The number of the latest stalls kept for "show stall". */
+enum { STALL_HISTORY = 16 };
+
+/**
+ * Start the watchdog thread. Must be called after the last fork
+ * of the process, right before entering the event loop.
+ */
+void stall_init(double threshold);
+
+/**
+ * Print the latest stalls, with the fiber and its backtrace.
+ * The list is empty if the detector isn't running.
+ */
+void stall_info(struct tbuf *out);
+
+#endif /* TARANTOOL_STALL_H_INCLUDED */
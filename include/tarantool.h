@@ -44,6 +44,8 @@ i32 mod_reload_config(struct tarantool_cfg *old_conf, struct tarantool_cfg *new_
 int mod_cat(const char *filename);
 void mod_snapshot(struct log_io_iter *);
 void mod_info(struct tbuf *out);
+/** Module memory statistics, appended to "show slab". */
+void mod_slab_stat(struct tbuf *out);
 /**
  * This is a callback used by tarantool_lua_init() to open
  * module-specific libraries into given Lua state.
@@ -87,6 +89,13 @@ extern char *cfg_filename_fullpath;
 extern bool init_storage, booting;
 extern char *binary_filename;
 extern char *custom_proc_title;
+/** The number of this shard, -1 if not a shard, see cfg.shards. */
+extern int shard_no;
+/**
+ * Sockets between the router and the shards, indexed by shard
+ * number. A shard only has its own one.
+ */
+extern int *shard_links;
 i32 reload_cfg(struct tbuf *out);
 int snapshot(void * /* ev */, int /* events */);
 const char *tarantool_version(void);
@@ -0,0 +1,53 @@
+#ifndef TARANTOOL_URING_H_INCLUDED
+#define TARANTOOL_URING_H_INCLUDED
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met: 1. Redistributions of source code must
+ * retain the above copyright notice, this list of conditions and
+ * the following disclaimer.  2. Redistributions in binary form
+ * must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/*
+ * An io_uring backend for client socket I/O, see uring.m.
+ * uring_read() and uring_writev() behave like read(2) and
+ * writev(2) on a non-blocking socket, except that they yield the
+ * calling fiber until the socket is ready instead of returning
+ * EAGAIN. Both are cancellation points.
+ */
+
+/** The size of the ring, requests in flight at once. */
+enum { URING_ENTRIES = 4096 };
+
+/** Set once uring_init() has succeeded. */
+extern bool uring_enabled;
+
+/**
+ * Set up a ring of the given size and hook it into the event
+ * loop. Returns -1 if the kernel doesn't support io_uring.
+ */
+int uring_init(unsigned entries);
+
+ssize_t uring_read(int fd, void *buf, size_t count);
+ssize_t uring_writev(int fd, const struct iovec *iov, int iovcnt);
+
+#endif /* TARANTOOL_URING_H_INCLUDED */
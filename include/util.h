@@ -119,6 +119,11 @@ extern void *__libc_stack_end;
 
 #ifdef ENABLE_BACKTRACE
 char *backtrace(void *frame, void *stack, size_t stack_size);
+/** Store up to count return addresses of the stack, from frame up. */
+int backtrace_collect(void *frame, void *stack, size_t stack_size, void **ret, int count);
+struct tbuf;
+/** Print return addresses stored by backtrace_collect(). */
+void backtrace_print(struct tbuf *out, void **ret, int count);
 #endif /* ENABLE_BACKTRACE */
 
 #ifdef HAVE_BFD
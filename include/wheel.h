@@ -0,0 +1,67 @@
+#ifndef TARANTOOL_WHEEL_H_INCLUDED
+#define TARANTOOL_WHEEL_H_INCLUDED
+/*
+ * Copyright (C) 2010, 2011 Mail.RU
+ * Copyright (C) 2010, 2011 Yuriy Vostrikov
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+
+#include <tarantool_ev.h>
+#include <third_party/queue.h>
+#include <util.h>
+
+/*
+ * A hierarchical timer wheel, see wheel.m. Starting and stopping
+ * a timer is O(1), independent of the number of timers, unlike
+ * ev_timer, which is kept in a heap. Timers have a resolution of
+ * WHEEL_TICK and fire from the event loop.
+ */
+
+/** The resolution of the wheel, in seconds. */
+#define WHEEL_TICK 0.001
+
+struct wheel_timer {
+	LIST_ENTRY(wheel_timer) link;
+	/* In ticks since the wheel was started. */
+	u64 expires;
+	bool active;
+	void (*cb)(struct wheel_timer *timer);
+	void *data;
+};
+
+static inline void
+wheel_timer_init(struct wheel_timer *timer,
+		 void (*cb)(struct wheel_timer *timer), void *data)
+{
+	timer->active = false;
+	timer->cb = cb;
+	timer->data = data;
+}
+
+/** Fire the timer once, in delay seconds. Restarts an active timer. */
+void wheel_timer_start(struct wheel_timer *timer, ev_tstamp delay);
+void wheel_timer_stop(struct wheel_timer *timer);
+
+#endif /* TARANTOOL_WHEEL_H_INCLUDED */
@@ -27,6 +27,7 @@
  */
 
 #include <mod/box/index.h>
+#include <mod/box/tuple.h>
 #include "exception.h"
 #include "iproto.h"
 #include <tbuf.h>
@@ -44,12 +45,52 @@ enum
 struct space {
 	int n;
 	bool enabled;
+	/** Wait for replication_sync_quorum replicas on every change. */
+	bool sync;
 	int cardinality;
 	Index *index[BOX_INDEX_MAX];
+	/** Arena memory taken by the tuples of the space. */
+	size_t tuple_bytes;
+	/** Limit of tuple and index memory, in bytes; 0 is none. */
+	size_t memory_limit;
+	/** The field with the tuple expiration time, or -1. */
+	int expire_field;
+	/** Keys by expiration time, see expire.h. */
+	struct expire_ring *expire;
+	/**
+	 * Widths of the fields of a space with field_types, or
+	 * NULL. All fields of such a space are NUM or NUM64.
+	 */
+	u8 *field_width;
+	/** Offsets of the fields in tuple->data, see field_width. */
+	u32 *field_offset;
 };
 
 extern struct space *space;
 
+/**
+ * Get a field of a tuple of the space. Every tuple of a space
+ * with field_types has fixed-width fields, so its fields are at
+ * the same, cached, offsets, and no field lengths need to be
+ * decoded to find one. The tuple itself is stored as usual.
+ *
+ * @returns field data if the field exists, or NULL
+ */
+static inline void *
+space_tuple_field(struct space *sp, struct box_tuple *tuple, u32 i)
+{
+	if (sp->field_offset == NULL)
+		return tuple_field(tuple, i);
+
+	if (i >= (u32) sp->cardinality)
+		return NULL;
+	return tuple->data + sp->field_offset[i];
+}
+
+/** Memory taken by the indexes of the space. */
+size_t
+space_index_memory(struct space *sp);
+
 struct box_out {
 	void (*add_u32)(u32 *u32);
 	void (*dup_u32)(u32 u32);
@@ -82,10 +123,14 @@ struct box_txn {
 #define BOX_REPLACE			0x04
 #define BOX_NOT_STORE			0x10
 #define BOX_GC_TXN			0x20
+#define BOX_SYNC			0x40
+/* The change is replayed from the WAL or a master. */
+#define BOX_RECOVER			0x80
 #define BOX_ALLOWED_REQUEST_FLAGS	(BOX_RETURN_TUPLE | \
 					 BOX_ADD | \
 					 BOX_REPLACE | \
-					 BOX_NOT_STORE)
+					 BOX_NOT_STORE | \
+					 BOX_SYNC)
 
 /*
     deprecated commands:
@@ -118,6 +163,7 @@ struct box_txn {
 ENUM(messages, MESSAGES);
 
 extern iproto_callback rw_callback;
+bool box_op_is_write(u32 op);
 
 /* These are used to implement memcached 'GET' */
 static inline struct box_txn *in_txn() { return fiber->mod_data.txn; }
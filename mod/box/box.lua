@@ -119,6 +119,9 @@ function box.on_reload_configuration()
         end
     end
     space_mt.pairs = function(space) return space.index[0]:pairs() end
+    space_mt.memory = function(space)
+        return space.index[0].idx:space_memory()
+    end
     space_mt.__index = space_mt
     for i, space in pairs(box.space) do
         rawset(space, 'n', i)
@@ -26,6 +26,8 @@
 #include <mod/box/box.h>
 
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <errno.h>
@@ -36,6 +38,7 @@
 #include <fiber.h>
 #include <log_io.h>
 #include <pickle.h>
+#include <replication.h>
 #include <salloc.h>
 #include <say.h>
 #include <stat.h>
@@ -47,6 +50,9 @@
 #include <mod/box/tuple.h>
 #include "memcached.h"
 #include "box_lua.h"
+#include "shard.h"
+#include "compact.h"
+#include "expire.h"
 
 static void box_process_ro(u32 op, struct tbuf *request_data);
 static void box_process_rw(u32 op, struct tbuf *request_data);
@@ -133,7 +139,8 @@ validate_indexes(struct box_txn *txn)
 			if (index->key_def.parts[f].type == STRING)
 				continue;
 
-			void *field = tuple_field(txn->tuple, index->key_def.parts[f].fieldno);
+			void *field = space_tuple_field(txn->space, txn->tuple,
+							index->key_def.parts[f].fieldno);
 			u32 len = load_varint32(&field);
 
 			if (index->key_def.parts[f].type == NUM && len != sizeof(u32))
@@ -153,6 +160,62 @@ validate_indexes(struct box_txn *txn)
 	}
 }
 
+size_t
+space_index_memory(struct space *sp)
+{
+	size_t size = 0;
+
+	foreach_index(sp->n, index)
+		size += [index memsize];
+	return size;
+}
+
+/**
+ * Refuse a change which would take the space over its memory
+ * limit. Changes replayed from the WAL or received from a
+ * master are not checked: they are already committed.
+ */
+static void
+space_check_memory(struct box_txn *txn)
+{
+	struct space *sp = txn->space;
+
+	if (sp->memory_limit == 0 || txn->flags & BOX_RECOVER)
+		return;
+
+	size_t new_size = salloc_size(txn->tuple);
+	size_t old_size = txn->old_tuple ? salloc_size(txn->old_tuple) : 0;
+	if (new_size <= old_size)
+		return;
+
+	if (sp->tuple_bytes + space_index_memory(sp) + new_size - old_size >
+	    sp->memory_limit)
+		tnt_raise(ClientError, :ER_SPACE_MEMORY_LIMIT, txn->n,
+			  (u32) (sp->memory_limit >> 20));
+}
+
+/**
+ * Check that the fields of a tuple of a space with field_types
+ * have the declared widths, which keeps them at constant offsets.
+ */
+static void
+space_validate_field_types(struct space *sp, struct box_tuple *tuple)
+{
+	if (sp->field_width == NULL)
+		return;
+
+	if (tuple->cardinality != sp->cardinality)
+		tnt_raise(IllegalParams, :"tuple cardinality must match space cardinality");
+
+	void *field = tuple->data;
+	for (int i = 0; i < sp->cardinality; i++) {
+		u32 len = load_varint32(&field);
+		if (len != sp->field_width[i])
+			tnt_raise(IllegalParams, :"field width must match space field_types");
+		field += len;
+	}
+}
+
 static void __attribute__((noinline))
 prepare_replace(struct box_txn *txn, size_t cardinality, struct tbuf *data)
 {
@@ -160,6 +223,9 @@ prepare_replace(struct box_txn *txn, size_t cardinality, struct tbuf *data)
 	if (cardinality == 0)
 		tnt_raise(IllegalParams, :"tuple cardinality is 0");
 
+	if (cardinality > TUPLE_CARDINALITY_MAX)
+		tnt_raise(IllegalParams, :"tuple cardinality is too big");
+
 	if (data->size == 0 || data->size != valid_tuple(data, cardinality))
 		tnt_raise(IllegalParams, :"incorrect tuple length");
 
@@ -167,6 +233,7 @@ prepare_replace(struct box_txn *txn, size_t cardinality, struct tbuf *data)
 	tuple_txn_ref(txn, txn->tuple);
 	txn->tuple->cardinality = cardinality;
 	memcpy(txn->tuple->data, data->data, data->size);
+	space_validate_field_types(txn->space, txn->tuple);
 
 	txn->old_tuple = [txn->index findByTuple: txn->tuple];
 
@@ -179,6 +246,7 @@ prepare_replace(struct box_txn *txn, size_t cardinality, struct tbuf *data)
 	if (txn->flags & BOX_REPLACE && txn->old_tuple == NULL)
 		tnt_raise(ClientError, :ER_TUPLE_NOT_FOUND);
 
+	space_check_memory(txn);
 	validate_indexes(txn);
 
 	if (txn->old_tuple != NULL) {
@@ -227,12 +295,17 @@ commit_replace(struct box_txn *txn)
 		foreach_index(txn->n, index)
 			[index replace: txn->old_tuple :txn->tuple];
 
+		txn->space->tuple_bytes -= salloc_size(txn->old_tuple);
 		tuple_ref(txn->old_tuple, -1);
 	}
 
 	if (txn->tuple != NULL) {
 		txn->tuple->flags &= ~GHOST;
+		txn->space->tuple_bytes += salloc_size(txn->tuple);
 		tuple_ref(txn->tuple, +1);
+
+		if (txn->space->expire != NULL)
+			space_expire_add(txn->space, txn->tuple);
 	}
 }
 
@@ -454,6 +527,8 @@ prepare_update(struct box_txn *txn, struct tbuf *data)
 		p += fields[i]->size;
 	}
 
+	space_validate_field_types(txn->space, txn->tuple);
+	space_check_memory(txn);
 	validate_indexes(txn);
 
 	if (data->size != 0)
@@ -561,6 +636,7 @@ commit_delete(struct box_txn *txn)
 
 	foreach_index(txn->n, index)
 		[index remove: txn->old_tuple];
+	txn->space->tuple_bytes -= salloc_size(txn->old_tuple);
 	tuple_ref(txn->old_tuple, -1);
 }
 
@@ -570,6 +646,13 @@ op_is_select(u32 op)
 	return op == SELECT || op == CALL;
 }
 
+/** A procedure may change data, so pipelined CALLs are writes. */
+bool
+box_op_is_write(u32 op)
+{
+	return op != SELECT;
+}
+
 static void
 iov_add_u32(u32 *p_u32)
 {
@@ -589,9 +672,9 @@ iov_add_tuple(struct box_tuple *tuple)
 
 	if (len > BOX_REF_THRESHOLD) {
 		tuple_txn_ref(in_txn(), tuple);
-		iov_add(&tuple->bsize, len);
+		tuple_to_iov(tuple, false);
 	} else {
-		iov_dup(&tuple->bsize, len);
+		tuple_to_iov(tuple, true);
 	}
 }
 
@@ -668,6 +751,7 @@ txn_commit(struct box_txn *txn)
 {
 	assert(txn == in_txn());
 	assert(txn->op);
+	bool quorum_timeout = false;
 
 	if (!op_is_select(txn->op)) {
 		say_debug("box_commit(op:%s)", messages_strs[txn->op]);
@@ -686,6 +770,21 @@ txn_commit(struct box_txn *txn)
 			confirm_lsn(recovery_state, lsn);
 			if (res)
 				tnt_raise(LoggedError, :ER_WAL_IO);
+
+			/*
+			 * A synchronous change stays invisible and its
+			 * tuples locked until a quorum of replicas has
+			 * it, so no client reads a change which may be
+			 * lost on a failover. If the replicas are too
+			 * slow, it is committed all the same: it is in
+			 * the local WAL, and only the client learns that
+			 * the quorum wasn't reached.
+			 */
+			if (cfg.replication_sync_quorum > 0 &&
+			    (txn->flags & BOX_SYNC || (txn->space && txn->space->sync)))
+				quorum_timeout =
+					replication_wait_quorum(lsn, cfg.replication_sync_quorum,
+								cfg.replication_sync_timeout) != 0;
 		}
 
 		unlock_tuples(txn);
@@ -706,6 +805,10 @@ txn_commit(struct box_txn *txn)
 		fiber_register_cleanup((fiber_cleanup_handler)txn_cleanup, txn);
 	else
 		txn_cleanup(txn);
+
+	if (quorum_timeout)
+		tnt_raise(ClientError, :ER_QUORUM_TIMEOUT,
+			  cfg.replication_sync_quorum);
 }
 
 void
@@ -936,6 +1039,68 @@ space_free(void)
 	}
 }
 
+/**
+ * Parse space field_types, a comma-separated list of NUM and
+ * NUM64, and store the field widths if width is not NULL.
+ *
+ * @returns the number of fields, or -1 if the list is invalid
+ */
+static int
+space_field_types_parse(const char *types, u8 *width)
+{
+	int count = 0;
+
+	for (const char *p = types;; p++) {
+		size_t len = strcspn(p, ",");
+		char type[sizeof("NUM64")];
+
+		if (len == 0 || len >= sizeof(type) || count == TUPLE_CARDINALITY_MAX)
+			return -1;
+		memcpy(type, p, len);
+		type[len] = '\0';
+
+		u8 w;
+		switch (STR2ENUM(field_data_type, type)) {
+		case NUM:
+			w = sizeof(u32);
+			break;
+		case NUM64:
+			w = sizeof(u64);
+			break;
+		default:
+			return -1;
+		}
+		if (width != NULL)
+			width[count] = w;
+		count++;
+
+		p += len;
+		if (*p == '\0')
+			return count;
+	}
+}
+
+/** Cache the field offsets of a space with field_types. */
+static void
+space_field_types_init(struct space *sp, int n, const char *types)
+{
+	int count = space_field_types_parse(types, NULL);
+	assert(count > 0);
+
+	sp->field_width = malloc(count);
+	sp->field_offset = malloc(count * sizeof(u32));
+	if (sp->field_width == NULL || sp->field_offset == NULL)
+		panic("can't allocate the field offsets of space %i", n);
+	space_field_types_parse(types, sp->field_width);
+
+	u32 offset = 0;
+	for (int i = 0; i < count; i++) {
+		sp->field_offset[i] = offset;
+		offset += varint32_sizeof(sp->field_width[i]) + sp->field_width[i];
+	}
+	sp->cardinality = count;
+}
+
 static void
 key_init(struct key_def *def, struct tarantool_cfg_space_index *cfg_index)
 {
@@ -1006,7 +1171,18 @@ space_config(void)
 
 		space[i].enabled = true;
 
+		space[i].sync = cfg_space->sync;
+		space[i].memory_limit = (size_t) cfg_space->memory_limit << 20;
+		space[i].expire_field = cfg_space->expire_field;
+		if (space[i].expire_field >= 0) {
+			space[i].expire = calloc(1, sizeof(struct expire_ring));
+			if (space[i].expire == NULL)
+				panic("can't allocate the expiration index of space %i", i);
+			space[i].expire->next = ev_now();
+		}
 		space[i].cardinality = cfg_space->cardinality;
+		if (cfg_space->field_types != NULL && *cfg_space->field_types != '\0')
+			space_field_types_init(space + i, i, cfg_space->field_types);
 		/* fill space indexes */
 		for (int j = 0; cfg_space->index[j] != NULL; ++j) {
 			typeof(cfg_space->index[j]) cfg_index = cfg_space->index[j];
@@ -1059,7 +1235,9 @@ box_process_rw(u32 op, struct tbuf *request_data)
 		txn_commit(txn);
 	}
 	@catch (id e) {
-		txn_rollback(txn);
+		/* Nothing to roll back if only the quorum wait failed. */
+		if (in_txn() == txn)
+			txn_rollback(txn);
 		@throw;
 	}
 	@finally {
@@ -1118,7 +1296,7 @@ recover_row(struct recovery_state *r __attribute__((unused)), struct tbuf *t)
 	u16 op = read_u16(t);
 
 	struct box_txn *txn = txn_begin();
-	txn->flags |= BOX_NOT_STORE;
+	txn->flags |= BOX_NOT_STORE | BOX_RECOVER;
 	txn->out = &box_out_quiet;
 
 	@try {
@@ -1144,6 +1322,12 @@ title(const char *fmt, ...)
 	int ports[] = { cfg.primary_port, cfg.secondary_port,
 			cfg.memcached_port, cfg.admin_port,
 			cfg.replication_port };
+	/* A shard only serves the router, see shard.m. */
+	if (shard_no >= 0) {
+		ports[0] = ports[1] = 0;
+		if (ports[3] != 0)
+			ports[3] += shard_no + 1;
+	}
 	int *pptr = ports;
 	char *names[] = { "pri", "sec", "memc", "adm", "rpl", NULL };
 	char **nptr = names;
@@ -1163,6 +1347,18 @@ box_enter_master_or_replica_mode(struct tarantool_cfg *conf)
 	if (conf->replication_source != NULL) {
 		rw_callback = box_process_ro;
 
+		recovery_state->remote_features = 0;
+		if (conf->replication_batching)
+			recovery_state->remote_features |= REPLICATION_FRAMES;
+		if (conf->replication_compression)
+			recovery_state->remote_features |=
+				REPLICATION_FRAMES | REPLICATION_COMPRESS;
+		if (conf->replication_ack)
+			recovery_state->remote_features |= REPLICATION_ACK;
+		/* Nothing but an empty snapshot from --init-storage. */
+		if (recovery_state->confirmed_lsn <= 1)
+			recovery_state->remote_features |= REPLICATION_BOOTSTRAP;
+
 		recovery_wait_lsn(recovery_state, recovery_state->lsn);
 		recovery_follow_remote(recovery_state, conf->replication_source);
 
@@ -1187,6 +1383,8 @@ box_leave_local_standby_mode(void *data __attribute__((unused)))
 	recover_finalize(recovery_state);
 
 	box_enter_master_or_replica_mode(&cfg);
+	compact_start();
+	space_expire_start();
 }
 
 static i32
@@ -1224,6 +1422,36 @@ check_spaces(struct tarantool_cfg *conf)
 			return -1;
 		}
 
+		/* field_types declare the cardinality and all field types */
+		int types_count = 0;
+		if (space->field_types != NULL && *space->field_types != '\0') {
+			types_count = space_field_types_parse(space->field_types, NULL);
+			if (types_count == -1) {
+				out_warning(0, "(space = %zu) invalid field_types: `%s'",
+					    i, space->field_types);
+				return -1;
+			}
+			if (space->cardinality > 0 &&
+			    space->cardinality != types_count) {
+				out_warning(0, "(space = %zu) field_types must have "
+					    "cardinality fields", i);
+				return -1;
+			}
+		}
+		u8 types_width[MAX(types_count, 1)];
+		if (types_count > 0)
+			space_field_types_parse(space->field_types, types_width);
+		int cardinality = types_count > 0 ? types_count : space->cardinality;
+
+		if (space->expire_field < -1 ||
+		    (cardinality > 0 && space->expire_field >= cardinality) ||
+		    (types_count > 0 && space->expire_field >= 0 &&
+		     types_width[space->expire_field] != sizeof(u32))) {
+			out_warning(0, "(space = %zu) invalid expire_field: %i",
+				    i, space->expire_field);
+			return -1;
+		}
+
 		/* at least one index in space must be defined
 		 * */
 		if (space->index == NULL) {
@@ -1232,6 +1460,20 @@ check_spaces(struct tarantool_cfg *conf)
 			return -1;
 		}
 
+		/* expired tuples are looked up by the primary key field */
+		if (space->expire_field >= 0 && space->index[0] != NULL &&
+		    space->index[0]->key_field != NULL) {
+			int part_count = 0;
+			for (size_t k = 0; space->index[0]->key_field[k] != NULL &&
+			     space->index[0]->key_field[k]->fieldno != -1; ++k)
+				part_count++;
+			if (part_count != 1) {
+				out_warning(0, "(space = %zu) expire_field requires "
+					    "a single-part primary key", i);
+				return -1;
+			}
+		}
+
 		/* check spaces indexes */
 		for (size_t j = 0; space->index[j] != NULL; ++j) {
 			typeof(space->index[j]) index = space->index[j];
@@ -1275,6 +1517,22 @@ check_spaces(struct tarantool_cfg *conf)
 					return -1;
 				}
 
+				/* key must match the space field_types */
+				if (types_count > 0) {
+					enum field_data_type type =
+						STR2ENUM(field_data_type, key->type);
+					size_t width = type == NUM ? sizeof(u32) :
+						type == NUM64 ? sizeof(u64) : 0;
+					if (key->fieldno < 0 ||
+					    key->fieldno >= types_count ||
+					    types_width[key->fieldno] != width) {
+						out_warning(0, "(space = %zu index = %zu) "
+							    "key field %i does not match "
+							    "the space field_types", i, j, key->fieldno);
+						return -1;
+					}
+				}
+
 				++index_cardinality;
 			}
 
@@ -1375,6 +1633,62 @@ mod_check_config(struct tarantool_cfg *conf)
 		return -1;
 	}
 
+	if (conf->iproto_threads < 0) {
+		out_warning(0, "invalid number of network threads: %i",
+			    conf->iproto_threads);
+		return -1;
+	}
+	if (conf->iproto_inflight_limit <= 0) {
+		out_warning(0, "invalid in-flight request limit: %i",
+			    conf->iproto_inflight_limit);
+		return -1;
+	}
+	if (conf->iproto_lazy_fibers &&
+	    (conf->iproto_threads > 0 || conf->iproto_inflight_limit > 1)) {
+		out_warning(0, "iproto_lazy_fibers can't be used with "
+			    "iproto_threads or iproto_inflight_limit");
+		return -1;
+	}
+	if (conf->compact_threshold < 0 || conf->compact_threshold > 0.9) {
+		out_warning(0, "compact_threshold must be between 0 and 0.9");
+		return -1;
+	}
+	if (conf->compact_interval <= 0 || conf->compact_per_loop <= 0) {
+		out_warning(0, "invalid compaction interval or tuples per loop");
+		return -1;
+	}
+	if (conf->expire_per_loop <= 0 || conf->expire_rate_limit < 0) {
+		out_warning(0, "invalid expire tuples per loop or rate limit");
+		return -1;
+	}
+	if (conf->shards < 0) {
+		out_warning(0, "invalid number of shards: %i", conf->shards);
+		return -1;
+	}
+	if (conf->shards > 0) {
+		if (conf->replication_port != 0 ||
+		    conf->replication_source != NULL) {
+			out_warning(0, "replication is not supported with shards");
+			return -1;
+		}
+		if (conf->memcached_port != 0) {
+			out_warning(0, "memcached is not supported with shards");
+			return -1;
+		}
+		if ((conf->snap_dir != NULL && conf->snap_dir[0] == '/') ||
+		    (conf->wal_dir != NULL && conf->wal_dir[0] == '/')) {
+			out_warning(0, "snap_dir and wal_dir must be relative "
+				    "to work_dir with shards");
+			return -1;
+		}
+	}
+#ifndef TARGET_OS_LINUX
+	if (conf->iproto_threads > 0) {
+		out_warning(0, "network threads are only supported on Linux");
+		return -1;
+	}
+#endif
+
 	/* check if at least one space is defined */
 	if (conf->space == NULL && conf->memcached_port == 0) {
 		out_warning(0, "at least one space or memcached port must be defined");
@@ -1462,33 +1776,64 @@ mod_init(void)
 	if (init_storage)
 		return;
 
-	recover(recovery_state, 0);
-	stat_cleanup(stat_base, messages_MAX);
+	/* The router keeps no data, it passes requests to shards. */
+	bool router = cfg.shards > 0 && shard_no < 0;
+
+	if (router) {
+		snprintf(status, sizeof(status), "router");
+		title("router");
+	} else {
+		recover(recovery_state, 0);
+		stat_cleanup(stat_base, messages_MAX);
+
+		title("building indexes");
+
+		build_indexes();
 
-	title("building indexes");
+		title("orphan");
 
-	build_indexes();
+		if (cfg.local_hot_standby) {
+			say_info("starting local hot standby");
+			recover_follow(recovery_state, cfg.wal_dir_rescan_delay);
+			snprintf(status, sizeof(status), "hot_standby");
+			title("hot_standby");
+		}
+	}
 
-	title("orphan");
+	iproto_threads_init(cfg.iproto_threads, cfg.readahead);
+	iproto_set_inflight_limit(cfg.iproto_inflight_limit, box_op_is_write);
+	iproto_set_lazy_fibers(cfg.iproto_lazy_fibers, cfg.readahead);
 
-	if (cfg.local_hot_standby) {
-		say_info("starting local hot standby");
-		recover_follow(recovery_state, cfg.wal_dir_rescan_delay);
-		snprintf(status, sizeof(status), "hot_standby");
-		title("hot_standby");
+	/* A shard has no ports of its own: the router is its only client. */
+	if (shard_no >= 0) {
+		box_leave_local_standby_mode(NULL);
+		shard_init(&rw_callback);
+		return;
+	}
+
+	iproto_callback *primary_callback = &rw_callback;
+	iproto_callback *secondary_callback = &ro_callback;
+	void (*on_bind)(void *) = box_leave_local_standby_mode;
+
+	if (router) {
+		router_init();
+		primary_callback = &router_rw_callback;
+		secondary_callback = &router_ro_callback;
+		/* No WAL to write, nothing to expire or compact. */
+		on_bind = NULL;
 	}
 
 	/* run primary server */
 	if (cfg.primary_port != 0)
 		fiber_server("primary", cfg.primary_port,
 			     (fiber_server_callback) iproto_interact,
-			     &rw_callback, box_leave_local_standby_mode);
+			     primary_callback, on_bind);
 
 	/* run secondary server */
 	if (cfg.secondary_port != 0)
 		fiber_server("secondary", cfg.secondary_port,
 			     (fiber_server_callback) iproto_interact,
-			     &ro_callback, NULL);
+			     secondary_callback, NULL);
 
 	/* run memcached server */
 	if (cfg.memcached_port != 0)
@@ -1554,4 +1899,23 @@ mod_info(struct tbuf *out)
 	tbuf_printf(out, "  recovery_last_update: %.3f" CRLF,
 		    recovery_state->recovery_last_update_tstamp);
 	tbuf_printf(out, "  status: %s" CRLF, status);
+	replication_info(out);
+}
+
+void
+mod_slab_stat(struct tbuf *out)
+{
+	tbuf_printf(out, "  spaces:" CRLF);
+	for (int n = 0; n < BOX_SPACE_MAX; n++) {
+		struct space *sp = &space[n];
+
+		if (!sp->enabled)
+			continue;
+
+		tbuf_printf(out,
+			    "     - { space: %- 3i, tuples: %- 11zu, tuple_bytes: %- 12zu"
+			    ", index_bytes: %- 12zu, memory_limit: %zu }" CRLF,
+			    n, [sp->index[0] size], sp->tuple_bytes,
+			    space_index_memory(sp), sp->memory_limit);
+	}
 }
@@ -304,6 +304,28 @@ lbox_index_len(struct lua_State *L)
 	return 1;
 }
 
+/**
+ * Memory statistics of the space the index belongs to:
+ * { tuples = , tuple_bytes = , index_bytes = , memory_limit = }
+ */
+static int
+lbox_index_space_memory(struct lua_State *L)
+{
+	Index *index = lua_checkindex(L, 1);
+	struct space *sp = index->space;
+
+	lua_newtable(L);
+	lua_pushnumber(L, [sp->index[0] size]);
+	lua_setfield(L, -2, "tuples");
+	lua_pushnumber(L, sp->tuple_bytes);
+	lua_setfield(L, -2, "tuple_bytes");
+	lua_pushnumber(L, space_index_memory(sp));
+	lua_setfield(L, -2, "index_bytes");
+	lua_pushnumber(L, sp->memory_limit);
+	lua_setfield(L, -2, "memory_limit");
+	return 1;
+}
+
 static int
 lbox_index_min(struct lua_State *L)
 {
@@ -451,6 +473,7 @@ static const struct luaL_reg lbox_index_meta[] = {
 	{"min", lbox_index_min},
 	{"max", lbox_index_max},
 	{"next", lbox_index_next},
+	{"space_memory", lbox_index_space_memory},
 	{NULL, NULL}
 };
 
@@ -556,7 +579,7 @@ void iov_add_ret(struct lua_State *L, int index)
 		break;
 	}
 	tuple_txn_ref(in_txn(), tuple);
-	iov_add(&tuple->bsize, tuple_len(tuple));
+	tuple_to_iov(tuple, false);
 }
 
 /**
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2010, 2011 Mail.RU
+ * Copyright (C) 2010, 2011 Yuriy Vostrikov
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "compact.h"
+#include "box.h"
+#include "tuple.h"
+#include "index.h"
+#include "tarantool.h"
+#include "fiber.h"
+#include "cfg/tarantool_box_cfg.h"
+#include "say.h"
+#include "salloc.h"
+#include "tbuf.h"
+
+#include <string.h>
+
+static struct fiber *compact_fiber = NULL;
+
+/**
+ * Move the tuple out of an evacuated slab, unless somebody
+ * besides the space holds it: a request in progress, a Lua
+ * variable, or a WAL write.
+ *
+ * @return the new copy, or NULL if the tuple stayed in place
+ */
+static struct box_tuple *
+compact_tuple(struct space *sp, struct box_tuple *tuple)
+{
+	if (!salloc_evacuating(tuple) || tuple->refs != 1 ||
+	    tuple->flags & (WAL_WAIT | GHOST))
+		return NULL;
+
+	size_t size = sizeof(struct box_tuple) + tuple->bsize;
+	struct box_tuple *copy = salloc(size);
+	if (copy == NULL)
+		return NULL;
+	memcpy(copy, tuple, size);
+
+	for (Index **index = sp->index; *index != nil; index++)
+		if ((*index)->enabled)
+			[*index relocate: tuple :copy];
+
+	tuple_ref(tuple, -1);
+	return copy;
+}
+
+/** Primary key of the tuple, to resume a walk with. */
+static struct tbuf *
+compact_tuple_key(struct space *sp, struct box_tuple *tuple,
+		  struct key_def *key_def)
+{
+	struct tbuf *key = tbuf_alloc(fiber->gc_pool);
+
+	for (u32 i = 0; i < key_def->part_count; i++)
+		tbuf_append_field(key, space_tuple_field(sp, tuple,
+							 key_def->parts[i].fieldno));
+	return key;
+}
+
+static void
+compact_space(struct space *sp, int *visited, int *moved)
+{
+	Index *pk = sp->index[0];
+	struct iterator *it = [pk allocIterator];
+	struct box_tuple *tuple;
+
+	@try {
+		[pk initIterator: it];
+		tuple = it->next(it);
+		while (tuple != NULL) {
+			struct box_tuple *copy = compact_tuple(sp, tuple);
+			if (copy != NULL) {
+				tuple = copy;
+				(*moved)++;
+			}
+			if (++(*visited) % cfg.compact_per_loop != 0) {
+				tuple = it->next(it);
+				continue;
+			}
+			/*
+			 * Let the other fibers run. No iterator
+			 * survives changes of the index: a tree is
+			 * rebalanced, a hash is resized. The walk
+			 * resumes from the last visited key. Should
+			 * the key be gone by then, a hash walk ends
+			 * here, and the next pass picks up the rest.
+			 */
+			struct box_tuple *last = tuple;
+			struct tbuf *key = compact_tuple_key(sp, tuple, &pk->key_def);
+			fiber_sleep(0);
+			[pk initIterator: it :key->data :pk->key_def.part_count];
+			tuple = it->next(it);
+			if (tuple == last)
+				tuple = it->next(it);
+			fiber_gc();
+		}
+	} @finally {
+		it->free(it);
+	}
+}
+
+static void
+compact_loop(void *data __attribute__((unused)))
+{
+	say_info("compaction fiber started");
+	for (;;) {
+		fiber_sleep(cfg.compact_interval);
+
+		int marked = slab_evacuate_begin(cfg.compact_threshold);
+		if (marked == 0)
+			continue;
+
+		int visited = 0, moved = 0;
+		@try {
+			for (int n = 0; n < BOX_SPACE_MAX; n++)
+				if (space[n].enabled)
+					compact_space(&space[n], &visited, &moved);
+		} @finally {
+			int left = slab_evacuate_end();
+			say_info("compaction: moved %i of %i tuples, "
+				 "released %i of %i slabs",
+				 moved, visited, marked - left, marked);
+		}
+	}
+}
+
+/** A size class ran out of slabs: don't wait for the next pass. */
+static void
+compact_wakeup(void)
+{
+	fiber_wakeup(compact_fiber);
+}
+
+void
+compact_start()
+{
+	if (cfg.compact_threshold == 0 || compact_fiber != NULL)
+		return;
+
+	compact_fiber = fiber_create("compact", -1, -1, compact_loop, NULL);
+	if (compact_fiber == NULL) {
+		say_error("can't start the compaction fiber");
+		return;
+	}
+	salloc_on_shortage = compact_wakeup;
+	fiber_call(compact_fiber);
+}
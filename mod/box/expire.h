@@ -0,0 +1,92 @@
+#ifndef TARANTOOL_BOX_EXPIRE_H_INCLUDED
+#define TARANTOOL_BOX_EXPIRE_H_INCLUDED
+/*
+ * Copyright (C) 2010, 2011 Mail.RU
+ * Copyright (C) 2010, 2011 Yuriy Vostrikov
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <util.h>
+
+/*
+ * Expiration index. An expire ring keeps <exptime, key> entries,
+ * the key being a BER-prefixed field, in a ring of one-second
+ * buckets: an entry sits in the bucket of its second, modulo the
+ * ring size. Once a second has passed, its bucket is emptied, the
+ * entries due are handed to the owner and those due on a later
+ * turn of the ring are put back. So only keys which are due get
+ * visited. An entry is only a hint: the key may since have been
+ * deleted or stored anew, so the owner checks it.
+ */
+
+enum { EXPIRE_BUCKETS = 4096 };
+
+struct expire_bucket {
+	void *data;
+	size_t size;
+	size_t capacity;
+};
+
+struct expire_ring {
+	struct expire_bucket bucket[EXPIRE_BUCKETS];
+	/** The next second to expire keys for. */
+	u32 next;
+};
+
+/** Schedule the key to expire at exptime. */
+void
+expire_ring_add(struct expire_ring *ring, u32 exptime, void *key);
+
+/**
+ * Call due() for every entry which expires before now. due() may
+ * yield, and entries may be added meanwhile.
+ */
+void
+expire_ring_run(struct expire_ring *ring, u32 now,
+		void (*due)(void *key, u32 exptime, void *arg), void *arg);
+
+/** Drop all entries. */
+void
+expire_ring_clear(struct expire_ring *ring);
+
+/*
+ * Tuple expiration of spaces with expire_field set: the field
+ * holds the time the tuple expires at. Every tuple put into such
+ * a space gets an entry in the expire ring of the space, and a
+ * background fiber deletes due tuples. Deletes go in batches of
+ * expire_per_loop, the WAL writes of a batch in flight together,
+ * and no faster than expire_rate_limit tuples a second.
+ */
+
+struct space;
+struct box_tuple;
+
+/** Schedule the tuple of a space with expire_field to expire. */
+void
+space_expire_add(struct space *sp, struct box_tuple *tuple);
+
+/** Start the expiration fiber if a space has expire_field set. */
+void
+space_expire_start();
+
+#endif /* TARANTOOL_BOX_EXPIRE_H_INCLUDED */
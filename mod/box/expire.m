@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2010, 2011 Mail.RU
+ * Copyright (C) 2010, 2011 Yuriy Vostrikov
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "expire.h"
+#include "box.h"
+#include "tuple.h"
+#include "index.h"
+#include "tarantool.h"
+#include "fiber.h"
+#include "log_io.h"
+#include "cfg/tarantool_box_cfg.h"
+#include "say.h"
+#include "stat.h"
+#include "pickle.h"
+#include "tbuf.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void
+expire_bucket_add(struct expire_bucket *bucket, u32 exptime, void *key)
+{
+	void *k = key;
+	u32 key_len = load_varint32(&k);
+	size_t size = sizeof(exptime) + (k - key) + key_len;
+
+	if (bucket->size + size > bucket->capacity) {
+		size_t capacity = MAX(bucket->capacity * 2, bucket->size + size);
+		void *data = realloc(bucket->data, capacity);
+		if (data == NULL) {
+			say_error("can't allocate %"PRI_SZ" bytes for "
+				  "the expiration index", capacity);
+			return;
+		}
+		bucket->data = data;
+		bucket->capacity = capacity;
+	}
+	memcpy(bucket->data + bucket->size, &exptime, sizeof(exptime));
+	memcpy(bucket->data + bucket->size + sizeof(exptime), key,
+	       size - sizeof(exptime));
+	bucket->size += size;
+}
+
+void
+expire_ring_add(struct expire_ring *ring, u32 exptime, void *key)
+{
+	/* Already due keys go to the bucket checked next. */
+	u32 second = exptime < ring->next ? ring->next : exptime;
+
+	expire_bucket_add(&ring->bucket[second % EXPIRE_BUCKETS], exptime, key);
+}
+
+void
+expire_ring_run(struct expire_ring *ring, u32 now,
+		void (*due)(void *key, u32 exptime, void *arg), void *arg)
+{
+	/* Each bucket is checked once per turn of the ring. */
+	if (now - ring->next > EXPIRE_BUCKETS)
+		ring->next = now - EXPIRE_BUCKETS;
+
+	/* A key expires once its exptime is in the past. */
+	while (ring->next < now) {
+		/* Keys added while due() yields go to the next bucket. */
+		u32 second = ring->next++;
+		struct expire_bucket *bucket = &ring->bucket[second % EXPIRE_BUCKETS];
+		struct expire_bucket taken = *bucket;
+		memset(bucket, 0, sizeof(*bucket));
+
+		@try {
+			void *p = taken.data;
+
+			while (p < taken.data + taken.size) {
+				u32 exptime;
+				memcpy(&exptime, p, sizeof(exptime));
+				void *key = p + sizeof(exptime);
+				p = key;
+				u32 key_len = load_varint32(&p);
+				p += key_len;
+
+				if (exptime > second) {
+					/* Due on one of the next turns. */
+					expire_bucket_add(bucket, exptime, key);
+					continue;
+				}
+				due(key, exptime, arg);
+			}
+		} @finally {
+			free(taken.data);
+		}
+	}
+}
+
+void
+expire_ring_clear(struct expire_ring *ring)
+{
+	for (int i = 0; i < EXPIRE_BUCKETS; i++) {
+		free(ring->bucket[i].data);
+		memset(&ring->bucket[i], 0, sizeof(ring->bucket[i]));
+	}
+}
+
+#define STAT(_)					\
+	_(EXPIRED_TUPLES, 0)
+
+ENUM(expire_stat, STAT);
+STRS(expire_stat, STAT);
+
+static int stat_base;
+static struct fiber *expire_fiber = NULL;
+
+/* Deletes in flight and the fiber waiting for them to end. */
+enum { EXPIRE_WRITES_MAX = 64 };
+static int expire_writes;
+static int expire_writes_wait_count;
+static struct fiber *expire_waiter;
+
+struct expire_batch {
+	struct space *sp;
+	int count;
+};
+
+/** The expiration time in the tuple, 0 if none. */
+static u32
+tuple_exptime(struct space *sp, struct box_tuple *tuple)
+{
+	if (sp->expire_field >= tuple->cardinality)
+		return 0;
+
+	void *field = space_tuple_field(sp, tuple, sp->expire_field);
+	u32 len = load_varint32(&field);
+	if (len != sizeof(u32))
+		return 0;
+
+	return *(u32 *)field;
+}
+
+void
+space_expire_add(struct space *sp, struct box_tuple *tuple)
+{
+	u32 exptime = tuple_exptime(sp, tuple);
+	if (exptime == 0)
+		return;
+
+	void *key = space_tuple_field(sp, tuple,
+				      sp->index[0]->key_def.parts[0].fieldno);
+	if (key != NULL)
+		expire_ring_add(sp->expire, exptime, key);
+}
+
+/** Wait until no more than count deletes are in flight. */
+static void
+expire_writes_wait(int count)
+{
+	while (expire_writes > count) {
+		expire_waiter = fiber;
+		expire_writes_wait_count = count;
+		fiber_yield();
+		expire_waiter = NULL;
+	}
+}
+
+static void
+expire_delete(void *data)
+{
+	struct tbuf *req = data;
+
+	@try {
+		struct box_txn *txn = txn_begin();
+		txn->out = &box_out_quiet;
+		rw_callback(DELETE, req);
+		stat_collect(stat_base, EXPIRED_TUPLES, 1);
+	}
+	@catch (ClientError *e) {
+		say_warn("can't delete an expired tuple: %s", e->errmsg);
+	}
+	@finally {
+		expire_writes--;
+		if (expire_waiter != NULL &&
+		    expire_writes <= expire_writes_wait_count)
+			fiber_wakeup(expire_waiter);
+	}
+}
+
+/** Let the batch's deletes end and keep to expire_rate_limit. */
+static void
+expire_batch_end(struct expire_batch *batch)
+{
+	expire_writes_wait(0);
+	fiber_gc();
+	if (batch->count > 0 && cfg.expire_rate_limit > 0)
+		fiber_sleep((double) batch->count / cfg.expire_rate_limit);
+	batch->count = 0;
+}
+
+static void
+space_expire_due(void *key, u32 exptime, void *arg)
+{
+	struct expire_batch *batch = arg;
+	struct space *sp = batch->sp;
+
+	struct box_tuple *tuple = [sp->index[0] find: key];
+	if (tuple == NULL || tuple->flags & GHOST ||
+	    tuple_exptime(sp, tuple) != exptime)
+		return;
+
+	/*
+	 * A replica gets the deletes of the master, but keeps the
+	 * entry of a live tuple in case it's promoted.
+	 */
+	if (cfg.replication_source != NULL) {
+		expire_ring_add(sp->expire, exptime, key);
+		return;
+	}
+
+	u32 flags = 0;
+	u32 key_cardinality = 1;
+	struct tbuf *req = tbuf_alloc(fiber->gc_pool);
+	tbuf_append(req, &sp->n, sizeof(u32));
+	tbuf_append(req, &flags, sizeof(flags));
+	tbuf_append(req, &key_cardinality, sizeof(key_cardinality));
+	tbuf_append_field(req, key);
+
+	/* Leave room in the WAL writer inbox for the clients. */
+	int writes_max = MIN(EXPIRE_WRITES_MAX,
+			     (int) recovery_state->wal_writer->out->inbox->size / 2);
+	expire_writes_wait(writes_max > 1 ? writes_max - 1 : 0);
+
+	struct fiber *f = fiber_create("expire_delete", -1, -1,
+				       expire_delete, req);
+	if (f == NULL) {
+		say_error("can't start a fiber to delete an expired tuple");
+		return;
+	}
+	expire_writes++;
+	fiber_call(f);
+
+	if (++batch->count == cfg.expire_per_loop)
+		expire_batch_end(batch);
+}
+
+static void
+space_expire_loop(void *data __attribute__((unused)))
+{
+	say_info("expire fiber started");
+	for (;;) {
+		u32 now = ev_now();
+
+		for (int n = 0; n < BOX_SPACE_MAX; n++) {
+			struct space *sp = &space[n];
+			if (!sp->enabled || sp->expire == NULL)
+				continue;
+
+			struct expire_batch batch = { .sp = sp, .count = 0 };
+			expire_ring_run(sp->expire, now, space_expire_due, &batch);
+			expire_batch_end(&batch);
+		}
+		fiber_sleep(1);
+	}
+}
+
+void
+space_expire_start()
+{
+	bool enabled = false;
+
+	for (int n = 0; n < BOX_SPACE_MAX; n++)
+		if (space[n].enabled && space[n].expire != NULL)
+			enabled = true;
+
+	if (!enabled || expire_fiber != NULL)
+		return;
+
+	stat_base = stat_register(expire_stat_strs, expire_stat_MAX);
+
+	expire_fiber = fiber_create("expire", -1, -1, space_expire_loop, NULL);
+	if (expire_fiber == NULL) {
+		say_error("can't start the expire fiber");
+		return;
+	}
+	fiber_call(expire_fiber);
+}
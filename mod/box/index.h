@@ -108,12 +108,19 @@ struct key_def {
  */
 - (void) enable;
 - (size_t) size;
+/** Memory taken by the index structure, in bytes. */
+- (size_t) memsize;
 - (struct box_tuple *) min;
 - (struct box_tuple *) max;
 - (struct box_tuple *) find: (void *) key_arg; /* only for unique lookups */
 - (struct box_tuple *) findByTuple: (struct box_tuple *) tuple;
 - (void) remove: (struct box_tuple *) tuple;
 - (void) replace: (struct box_tuple *) old_tuple :(struct box_tuple *) new_tuple;
+/**
+ * Replace a tuple with its copy at another address, made by
+ * slab compaction. The keys of both tuples are the same.
+ */
+- (void) relocate: (struct box_tuple *) old_tuple :(struct box_tuple *) new_tuple;
 /**
  * Create a structure to represent an iterator. Must be
  * initialized separately.
@@ -115,6 +115,12 @@ iterator_first_equal(struct iterator *it)
 	return 0;
 }
 
+- (size_t) memsize
+{
+	[self subclassResponsibility: _cmd];
+	return 0;
+}
+
 - (struct box_tuple *) min
 {
 	[self subclassResponsibility: _cmd];
@@ -155,6 +161,12 @@ iterator_first_equal(struct iterator *it)
 	[self subclassResponsibility: _cmd];
 }
 
+- (void) relocate: (struct box_tuple *) old_tuple
+	:(struct box_tuple *) new_tuple
+{
+	[self replace: old_tuple :new_tuple];
+}
+
 - (struct iterator *) allocIterator
 {
 	[self subclassResponsibility: _cmd];
@@ -196,6 +208,16 @@ hash_iterator(struct iterator *it)
 	return (struct hash_iterator *) it;
 }
 
+/** Memory taken by a hash table, with the one it is resized to. */
+#define hash_memsize(h) ({						\
+	size_t size = (h)->n_buckets * sizeof(*(h)->p) +		\
+		(h)->n_buckets / 16 * sizeof(*(h)->b);			\
+	if ((h)->resize_position > 0)					\
+		size += (h)->shadow->n_buckets * sizeof(*(h)->p) +	\
+			(h)->shadow->n_buckets / 16 * sizeof(*(h)->b);	\
+	size;								\
+})
+
 struct box_tuple *
 hash_iterator_next(struct iterator *iterator)
 {
@@ -240,7 +262,7 @@ hash_iterator_free(struct iterator *iterator)
 - (struct box_tuple *) findByTuple: (struct box_tuple *) tuple
 {
 	/* Hash index currently is always single-part. */
-	void *field = tuple_field(tuple, key_def.parts[0].fieldno);
+	void *field = space_tuple_field(space, tuple, key_def.parts[0].fieldno);
 	if (field == NULL)
 		tnt_raise(ClientError, :ER_NO_SUCH_FIELD, key_def.parts[0].fieldno);
 	return [self find: field];
@@ -285,6 +307,11 @@ hash_iterator_free(struct iterator *iterator)
 	return mh_size(int_hash);
 }
 
+- (size_t) memsize
+{
+	return hash_memsize(int_hash);
+}
+
 - (struct box_tuple *) find: (void *) field
 {
 	struct box_tuple *ret = NULL;
@@ -305,7 +332,7 @@ hash_iterator_free(struct iterator *iterator)
 
 - (void) remove: (struct box_tuple *) tuple
 {
-	void *field = tuple_field(tuple, key_def.parts[0].fieldno);
+	void *field = space_tuple_field(space, tuple, key_def.parts[0].fieldno);
 	unsigned int field_size = load_varint32(&field);
 	u32 num = *(u32 *)field;
 
@@ -323,7 +350,7 @@ hash_iterator_free(struct iterator *iterator)
 - (void) replace: (struct box_tuple *) old_tuple
 	:(struct box_tuple *) new_tuple
 {
-	void *field = tuple_field(new_tuple, key_def.parts[0].fieldno);
+	void *field = space_tuple_field(space, new_tuple, key_def.parts[0].fieldno);
 	u32 field_size = load_varint32(&field);
 	u32 num = *(u32 *)field;
 
@@ -331,7 +358,7 @@ hash_iterator_free(struct iterator *iterator)
 		tnt_raise(IllegalParams, :"key is not u32");
 
 	if (old_tuple != NULL) {
-		void *old_field = tuple_field(old_tuple, key_def.parts[0].fieldno);
+		void *old_field = space_tuple_field(space, old_tuple, key_def.parts[0].fieldno);
 		load_varint32(&old_field);
 		u32 old_num = *(u32 *)old_field;
 		mh_int_t k = mh_i32ptr_get(int_hash, old_num);
@@ -406,6 +433,11 @@ hash_iterator_free(struct iterator *iterator)
 	return mh_size(int64_hash);
 }
 
+- (size_t) memsize
+{
+	return hash_memsize(int64_hash);
+}
+
 - (struct box_tuple *) find: (void *) field
 {
 	struct box_tuple *ret = NULL;
@@ -426,7 +458,7 @@ hash_iterator_free(struct iterator *iterator)
 
 - (void) remove: (struct box_tuple *) tuple
 {
-	void *field = tuple_field(tuple, key_def.parts[0].fieldno);
+	void *field = space_tuple_field(space, tuple, key_def.parts[0].fieldno);
 	unsigned int field_size = load_varint32(&field);
 	u64 num = *(u64 *)field;
 
@@ -444,7 +476,7 @@ hash_iterator_free(struct iterator *iterator)
 - (void) replace: (struct box_tuple *) old_tuple
 	:(struct box_tuple *) new_tuple
 {
-	void *field = tuple_field(new_tuple, key_def.parts[0].fieldno);
+	void *field = space_tuple_field(space, new_tuple, key_def.parts[0].fieldno);
 	u32 field_size = load_varint32(&field);
 	u64 num = *(u64 *)field;
 
@@ -452,8 +484,8 @@ hash_iterator_free(struct iterator *iterator)
 		tnt_raise(IllegalParams, :"key is not u64");
 
 	if (old_tuple != NULL) {
-		void *old_field = tuple_field(old_tuple,
-					      key_def.parts[0].fieldno);
+		void *old_field = space_tuple_field(space, old_tuple,
+						    key_def.parts[0].fieldno);
 		load_varint32(&old_field);
 		u64 old_num = *(u64 *)old_field;
 		mh_int_t k = mh_i64ptr_get(int64_hash, old_num);
@@ -528,6 +560,11 @@ hash_iterator_free(struct iterator *iterator)
 	return mh_size(str_hash);
 }
 
+- (size_t) memsize
+{
+	return hash_memsize(str_hash);
+}
+
 - (struct box_tuple *) find: (void *) field
 {
 	struct box_tuple *ret = NULL;
@@ -545,7 +582,7 @@ hash_iterator_free(struct iterator *iterator)
 
 - (void) remove: (struct box_tuple *) tuple
 {
-	void *field = tuple_field(tuple, key_def.parts[0].fieldno);
+	void *field = space_tuple_field(space, tuple, key_def.parts[0].fieldno);
 
 	mh_int_t k = mh_lstrptr_get(str_hash, field);
 	if (k != mh_end(str_hash))
@@ -560,15 +597,15 @@ hash_iterator_free(struct iterator *iterator)
 - (void) replace: (struct box_tuple *) old_tuple
 	:(struct box_tuple *) new_tuple
 {
-	void *field = tuple_field(new_tuple, key_def.parts[0].fieldno);
+	void *field = space_tuple_field(space, new_tuple, key_def.parts[0].fieldno);
 
 	if (field == NULL)
 		tnt_raise(ClientError, :ER_NO_SUCH_FIELD,
 			  key_def.parts[0].fieldno);
 
 	if (old_tuple != NULL) {
-		void *old_field = tuple_field(old_tuple,
-					      key_def.parts[0].fieldno);
+		void *old_field = space_tuple_field(space, old_tuple,
+						    key_def.parts[0].fieldno);
 		mh_int_t k = mh_lstrptr_get(str_hash, old_field);
 		if (k != mh_end(str_hash))
 			mh_lstrptr_del(str_hash, k);
@@ -695,9 +732,27 @@ struct tree_el {
 	(sizeof(struct tree_el) + sizeof(struct field) * (key)->part_count)
 
 void
-tree_el_init(struct tree_el *elem,
+tree_el_init(struct tree_el *elem, struct space *sp,
 		   struct key_def *key_def, struct box_tuple *tuple)
 {
+	if (sp->field_offset != NULL) {
+		/*
+		 * Key fields of a space with field_types are at known
+		 * offsets, and their types are checked on config.
+		 */
+		for (u32 i = 0; i < key_def->part_count; ++i) {
+			void *data = tuple->data +
+				sp->field_offset[key_def->parts[i].fieldno];
+			struct field *f = &elem->key[i];
+
+			f->len = load_varint32(&data);
+			memset(f->data, 0, sizeof(f->data));
+			memcpy(f->data, data, f->len);
+		}
+		elem->tuple = tuple;
+		return;
+	}
+
 	void *tuple_data = tuple->data;
 
 	for (i32 i = 0; i < key_def->max_fieldno; ++i) {
@@ -889,6 +944,11 @@ tree_iterator_next_equal(struct iterator *iterator)
 	return tree->size;
 }
 
+- (size_t) memsize
+{
+	return tree->ntotal * (tree->elemsize + sizeof(sptree_node_pointers));
+}
+
 - (struct box_tuple *) min
 {
 	struct tree_el *elem = sptree_str_t_first(tree);
@@ -913,7 +973,7 @@ tree_iterator_next_equal(struct iterator *iterator)
 
 - (struct box_tuple *) findByTuple: (struct box_tuple *) tuple
 {
-	tree_el_init(pattern, &key_def, tuple);
+	tree_el_init(pattern, space, &key_def, tuple);
 
 	struct tree_el *elem = sptree_str_t_find(tree, pattern);
 
@@ -922,7 +982,7 @@ tree_iterator_next_equal(struct iterator *iterator)
 
 - (void) remove: (struct box_tuple *) tuple
 {
-	tree_el_init(pattern, &key_def, tuple);
+	tree_el_init(pattern, space, &key_def, tuple);
 	sptree_str_t_delete(tree, pattern);
 }
 
@@ -934,13 +994,31 @@ tree_iterator_next_equal(struct iterator *iterator)
 			  key_def.max_fieldno);
 
 	if (old_tuple) {
-		tree_el_init(pattern, &key_def, old_tuple);
+		tree_el_init(pattern, space, &key_def, old_tuple);
 		sptree_str_t_delete(tree, pattern);
 	}
-	tree_el_init(pattern, &key_def, new_tuple);
+	tree_el_init(pattern, space, &key_def, new_tuple);
 	sptree_str_t_insert(tree, pattern);
 }
 
+- (void) relocate: (struct box_tuple *) old_tuple
+	:(struct box_tuple *) new_tuple
+{
+	/*
+	 * Elements of a non-unique tree are ordered by tuple
+	 * address among equal keys, so only a unique tree can
+	 * be updated in place.
+	 */
+	if (!key_def.is_unique) {
+		[self replace: old_tuple :new_tuple];
+		return;
+	}
+	tree_el_init(pattern, space, &key_def, old_tuple);
+	struct tree_el *elem = sptree_str_t_find(tree, pattern);
+	assert(elem != NULL && elem->tuple == old_tuple);
+	tree_el_init(elem, space, &key_def, new_tuple);
+}
+
 - (struct iterator *) allocIterator
 {
 	struct tree_iterator *it = salloc(sizeof(struct tree_iterator) +
@@ -1006,7 +1084,7 @@ tree_iterator_next_equal(struct iterator *iterator)
 		m = (struct tree_el *)
 			((char *)elem + i * TREE_EL_SIZE(&key_def));
 
-		tree_el_init(m, &key_def, tuple);
+		tree_el_init(m, space, &key_def, tuple);
 		++i;
 	}
 
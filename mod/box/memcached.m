@@ -23,6 +23,9 @@
  * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+#include <endian.h>
+#include <arpa/inet.h>
+
 #include "tarantool.h"
 #include "box.h"
 #include "mod/box/tuple.h"
@@ -33,12 +36,14 @@
 #include "stat.h"
 #include "salloc.h"
 #include "pickle.h"
+#include "expire.h"
 
 #define STAT(_)					\
         _(MEMC_GET, 1)				\
         _(MEMC_GET_MISS, 2)			\
 	_(MEMC_GET_HIT, 3)			\
-	_(MEMC_EXPIRED_KEYS, 4)
+	_(MEMC_EXPIRED_KEYS, 4)			\
+	_(MEMC_EVICTIONS, 5)
 
 ENUM(memcached_stat, STAT);
 STRS(memcached_stat, STAT);
@@ -48,6 +53,10 @@ static struct fiber *memcached_expire = NULL;
 
 static Index *memcached_index;
 static struct iterator *memcached_it;
+/** The hand of the eviction clock. */
+static struct iterator *memcached_clock;
+/** Keeps memcached_space below its memory_limit, see memcached_make_room(). */
+static struct fiber *memcached_evictor;
 
 /* memcached tuple format:
    <key, meta, data> */
@@ -67,6 +76,15 @@ natoq(const u8 *start, const u8 *end)
 	return num;
 }
 
+/*
+ * Keys stored with an expiration time, see expire.h. An entry is
+ * checked against the tuple meta before the key is deleted.
+ */
+static struct expire_ring memcached_ring;
+
+static void memcached_make_room(void *key, size_t size);
+static struct box_tuple *find(void *key);
+
 static void
 store(void *key, u32 exptime, u32 flags, u32 bytes, u8 *data)
 {
@@ -97,6 +115,13 @@ store(void *key, u32 exptime, u32 flags, u32 bytes, u8 *data)
 	write_varint32(req, bytes);
 	tbuf_append(req, data, bytes);
 
+	if (cfg.memcached_eviction) {
+		/* The tuple takes the request less its header. */
+		memcached_make_room(key, sizeof(struct box_tuple) +
+				    req->size - 3 * sizeof(u32));
+	}
+
+	void *field = key;
 	int key_len = load_varint32(&key);
 	say_debug("memcached/store key:(%i)'%.*s' exptime:%"PRIu32" flags:%"PRIu32" cas:%"PRIu64,
 		  key_len, key_len, (u8 *)key, exptime, flags, cas);
@@ -108,6 +133,14 @@ store(void *key, u32 exptime, u32 flags, u32 bytes, u8 *data)
 	 * read-only/read-write modes.
 	 */
 	rw_callback(REPLACE, req);
+
+	if (memcached_expire != NULL && exptime != 0)
+		expire_ring_add(&memcached_ring, exptime, field);
+
+	/* A new entry starts as recently used. */
+	struct box_tuple *tuple = find(field);
+	if (tuple != NULL)
+		tuple->flags |= ACCESSED;
 }
 
 static void
@@ -257,6 +290,7 @@ void memcached_get(struct box_txn *txn, size_t keys_count, struct tbuf *keys,
 		}
 		stats.get_hits++;
 		stat_collect(stat_base, MEMC_GET_HIT, 1);
+		tuple->flags |= ACCESSED;
 
 		tuple_txn_ref(txn, tuple);
 
@@ -288,10 +322,134 @@ flush_all(void *data)
 	[memcached_index initIterator: it];
 	while ((tuple = it->next(it))) {
 	       meta(tuple)->exptime = 1;
+	       if (memcached_expire != NULL)
+		       expire_ring_add(&memcached_ring, 1, tuple->data);
 	}
 	it->free(it);
 }
 
+/**
+ * Whether size more bytes would take memcached_space over its
+ * memory_limit.
+ */
+static bool
+memcached_space_full(size_t size)
+{
+	struct space *sp = &space[cfg.memcached_space];
+
+	return sp->memory_limit != 0 &&
+		sp->tuple_bytes + space_index_memory(sp) + size > sp->memory_limit;
+}
+
+/**
+ * Move the eviction clock hand to the next idle entry of the
+ * given slab item size, or of any size if item_size is 0. The
+ * hand sweeps the space the way CLOCK does: an entry read since
+ * the previous turn loses its ACCESSED bit and stays. Gives up,
+ * returning NULL, after the given number of steps.
+ */
+static struct box_tuple *
+memcached_clock_next(struct box_tuple *keep, size_t item_size, size_t *steps)
+{
+	while (*steps > 0) {
+		(*steps)--;
+		struct box_tuple *tuple = memcached_clock->next(memcached_clock);
+
+		if (tuple == NULL) {
+			[memcached_index initIterator: memcached_clock];
+			continue;
+		}
+		if (tuple == keep || tuple->flags & (WAL_WAIT | GHOST) ||
+		    (item_size != 0 && salloc_size(tuple) != item_size))
+			continue;
+		if (tuple->flags & ACCESSED) {
+			tuple->flags &= ~ACCESSED;
+			continue;
+		}
+		return tuple;
+	}
+	return NULL;
+}
+
+/** Delete an entry to make room. Written to the WAL as usual. */
+static void
+memcached_evict(struct box_tuple *tuple)
+{
+	struct tbuf *victim = tbuf_alloc(fiber->gc_pool);
+	tbuf_append_field(victim, tuple->data);
+	say_debug("evict tuple %p", tuple);
+	delete(victim->data);
+	stats.evictions++;
+	stat_collect(stat_base, MEMC_EVICTIONS, 1);
+}
+
+/**
+ * The evictor fiber: once woken up, evict idle entries until
+ * 1/16 of the memory_limit of the space is free again, so that
+ * a store seldom has to wait for an eviction of its own.
+ */
+static void
+memcached_evict_loop(void *data __attribute__((unused)))
+{
+	for (;;) {
+		fiber_yield();
+
+		size_t headroom = space[cfg.memcached_space].memory_limit / 16;
+		/* Two turns clear every bit; give up if nothing fits then. */
+		size_t steps = 2 * [memcached_index size] + 1;
+		@try {
+			while (memcached_space_full(headroom)) {
+				struct box_tuple *tuple =
+					memcached_clock_next(NULL, 0, &steps);
+				if (tuple == NULL)
+					break;
+				memcached_evict(tuple);
+			}
+		}
+		@catch (ClientError *e) {
+			/* A replica doesn't evict. The error is already logged. */
+		}
+		fiber_gc();
+	}
+}
+
+/**
+ * Evict entries until a tuple of the given size fits into the
+ * slab arena and into the memory_limit of the space. For the
+ * arena, only the entries of the same slab class as the new
+ * tuple are considered: freeing any other would not make room.
+ * Against memory_limit, any entry will do. Most of the room for
+ * the limit is made in advance by the evictor fiber; this only
+ * evicts when it has fallen behind.
+ */
+static void
+memcached_make_room(void *key, size_t size)
+{
+	size_t item_size = salloc_class_size(size);
+	if (item_size == 0)
+		return;
+
+	struct box_tuple *keep = find(key);
+	/* Two turns clear every bit; give up if nothing fits then. */
+	size_t steps = 2 * [memcached_index size] + 1;
+
+	for (;;) {
+		bool arena_full = !salloc_has_room(size);
+		if (!arena_full && !memcached_space_full(item_size))
+			break;
+
+		struct box_tuple *tuple =
+			memcached_clock_next(keep, arena_full ? item_size : 0, &steps);
+		if (tuple == NULL)
+			break;
+		memcached_evict(tuple);
+	}
+
+	struct space *sp = &space[cfg.memcached_space];
+	if (memcached_evictor != NULL && memcached_space_full(sp->memory_limit / 16))
+		fiber_wakeup(memcached_evictor);
+}
+
 #define STORE									\
 do {										\
 	stats.cmd_set++;							\
@@ -313,6 +471,368 @@ do {										\
 
 #include "memcached-grammar.m"
 
+/*
+ * Binary protocol. A request starting with the binary request
+ * magic, which can't start a text command, is handled here, so
+ * both protocols share memcached_port.
+ */
+
+enum {
+	MC_BIN_REQUEST = 0x80,
+	MC_BIN_RESPONSE = 0x81,
+};
+
+enum mc_bin_opcode {
+	MC_GET = 0x00,
+	MC_SET = 0x01,
+	MC_ADD = 0x02,
+	MC_REPLACE = 0x03,
+	MC_DELETE = 0x04,
+	MC_INCREMENT = 0x05,
+	MC_DECREMENT = 0x06,
+	MC_QUIT = 0x07,
+	MC_FLUSH = 0x08,
+	MC_GETQ = 0x09,
+	MC_NOOP = 0x0a,
+	MC_VERSION = 0x0b,
+	MC_GETK = 0x0c,
+	MC_GETKQ = 0x0d,
+	MC_SETQ = 0x11,
+	MC_ADDQ = 0x12,
+	MC_REPLACEQ = 0x13,
+	MC_DELETEQ = 0x14,
+	MC_INCREMENTQ = 0x15,
+	MC_DECREMENTQ = 0x16,
+	MC_QUITQ = 0x17,
+	MC_FLUSHQ = 0x18,
+};
+
+enum mc_bin_status {
+	MC_OK = 0x00,
+	MC_KEY_ENOENT = 0x01,
+	MC_KEY_EEXISTS = 0x02,
+	MC_E2BIG = 0x03,
+	MC_EINVAL = 0x04,
+	MC_NOT_STORED = 0x05,
+	MC_DELTA_BADVAL = 0x06,
+	MC_UNKNOWN_COMMAND = 0x81,
+	MC_ENOMEM = 0x82,
+	MC_EINTERNAL = 0x84,
+};
+
+/** Request and response header, in network byte order. */
+struct mc_bin_header {
+	u8 magic;
+	u8 opcode;
+	u16 key_len;
+	u8 ext_len;
+	u8 data_type;
+	/* vbucket id in a request, status in a response */
+	u16 status;
+	u32 body_len;
+	u32 opaque;
+	u64 cas;
+} __packed__;
+
+/** Quiet commands don't reply on success (on a miss for gets). */
+static bool
+mc_bin_quiet(u8 opcode)
+{
+	switch (opcode) {
+	case MC_GETQ: case MC_GETKQ: case MC_SETQ: case MC_ADDQ:
+	case MC_REPLACEQ: case MC_DELETEQ: case MC_INCREMENTQ:
+	case MC_DECREMENTQ: case MC_QUITQ: case MC_FLUSHQ:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/** All the parts must stay valid until the output is flushed. */
+static void
+mc_bin_reply(struct mc_bin_header *req, u16 status, void *ext, u8 ext_len,
+	     void *key, u16 key_len, void *value, u32 value_len, u64 cas)
+{
+	struct mc_bin_header *h = palloc(fiber->gc_pool, sizeof(*h));
+
+	h->magic = MC_BIN_RESPONSE;
+	h->opcode = req->opcode;
+	h->key_len = htons(key_len);
+	h->ext_len = ext_len;
+	h->data_type = 0;
+	h->status = htons(status);
+	h->body_len = htonl(ext_len + key_len + value_len);
+	h->opaque = req->opaque;
+	h->cas = htobe64(cas);
+
+	iov_ensure(4);
+	iov_add_unsafe(h, sizeof(*h));
+	if (ext_len > 0)
+		iov_add_unsafe(ext, ext_len);
+	if (key_len > 0)
+		iov_add_unsafe(key, key_len);
+	if (value_len > 0)
+		iov_add_unsafe(value, value_len);
+}
+
+static void
+mc_bin_error(struct mc_bin_header *req, u16 status, const char *msg)
+{
+	size_t len = strlen(msg);
+	void *copy = palloc(fiber->gc_pool, len);
+	memcpy(copy, msg, len);
+	mc_bin_reply(req, status, NULL, 0, NULL, 0, copy, len, 0);
+}
+
+static u32
+mc_bin_exptime(u32 exptime)
+{
+	if (exptime > 0 && exptime <= 60*60*24*30)
+		exptime = exptime + ev_now();
+	return exptime;
+}
+
+static void
+mc_bin_get(struct mc_bin_header *req, void *key)
+{
+	stats.cmd_get++;
+	stat_collect(stat_base, MEMC_GET, 1);
+
+	struct box_tuple *tuple = find(key);
+	if (tuple == NULL || tuple->flags & GHOST || expired(tuple)) {
+		stats.get_misses++;
+		stat_collect(stat_base, MEMC_GET_MISS, 1);
+		if (!mc_bin_quiet(req->opcode))
+			mc_bin_error(req, MC_KEY_ENOENT, "Not found");
+		return;
+	}
+	stats.get_hits++;
+	stat_collect(stat_base, MEMC_GET_HIT, 1);
+	tuple->flags |= ACCESSED;
+
+	/* Keep the tuple alive until the reply is written. */
+	struct box_txn *txn = txn_begin();
+	txn->flags |= BOX_GC_TXN;
+	txn->out = &box_out_quiet;
+	txn->op = SELECT;
+	tuple_txn_ref(txn, tuple);
+	txn_commit(txn);
+
+	struct meta *m = meta(tuple);
+	u32 *flags = palloc(fiber->gc_pool, sizeof(u32));
+	*flags = htonl(m->flags);
+	void *value = tuple_field(tuple, 3);
+	u32 value_len = load_varint32(&value);
+
+	void *k = key;
+	u32 key_len = 0;
+	if (req->opcode == MC_GETK || req->opcode == MC_GETKQ)
+		key_len = load_varint32(&k);
+
+	mc_bin_reply(req, MC_OK, flags, sizeof(*flags), k, key_len,
+		     value, value_len, m->cas);
+}
+
+static void
+mc_bin_store(struct mc_bin_header *req, void *key, u8 *ext,
+	     u8 *value, u32 value_len)
+{
+	stats.cmd_set++;
+	if (req->ext_len != 8) {
+		mc_bin_error(req, MC_EINVAL, "Invalid arguments");
+		return;
+	}
+	if (value_len > (1 << 20)) {
+		mc_bin_error(req, MC_E2BIG, "Too large");
+		return;
+	}
+
+	struct box_tuple *tuple = find(key);
+	bool exists = tuple != NULL && !(tuple->flags & GHOST) && !expired(tuple);
+	u64 cas = be64toh(req->cas);
+
+	if ((req->opcode == MC_ADD || req->opcode == MC_ADDQ) && exists) {
+		mc_bin_error(req, MC_KEY_EEXISTS, "Data exists for key");
+		return;
+	}
+	if ((req->opcode == MC_REPLACE || req->opcode == MC_REPLACEQ ||
+	     cas != 0) && !exists) {
+		mc_bin_error(req, MC_KEY_ENOENT, "Not found");
+		return;
+	}
+	if (cas != 0 && meta(tuple)->cas != cas) {
+		mc_bin_error(req, MC_KEY_EEXISTS, "Data exists for key");
+		return;
+	}
+
+	u32 flags = ntohl(*(u32 *)ext);
+	u32 exptime = mc_bin_exptime(ntohl(*(u32 *)(ext + 4)));
+	store(key, exptime, flags, value_len, value);
+	stats.total_items++;
+
+	if (!mc_bin_quiet(req->opcode)) {
+		tuple = find(key);
+		mc_bin_reply(req, MC_OK, NULL, 0, NULL, 0, NULL, 0,
+			     tuple ? meta(tuple)->cas : 0);
+	}
+}
+
+static void
+mc_bin_delete(struct mc_bin_header *req, void *key)
+{
+	struct box_tuple *tuple = find(key);
+	if (tuple == NULL || tuple->flags & GHOST || expired(tuple)) {
+		mc_bin_error(req, MC_KEY_ENOENT, "Not found");
+		return;
+	}
+	delete(key);
+	if (!mc_bin_quiet(req->opcode))
+		mc_bin_reply(req, MC_OK, NULL, 0, NULL, 0, NULL, 0, 0);
+}
+
+static void
+mc_bin_incr_decr(struct mc_bin_header *req, void *key, u8 *ext)
+{
+	if (req->ext_len != 20) {
+		mc_bin_error(req, MC_EINVAL, "Invalid arguments");
+		return;
+	}
+	u64 delta = be64toh(*(u64 *)ext);
+	u64 initial = be64toh(*(u64 *)(ext + 8));
+	u32 exptime = ntohl(*(u32 *)(ext + 16));
+	u32 flags = 0;
+	u64 value;
+
+	struct box_tuple *tuple = find(key);
+	if (tuple == NULL || tuple->flags & GHOST || expired(tuple)) {
+		/* All ones in exptime: don't create a missing key. */
+		if (exptime == 0xffffffff) {
+			mc_bin_error(req, MC_KEY_ENOENT, "Not found");
+			return;
+		}
+		value = initial;
+		exptime = mc_bin_exptime(exptime);
+	} else {
+		struct meta *m = meta(tuple);
+		void *field = tuple_field(tuple, 3);
+		u32 value_len = load_varint32(&field);
+
+		if (!is_numeric(field, value_len)) {
+			mc_bin_error(req, MC_DELTA_BADVAL,
+				     "Non-numeric server-side value for incr or decr");
+			return;
+		}
+		value = natoq(field, field + value_len);
+		if (req->opcode == MC_INCREMENT || req->opcode == MC_INCREMENTQ)
+			value += delta;
+		else
+			value = delta > value ? 0 : value - delta;
+		exptime = m->exptime;
+		flags = m->flags;
+	}
+
+	struct tbuf *b = tbuf_alloc(fiber->gc_pool);
+	tbuf_printf(b, "%"PRIu64, value);
+	stats.cmd_set++;
+	store(key, exptime, flags, b->size, b->data);
+	stats.total_items++;
+
+	if (!mc_bin_quiet(req->opcode)) {
+		u64 *v = palloc(fiber->gc_pool, sizeof(u64));
+		*v = htobe64(value);
+		tuple = find(key);
+		mc_bin_reply(req, MC_OK, NULL, 0, NULL, 0, v, sizeof(*v),
+			     tuple ? meta(tuple)->cas : 0);
+	}
+}
+
+static int __attribute__((noinline))
+memcached_binary_dispatch()
+{
+	struct tbuf *rbuf = fiber->rbuf;
+	struct mc_bin_header req;
+
+	if (rbuf->size < sizeof(req))
+		return 0;
+
+	memcpy(&req, rbuf->data, sizeof(req));
+	u16 key_len = ntohs(req.key_len);
+	u32 body_len = ntohl(req.body_len);
+
+	if (req.magic != MC_BIN_REQUEST || req.ext_len + key_len > body_len ||
+	    body_len > (1 << 20) + 1024) {
+		say_warn("memcached binary proto error");
+		return -1;
+	}
+	if (rbuf->size < sizeof(req) + body_len)
+		return 0;
+
+	/* Copy out what has to be aligned or outlive the buffer. */
+	u8 ext[20];
+	u8 *body = rbuf->data + sizeof(req);
+	memcpy(ext, body, MIN(req.ext_len, sizeof(ext)));
+	struct tbuf *key = tbuf_alloc(fiber->gc_pool);
+	write_varint32(key, key_len);
+	tbuf_append(key, body + req.ext_len, key_len);
+	u8 *value = body + req.ext_len + key_len;
+	u32 value_len = body_len - req.ext_len - key_len;
+
+	tbuf_peek(rbuf, sizeof(req) + body_len);
+	stats.bytes_read += sizeof(req) + body_len;
+
+	@try {
+		switch (req.opcode) {
+		case MC_GET: case MC_GETQ: case MC_GETK: case MC_GETKQ:
+			mc_bin_get(&req, key->data);
+			break;
+		case MC_SET: case MC_SETQ: case MC_ADD: case MC_ADDQ:
+		case MC_REPLACE: case MC_REPLACEQ:
+			mc_bin_store(&req, key->data, ext, value, value_len);
+			break;
+		case MC_DELETE: case MC_DELETEQ:
+			mc_bin_delete(&req, key->data);
+			break;
+		case MC_INCREMENT: case MC_INCREMENTQ:
+		case MC_DECREMENT: case MC_DECREMENTQ:
+			mc_bin_incr_decr(&req, key->data, ext);
+			break;
+		case MC_FLUSH: case MC_FLUSHQ: {
+			uintptr_t flush_delay = 0;
+			if (req.ext_len == 4)
+				flush_delay = ntohl(*(u32 *)ext);
+			if (flush_delay > 0) {
+				struct fiber *f = fiber_create("flush_all", -1, -1, flush_all, (void *)flush_delay);
+				if (f)
+					fiber_call(f);
+			} else
+				flush_all((void *)0);
+			if (!mc_bin_quiet(req.opcode))
+				mc_bin_reply(&req, MC_OK, NULL, 0, NULL, 0, NULL, 0, 0);
+			break;
+		}
+		case MC_NOOP:
+			mc_bin_reply(&req, MC_OK, NULL, 0, NULL, 0, NULL, 0, 0);
+			break;
+		case MC_VERSION:
+			mc_bin_reply(&req, MC_OK, NULL, 0, NULL, 0,
+				     "1.2.5 (tarantool/box)", 21, 0);
+			break;
+		case MC_QUIT: case MC_QUITQ:
+			if (!mc_bin_quiet(req.opcode))
+				mc_bin_reply(&req, MC_OK, NULL, 0, NULL, 0, NULL, 0, 0);
+			return -1;
+		default:
+			mc_bin_error(&req, MC_UNKNOWN_COMMAND, "Unknown command");
+			break;
+		}
+	}
+	@catch (ClientError *e) {
+		mc_bin_error(&req, e->errcode == ER_MEMORY_ISSUE ?
+			     MC_ENOMEM : MC_EINTERNAL, e->errmsg);
+	}
+	return 1;
+}
+
 void
 memcached_handler(void *_data __attribute__((unused)))
 {
@@ -329,7 +849,10 @@ memcached_handler(void *_data __attribute__((unused)))
 		}
 
 	dispatch:
-		p = memcached_dispatch();
+		if (*(u8 *)fiber->rbuf->data == MC_BIN_REQUEST)
+			p = memcached_binary_dispatch();
+		else
+			p = memcached_dispatch();
 		if (p < 0) {
 			say_debug("negative dispatch, closing connection");
 			goto exit;
@@ -404,6 +927,12 @@ memcached_check_config(struct tarantool_cfg *conf)
 		return -1;
 	}
 
+	if (conf->memcached_memory_limit < 0) {
+		out_warning(0, "invalid memcached memory limit: %i",
+			    conf->memcached_memory_limit);
+		return -1;
+	}
+
 	return 0;
 }
 
@@ -417,6 +946,20 @@ memcached_init(void)
 	stat_base = stat_register(memcached_stat_strs, memcached_stat_MAX);
 
 	memcached_index = space[cfg.memcached_space].index[0];
+
+	if (cfg.memcached_eviction) {
+		memcached_clock = [memcached_index allocIterator];
+		[memcached_index initIterator: memcached_clock];
+
+		if (space[cfg.memcached_space].memory_limit != 0) {
+			memcached_evictor = fiber_create("memcached_evict", -1, -1,
+							 memcached_evict_loop, NULL);
+			if (memcached_evictor == NULL)
+				say_error("can't start the evict fiber");
+			else
+				fiber_call(memcached_evictor);
+		}
+	}
 }
 
 void
@@ -424,6 +967,8 @@ memcached_free()
 {
 	if (memcached_it)
 		memcached_it->free(memcached_it);
+	if (memcached_clock)
+		memcached_clock->free(memcached_clock);
 }
 
 void
@@ -437,6 +982,7 @@ memcached_space_init()
 	memc_s->enabled = true;
 	memc_s->cardinality = 4;
 	memc_s->n = cfg.memcached_space;
+	memc_s->memory_limit = (size_t) cfg.memcached_memory_limit << 20;
 
 	struct key_def key_def;
 	/* Configure memcached index key. */
@@ -479,29 +1025,21 @@ memcached_delete_expired_keys(struct tbuf *keys_to_delete)
 		}
 	}
 	stat_collect(stat_base, MEMC_EXPIRED_KEYS, expired_keys);
-
-	double delay = ((double) cfg.memcached_expire_per_loop *
-			cfg.memcached_expire_full_sweep /
-			([memcached_index size] + 1));
-	if (delay > 1)
-		delay = 1;
-	fiber_setcancelstate(true);
-	fiber_sleep(delay);
-	fiber_setcancelstate(false);
 }
 
-void
-memcached_expire_loop(void *data __attribute__((unused)))
+/**
+ * Build the expiration index of the keys which are already in
+ * the space, e.g. loaded from a snapshot, and delete those which
+ * have already expired.
+ */
+static void
+memcached_expire_scan(void)
 {
-	struct box_tuple *tuple = NULL;
+	struct box_tuple *tuple;
 
-	say_info("memcached expire fiber started");
 	memcached_it = [memcached_index allocIterator];
-	@try {
-restart:
-		if (tuple == NULL)
-			[memcached_index initIterator: memcached_it];
-
+	[memcached_index initIterator: memcached_it];
+	do {
 		struct tbuf *keys_to_delete = tbuf_alloc(fiber->gc_pool);
 
 		for (int j = 0; j < cfg.memcached_expire_per_loop; j++) {
@@ -511,18 +1049,88 @@ restart:
 			if (tuple == NULL)
 				break;
 
-			if (!expired(tuple))
+			u32 exptime = meta(tuple)->exptime;
+			if (exptime == 0)
 				continue;
 
+			if (exptime >= memcached_ring.next) {
+				expire_ring_add(&memcached_ring, exptime, tuple->data);
+				continue;
+			}
+
 			say_debug("expire tuple %p", tuple);
 			tbuf_append_field(keys_to_delete, tuple->data);
 		}
 		memcached_delete_expired_keys(keys_to_delete);
 		fiber_gc();
-		goto restart;
+
+		double delay = ((double) cfg.memcached_expire_per_loop *
+				cfg.memcached_expire_full_sweep /
+				([memcached_index size] + 1));
+		if (delay > 1)
+			delay = 1;
+		fiber_setcancelstate(true);
+		fiber_sleep(delay);
+		fiber_setcancelstate(false);
+	} while (tuple != NULL);
+
+	memcached_it->free(memcached_it);
+	memcached_it = NULL;
+}
+
+struct memcached_expire_batch {
+	struct tbuf *keys_to_delete;
+	int count;
+};
+
+static void
+memcached_expire_due(void *key, u32 exptime, void *arg)
+{
+	struct memcached_expire_batch *batch = arg;
+
+	struct box_tuple *tuple = find(key);
+	if (tuple == NULL || tuple->flags & GHOST ||
+	    meta(tuple)->exptime != exptime)
+		return;
+
+	say_debug("expire tuple %p", tuple);
+	tbuf_append_field(batch->keys_to_delete, key);
+	if (++batch->count == cfg.memcached_expire_per_loop) {
+		memcached_delete_expired_keys(batch->keys_to_delete);
+		fiber_gc();
+		batch->keys_to_delete = tbuf_alloc(fiber->gc_pool);
+		batch->count = 0;
+	}
+}
+
+void
+memcached_expire_loop(void *data __attribute__((unused)))
+{
+	say_info("memcached expire fiber started");
+	memcached_ring.next = ev_now();
+	@try {
+		memcached_expire_scan();
+
+		for (;;) {
+			struct memcached_expire_batch batch = {
+				.keys_to_delete = tbuf_alloc(fiber->gc_pool),
+				.count = 0
+			};
+			expire_ring_run(&memcached_ring, ev_now(),
+					memcached_expire_due, &batch);
+			memcached_delete_expired_keys(batch.keys_to_delete);
+			fiber_gc();
+
+			fiber_setcancelstate(true);
+			fiber_sleep(1);
+			fiber_setcancelstate(false);
+		}
 	} @finally {
-		memcached_it->free(memcached_it);
-		memcached_it = NULL;
+		if (memcached_it) {
+			memcached_it->free(memcached_it);
+			memcached_it = NULL;
+		}
+		expire_ring_clear(&memcached_ring);
 	}
 }
 
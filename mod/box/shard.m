@@ -0,0 +1,583 @@
+/*
+ * Copyright (C) 2010, 2011 Mail.RU
+ * Copyright (C) 2010, 2011 Yuriy Vostrikov
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "shard.h"
+#include "box.h"
+#include "tarantool.h"
+#include "fiber.h"
+#include "pickle.h"
+#include "palloc.h"
+#include "say.h"
+#include "exception.h"
+#include "cfg/tarantool_box_cfg.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <third_party/crc32.h>
+#include <third_party/queue.h>
+
+/*
+ * Sharding.
+ *
+ * Every shard is connected to the router with a socket pair, see
+ * shards_prefork() in tarantool.m. The router multiplexes requests
+ * of all its clients over the socket and matches the replies by
+ * sync, which it assigns itself. The shard executes the requests
+ * concurrently, each one in a fiber of its own, exactly as if they
+ * came over separate connections: writes included, since the
+ * writes of a client are already ordered by its connection to the
+ * router, which waits for the reply to a write before the next
+ * write of the client is sent.
+ *
+ * A request is routed by the crc32c of the first field of its
+ * primary key, NUM and NUM64 fields by value. A select by
+ * anything but a single primary key is sent to all shards, key by
+ * key, and the results of every key are merged in index order, so
+ * that offset and limit work as they do without sharding. A call
+ * is routed by its first argument, taken as a key of the primary
+ * index of space 0: a decimal string goes to the shard of the
+ * number. A stored procedure must only touch the data of the key
+ * it's called with.
+ */
+
+/** Requests of a shard's router link executed at once. */
+enum { SHARD_INFLIGHT_LIMIT = 1024 };
+
+/** A request sent to a shard. */
+struct shard_call {
+	struct fiber *fiber;
+	u32 sync;
+	/** The reply, set when it arrives. */
+	struct iproto_header_retcode *reply;
+	/** Set while waiting for the turn to write. */
+	bool queued;
+	SLIST_ENTRY(shard_call) link;
+	STAILQ_ENTRY(shard_call) writer_link;
+};
+
+/** The router's end of a shard link. */
+struct shard {
+	int no;
+	int fd;
+	u32 sync;
+	/** Reads replies and wakes up their callers. */
+	struct fiber *reader;
+	/** Sent requests waiting for a reply. */
+	SLIST_HEAD(, shard_call) calls;
+	/** Requests are written one at a time. */
+	bool writing;
+	STAILQ_HEAD(, shard_call) writers;
+};
+
+static struct shard *shards;
+
+/** An error returned by a shard, passed on to the client as is. */
+@interface ShardError: ClientError
+- (id) init: (u32)ret_code :(const char *)msg :(size_t)len;
+@end
+
+@implementation ShardError
+- (id) init: (u32)ret_code :(const char *)msg :(size_t)len
+{
+	[super init: ER_OK];
+	errcode = ret_code >> 8;
+	if (errcode >= tnt_error_codes_enum_MAX)
+		errcode = ER_UNSUPPORTED;
+	snprintf(errmsg, sizeof(errmsg), "%.*s", (int) strnlen(msg, len), msg);
+	return self;
+}
+@end
+
+static void
+shard_send(struct shard *shard, struct shard_call *call, u32 op, struct tbuf *body)
+{
+	call->fiber = fiber;
+	call->sync = ++shard->sync;
+	call->reply = NULL;
+	SLIST_INSERT_HEAD(&shard->calls, call, link);
+
+	if (shard->writing) {
+		call->queued = true;
+		STAILQ_INSERT_TAIL(&shard->writers, call, writer_link);
+		/* Replies to other calls may wake us up too. */
+		while (call->queued)
+			fiber_yield();
+	}
+	shard->writing = true;
+
+	struct iproto_header *request =
+		palloc(fiber->gc_pool, sizeof(*request) + body->size);
+	request->msg_code = op;
+	request->len = body->size;
+	request->sync = call->sync;
+	memcpy(request->data, body->data, body->size);
+
+	int fd = fiber->fd;
+	fiber->fd = shard->fd;
+	ssize_t r = fiber_write(request, sizeof(*request) + body->size);
+	fiber->fd = fd;
+	/* A shard never closes the link: it's gone. */
+	if (r < 0 || (size_t) r != sizeof(*request) + body->size)
+		panic_syserror("shard %i: write failed", shard->no);
+
+	if (!STAILQ_EMPTY(&shard->writers)) {
+		struct shard_call *next = STAILQ_FIRST(&shard->writers);
+		STAILQ_REMOVE_HEAD(&shard->writers, writer_link);
+		next->queued = false;
+		fiber_wakeup(next->fiber);
+	} else {
+		shard->writing = false;
+	}
+}
+
+static void
+shard_wait(struct shard_call *calls, int count)
+{
+	for (int i = 0; i < count; i++) {
+		while (calls[i].reply == NULL)
+			fiber_yield();
+	}
+}
+
+/** Return the body of a reply, or raise the error it carries. */
+static void *
+shard_reply_body(struct shard_call *call, u32 *size)
+{
+	struct iproto_header_retcode *reply = call->reply;
+	void *body = reply + 1;
+
+	*size = reply->len - sizeof(reply->ret_code);
+	if (reply->ret_code != 0)
+		tnt_raise(ShardError, :reply->ret_code :(const char *) body :*size);
+	return body;
+}
+
+static void
+shard_deliver(struct shard *shard, struct tbuf *reply)
+{
+	struct shard_call *call;
+
+	SLIST_FOREACH(call, &shard->calls, link) {
+		if (call->sync == iproto(reply)->sync)
+			break;
+	}
+	if (call == NULL || reply->size < sizeof(*call->reply)) {
+		say_error("shard %i: unexpected reply", shard->no);
+		return;
+	}
+	SLIST_REMOVE(&shard->calls, call, shard_call, link);
+
+	/* The reader's buffer is gone by the time the caller runs. */
+	call->reply = palloc(call->fiber->gc_pool, reply->size);
+	memcpy(call->reply, reply->data, reply->size);
+	fiber_wakeup(call->fiber);
+}
+
+static void
+shard_reader(void *data)
+{
+	struct shard *shard = data;
+	struct tbuf *in = fiber->rbuf;
+	ssize_t to_read = sizeof(struct iproto_header);
+
+	for (;;) {
+		if (to_read > 0 && fiber_bread(in, to_read) <= 0)
+			break;
+
+		ssize_t reply_len = sizeof(struct iproto_header) + iproto(in)->len;
+		to_read = reply_len - in->size;
+
+		if (to_read > 0 && fiber_bread(in, to_read) <= 0)
+			break;
+
+		shard_deliver(shard, tbuf_split(in, reply_len));
+
+		to_read = sizeof(struct iproto_header) - in->size;
+		if (to_read > 0) {
+			fiber_gc();
+			in = fiber->rbuf;
+		}
+	}
+	panic("shard %i has gone away", shard->no);
+}
+
+static int
+shard_of_num(u64 value)
+{
+	return crc32c(0, (void *) &value, sizeof(value)) % cfg.shards;
+}
+
+/** Hash the first field of a primary key to a shard. */
+static int
+shard_of_field(struct key_def *key_def, void *field)
+{
+	u32 len = load_varint32(&field);
+
+	/* A number goes to the same shard whatever its width. */
+	if (key_def->parts[0].type == NUM || key_def->parts[0].type == NUM64) {
+		if (len == sizeof(u32))
+			return shard_of_num(*(u32 *) field);
+		if (len == sizeof(u64))
+			return shard_of_num(*(u64 *) field);
+	}
+	return crc32c(0, field, len) % cfg.shards;
+}
+
+/**
+ * Hash a call argument to a shard. Arguments of a call are
+ * strings, so a number comes in decimal: route it as the key
+ * it is in a NUM or NUM64 index.
+ */
+static int
+shard_of_arg(void *field)
+{
+	struct key_def *key_def = space[0].enabled ? &space[0].index[0]->key_def : NULL;
+	void *arg = field;
+	u32 len = load_varint32(&arg);
+
+	if (key_def == NULL)
+		return crc32c(0, arg, len) % cfg.shards;
+
+	if ((key_def->parts[0].type == NUM || key_def->parts[0].type == NUM64) &&
+	    len > 0 && len <= 20) {
+		u64 value = 0;
+		u32 i;
+		for (i = 0; i < len; i++) {
+			u8 c = ((u8 *) arg)[i];
+			if (c < '0' || c > '9' || value > (UINT64_MAX - (c - '0')) / 10)
+				break;
+			value = value * 10 + (c - '0');
+		}
+		if (i == len)
+			return shard_of_num(value);
+	}
+	return shard_of_field(key_def, field);
+}
+
+/**
+ * Find the shard of a request, -1 if a select has to go to all
+ * of them. Malformed requests go to the first shard, which
+ * reports the error.
+ */
+static int
+shard_route(u32 op, struct tbuf *data)
+{
+	struct tbuf req = *data;
+	u32 n, cardinality, fieldno;
+
+	switch (op) {
+	case REPLACE:
+		n = read_u32(&req);
+		read_u32(&req);				/* flags */
+		cardinality = read_u32(&req);
+		if (n >= BOX_SPACE_MAX || !space[n].enabled)
+			return 0;
+		fieldno = space[n].index[0]->key_def.parts[0].fieldno;
+		if (fieldno >= cardinality)
+			return 0;
+		for (u32 i = 0; i < fieldno; i++)
+			read_field(&req);
+		return shard_of_field(&space[n].index[0]->key_def, read_field(&req));
+
+	case DELETE_1_3:
+	case DELETE:
+	case UPDATE:
+		n = read_u32(&req);
+		if (n >= BOX_SPACE_MAX || !space[n].enabled)
+			return 0;
+		if (op != DELETE_1_3)
+			read_u32(&req);			/* flags */
+		if (read_u32(&req) == 0)		/* key cardinality */
+			return 0;
+		return shard_of_field(&space[n].index[0]->key_def, read_field(&req));
+
+	case SELECT:
+		n = read_u32(&req);
+		fieldno = read_u32(&req);		/* index */
+		if (n >= BOX_SPACE_MAX || !space[n].enabled ||
+		    fieldno >= BOX_INDEX_MAX || space[n].index[fieldno] == nil)
+			return 0;
+		if (fieldno != 0)
+			return -1;
+		read_u32(&req);				/* offset */
+		read_u32(&req);				/* limit */
+		cardinality = read_u32(&req);		/* key count */
+		if (cardinality == 0)
+			return 0;
+		if (cardinality != 1)
+			return -1;
+		if (read_u32(&req) == 0)		/* key cardinality */
+			return -1;
+		return shard_of_field(&space[n].index[0]->key_def, read_field(&req));
+
+	case CALL:
+		read_u32(&req);				/* flags */
+		read_field(&req);			/* procedure name */
+		if (read_u32(&req) == 0)		/* argument count */
+			return 0;
+		return shard_of_arg(read_field(&req));
+
+	default:
+		return 0;
+	}
+}
+
+/** A shard's part of the result of a select. */
+struct shard_result {
+	struct tbuf tuples;
+	u32 count;
+};
+
+/** Find a field of a tuple in the reply format, NULL if it has none. */
+static void *
+shard_tuple_field(void *tuple, u32 fieldno)
+{
+	u32 cardinality = ((u32 *) tuple)[1];
+	void *field = tuple + 2 * sizeof(u32);
+
+	if (fieldno >= cardinality)
+		return NULL;
+	while (fieldno-- > 0) {
+		u32 len = load_varint32(&field);
+		field += len;
+	}
+	return field;
+}
+
+/** Compare two tuples in the reply format by an index key. */
+static int
+shard_tuple_cmp(struct key_def *key_def, void *tuple_a, void *tuple_b)
+{
+	for (u32 i = 0; i < key_def->part_count; i++) {
+		void *a = shard_tuple_field(tuple_a, key_def->parts[i].fieldno);
+		void *b = shard_tuple_field(tuple_b, key_def->parts[i].fieldno);
+
+		/* A shard only returns tuples it could index. */
+		if (a == NULL || b == NULL)
+			return (a != NULL) - (b != NULL);
+
+		u32 len_a = load_varint32(&a), len_b = load_varint32(&b);
+		int r;
+
+		if (key_def->parts[i].type == NUM) {
+			u32 ua = *(u32 *) a, ub = *(u32 *) b;
+			r = ua > ub ? 1 : ua == ub ? 0 : -1;
+		} else if (key_def->parts[i].type == NUM64) {
+			u64 ua = *(u64 *) a, ub = *(u64 *) b;
+			r = ua > ub ? 1 : ua == ub ? 0 : -1;
+		} else {
+			r = memcmp(a, b, MIN(len_a, len_b));
+			if (r == 0)
+				r = len_a > len_b ? 1 : len_a == len_b ? 0 : -1;
+		}
+		if (r != 0)
+			return r;
+	}
+	return 0;
+}
+
+/**
+ * Send a select to all shards and merge the results. Keys are
+ * selected one at a time: every shard is asked for up to
+ * offset + limit tuples of the key, the results of all shards
+ * are merged in the order of the index, and offset and limit
+ * are applied to the merged result, exactly as process_select()
+ * does.
+ */
+static void
+router_select_all(struct tbuf *data)
+{
+	struct tbuf req = *data;
+	u32 n = read_u32(&req);
+	u32 index_no = read_u32(&req);
+	u32 offset = read_u32(&req);
+	u32 limit = read_u32(&req);
+	u32 key_count = read_u32(&req);
+	struct key_def *key_def = &space[n].index[index_no]->key_def;
+
+	struct shard_call *calls = palloc(fiber->gc_pool, sizeof(*calls) * cfg.shards);
+	struct shard_result *results =
+		palloc(fiber->gc_pool, sizeof(*results) * cfg.shards);
+
+	u32 *found = palloc(fiber->gc_pool, sizeof(*found));
+	*found = 0;
+	iov_add(found, sizeof(*found));
+
+	for (u32 k = 0; k < key_count && *found < limit; k++) {
+		void *key = req.data;
+		u32 key_cardinality = read_u32(&req);
+		for (u32 i = 0; i < key_cardinality; i++)
+			read_field(&req);
+
+		u32 wanted = limit - *found;
+		u32 args[] = {
+			n, index_no, 0,
+			wanted > UINT32_MAX - offset ? UINT32_MAX : offset + wanted,
+			1				/* key count */
+		};
+		struct tbuf *body = tbuf_alloc(fiber->gc_pool);
+		tbuf_append(body, args, sizeof(args));
+		tbuf_append(body, key, req.data - key);
+
+		for (int i = 0; i < cfg.shards; i++)
+			shard_send(&shards[i], &calls[i], SELECT, body);
+		shard_wait(calls, cfg.shards);
+
+		for (int i = 0; i < cfg.shards; i++) {
+			struct tbuf *tuples = &results[i].tuples;
+			tuples->data = shard_reply_body(&calls[i], &tuples->size);
+			tuples->capacity = tuples->size;
+			tuples->pool = NULL;
+			results[i].count = read_u32(tuples);
+		}
+
+		while (*found < limit) {
+			struct shard_result *next = NULL;
+			for (int i = 0; i < cfg.shards; i++) {
+				if (results[i].count == 0)
+					continue;
+				if (next == NULL ||
+				    shard_tuple_cmp(key_def, results[i].tuples.data,
+						    next->tuples.data) < 0)
+					next = &results[i];
+			}
+			if (next == NULL)
+				break;
+
+			void *tuple = next->tuples.data;
+			u32 bsize = read_u32(&next->tuples);
+			read_u32(&next->tuples);	/* cardinality */
+			read_str(&next->tuples, bsize);
+			next->count--;
+			if (offset > 0) {
+				offset--;
+				continue;
+			}
+			iov_add(tuple, 2 * sizeof(u32) + bsize);
+			(*found)++;
+		}
+	}
+}
+
+static void
+router_process_rw(u32 op, struct tbuf *data)
+{
+	int no = shard_route(op, data);
+	if (no < 0) {
+		router_select_all(data);
+		return;
+	}
+
+	struct shard_call call;
+	shard_send(&shards[no], &call, op, data);
+	shard_wait(&call, 1);
+
+	u32 size;
+	void *body = shard_reply_body(&call, &size);
+	if (size > 0)
+		iov_add(body, size);
+}
+
+static void
+router_process_ro(u32 op, struct tbuf *data)
+{
+	if (op != SELECT)
+		tnt_raise(LoggedError, :ER_NONMASTER);
+
+	router_process_rw(op, data);
+}
+
+iproto_callback router_rw_callback = router_process_rw;
+iproto_callback router_ro_callback = router_process_ro;
+
+void
+router_init()
+{
+	shards = palloc(eter_pool, sizeof(*shards) * cfg.shards);
+	memset(shards, 0, sizeof(*shards) * cfg.shards);
+
+	for (int i = 0; i < cfg.shards; i++) {
+		struct shard *shard = &shards[i];
+		char name[FIBER_NAME_MAXLEN];
+
+		shard->no = i;
+		shard->fd = shard_links[i];
+		SLIST_INIT(&shard->calls);
+		STAILQ_INIT(&shard->writers);
+
+		if (set_nonblock(shard->fd) == -1)
+			panic("shard %i: can't set the link non-blocking", i);
+
+		snprintf(name, sizeof(name), "shard_%i", i);
+		shard->reader = fiber_create(name, shard->fd, -1, shard_reader, shard);
+		if (shard->reader == NULL)
+			panic("can't create the reader of shard %i", i);
+		fiber_call(shard->reader);
+	}
+	say_info("routing requests to %i shards", cfg.shards);
+}
+
+/**
+ * Writes on the router link are of many clients, each of which
+ * has its writes ordered by the router: don't order them again.
+ */
+static bool
+shard_op_is_write(u32 op __attribute__((unused)))
+{
+	return false;
+}
+
+static void
+shard_handler(void *data)
+{
+	iproto_interact(data);
+
+	say_crit("the router has gone away, exiting");
+	ev_unloop(EV_A_ EVUNLOOP_ALL);
+}
+
+void
+shard_init(iproto_callback *callback)
+{
+	int fd = shard_links[shard_no];
+
+	/*
+	 * The link carries requests of all clients of the
+	 * router: run them concurrently, so that writes of
+	 * different clients share WAL writes, as they do
+	 * without shards.
+	 */
+	iproto_set_inflight_limit(MAX(cfg.iproto_inflight_limit,
+				      SHARD_INFLIGHT_LIMIT), shard_op_is_write);
+
+	if (set_nonblock(fd) == -1)
+		panic("can't set the router link non-blocking");
+
+	struct fiber *link = fiber_create("router", fd, -1, shard_handler, callback);
+	if (link == NULL)
+		panic("can't create the router link fiber");
+	fiber_call(link);
+}
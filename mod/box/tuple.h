@@ -28,6 +28,7 @@
  * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+#include <stdbool.h>
 #include <util.h>
 
 struct tbuf;
@@ -38,22 +39,29 @@ enum tuple_flags {
 	WAL_WAIT = 0x1,
 	/** A new primary key is created but not yet written to WAL. */
 	GHOST = 0x2,
+	/** Read since the last turn of the memcached eviction hand. */
+	ACCESSED = 0x4,
 };
 
 /**
  * An atom of Tarantool/Box storage. Consists of a list of fields.
  * The first field is always the primary key.
+ *
+ * The header takes 8 bytes: no tuple is bigger than the largest
+ * slab item, so its size fits in 24 bits and leaves room for the
+ * flags. On the wire and in snapshots size and cardinality are
+ * still 32-bit, see tuple_to_iov().
  */
 struct box_tuple
 {
 	/** reference counter */
 	u16 refs;
-	/* see enum tuple_flags */
-	u16 flags;
-	/** length of the variable part of the tuple */
-	u32 bsize;
 	/** number of fields in the variable part. */
-	u32 cardinality;
+	u16 cardinality;
+	/** length of the variable part of the tuple */
+	u32 bsize:24;
+	/* see enum tuple_flags */
+	u32 flags:8;
 	/**
 	 * Fields can have variable length, and thus are packed
 	 * into a contiguous byte array. Each field is prefixed
@@ -93,11 +101,22 @@ tuple_field(struct box_tuple *tuple, size_t i);
 void
 tuple_print(struct tbuf *buf, uint8_t cardinality, void *f);
 
+/** The largest cardinality a tuple can have. */
+#define TUPLE_CARDINALITY_MAX UINT16_MAX
+
 /** Tuple length when adding to iov. */
 static inline size_t tuple_len(struct box_tuple *tuple)
 {
-	return tuple->bsize + sizeof(tuple->bsize) +
-		sizeof(tuple->cardinality);
+	/* u32 size and cardinality, then the fields */
+	return tuple->bsize + 2 * sizeof(u32);
 }
+
+/**
+ * Add the tuple to the fiber iov in the wire format. Unless
+ * dup is set, the fields are not copied, and the caller keeps a
+ * reference to the tuple until the iov is flushed.
+ */
+void
+tuple_to_iov(struct box_tuple *tuple, bool dup);
 #endif /* TARANTOOL_BOX_TUPLE_H_INCLUDED */
 
@@ -31,6 +31,9 @@
 #include <pickle.h>
 #include <salloc.h>
 #include "tbuf.h"
+#include "fiber.h"
+
+#include <string.h>
 
 #include "exception.h"
 
@@ -106,6 +109,25 @@ tuple_field(struct box_tuple *tuple, size_t i)
 	return field;
 }
 
+void
+tuple_to_iov(struct box_tuple *tuple, bool dup)
+{
+	u32 *header;
+
+	if (dup) {
+		header = palloc(fiber->gc_pool, tuple_len(tuple));
+		memcpy(header + 2, tuple->data, tuple->bsize);
+		iov_add(header, tuple_len(tuple));
+	} else {
+		header = palloc(fiber->gc_pool, 2 * sizeof(u32));
+		iov_ensure(2);
+		iov_add_unsafe(header, 2 * sizeof(u32));
+		iov_add_unsafe(tuple->data, tuple->bsize);
+	}
+	header[0] = tuple->bsize;
+	header[1] = tuple->cardinality;
+}
+
 /** print field to tbuf */
 static void
 print_field(struct tbuf *buf, void *f)
@@ -49,6 +49,8 @@ ER = {
    37: "ER_UPDATE_ID"           ,
    38: "ER_WRONG_VERSION"       ,
    39: "ER_WAL_IO"              ,
+   40: "ER_QUORUM_TIMEOUT"      ,
+   41: "ER_SPACE_MEMORY_LIMIT"  ,
    48: "ER_PROC_RET"            ,
    49: "ER_TUPLE_NOT_FOUND"     ,
    50: "ER_NO_SUCH_PROC"        ,
@@ -0,0 +1,140 @@
+/*
+ * An implementation of the LZF compression format.
+ *
+ * The stream is a sequence of chunks, each starting with a
+ * control byte:
+ *
+ *   000LLLLL                  a run of LLLLL + 1 literal bytes
+ *   LLLOOOOO [LLLLLLLL] OOOOOOOO
+ *                             a back reference: copy L + 2 bytes
+ *                             from O + 1 bytes back; the extra
+ *                             length byte is present when LLL == 7
+ *                             and is added to it.
+ */
+#include "lzf.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define LZF_HLOG 13
+#define LZF_MAX_LIT 32
+#define LZF_MAX_OFF (1 << 13)
+#define LZF_MAX_REF ((1 << 8) + (1 << 3))
+
+static inline unsigned
+lzf_hash(const uint8_t *p)
+{
+	uint32_t v = (p[0] << 16) | (p[1] << 8) | p[2];
+	return ((v * 2654435761U) >> (32 - LZF_HLOG)) & ((1 << LZF_HLOG) - 1);
+}
+
+static uint8_t *
+lzf_literals(uint8_t *op, uint8_t *out_end, const uint8_t *from, size_t len)
+{
+	while (len > 0) {
+		size_t n = len < LZF_MAX_LIT ? len : LZF_MAX_LIT;
+		if (op + 1 + n > out_end)
+			return NULL;
+		*op++ = n - 1;
+		memcpy(op, from, n);
+		op += n;
+		from += n;
+		len -= n;
+	}
+	return op;
+}
+
+size_t
+lzf_compress(const void *in, size_t in_len, void *out, size_t out_len)
+{
+	/*
+	 * Positions of the last occurrence of each 3-byte hash.
+	 * Entries left from a previous call are harmless: every
+	 * candidate is range-checked and compared byte by byte.
+	 */
+	static uint32_t htab[1 << LZF_HLOG];
+	const uint8_t *in_start = in, *in_end = in_start + in_len;
+	const uint8_t *ip = in_start, *anchor = in_start;
+	uint8_t *op = out, *out_end = op + out_len;
+
+	while (ip + 3 <= in_end) {
+		unsigned h = lzf_hash(ip);
+		const uint8_t *ref = in_start + htab[h];
+		htab[h] = ip - in_start;
+
+		if (ref >= ip || ip - ref > LZF_MAX_OFF ||
+		    ref[0] != ip[0] || ref[1] != ip[1] || ref[2] != ip[2]) {
+			ip++;
+			continue;
+		}
+
+		size_t max = in_end - ip;
+		if (max > LZF_MAX_REF)
+			max = LZF_MAX_REF;
+		size_t len = 3;
+		while (len < max && ref[len] == ip[len])
+			len++;
+
+		op = lzf_literals(op, out_end, anchor, ip - anchor);
+		if (op == NULL || op + 3 > out_end)
+			return 0;
+
+		size_t off = ip - ref - 1;
+		len -= 2;
+		if (len < 7) {
+			*op++ = (len << 5) | (off >> 8);
+		} else {
+			*op++ = (7 << 5) | (off >> 8);
+			*op++ = len - 7;
+		}
+		*op++ = off & 0xff;
+
+		ip += len + 2;
+		anchor = ip;
+	}
+
+	op = lzf_literals(op, out_end, anchor, in_end - anchor);
+	if (op == NULL)
+		return 0;
+	return op - (uint8_t *) out;
+}
+
+size_t
+lzf_decompress(const void *in, size_t in_len, void *out, size_t out_len)
+{
+	const uint8_t *ip = in, *in_end = ip + in_len;
+	uint8_t *op = out, *out_end = op + out_len;
+
+	while (ip < in_end) {
+		unsigned ctrl = *ip++;
+
+		if (ctrl < LZF_MAX_LIT) {
+			size_t len = ctrl + 1;
+			if (ip + len > in_end || op + len > out_end)
+				return 0;
+			memcpy(op, ip, len);
+			ip += len;
+			op += len;
+			continue;
+		}
+
+		size_t len = ctrl >> 5;
+		if (len == 7) {
+			if (ip >= in_end)
+				return 0;
+			len += *ip++;
+		}
+		if (ip >= in_end)
+			return 0;
+		size_t off = ((ctrl & 0x1f) << 8) + *ip++ + 1;
+		len += 2;
+		if (off > (size_t)(op - (uint8_t *) out) || op + len > out_end)
+			return 0;
+
+		/* The source may overlap the destination. */
+		const uint8_t *ref = op - off;
+		while (len-- > 0)
+			*op++ = *ref++;
+	}
+	return op - (uint8_t *) out;
+}
@@ -0,0 +1,17 @@
+#ifndef LZF_H
+#define LZF_H
+
+#include <stddef.h>
+
+/*
+ * A compressor and decompressor for the LZF format of liblzf
+ * by Marc Lehmann: a very fast LZ77 variant with an 8KB window
+ * and no entropy coding.
+ *
+ * Both functions return the number of bytes written to out, or 0
+ * if out is too small (or, for decompression, if in is corrupt).
+ */
+size_t lzf_compress(const void *in, size_t in_len, void *out, size_t out_len);
+size_t lzf_decompress(const void *in, size_t in_len, void *out, size_t out_len);
+
+#endif